@@ -8,6 +8,10 @@
 #include <OpenNI.h>
 
 #include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 //#include <kinect\nui\Kinect.h>
@@ -17,11 +21,29 @@
 
 #include "utils\FPSCounter.h"
 #include "utils\RunningAverage.h"
+#include "utils\FrameArena.h"
+#include "utils\RollingStatistics.h"
+#include "utils\Metrics.h"
+#include "utils\MetricsServer.h"
+#include "utils\Pipeline.h"
+#include "utils\TaskScheduler.h"
 
 //#include "wfm\WireframeFile.h"
 #include "eru\Model.h"
 
 #include "Capture.h"
+#include "CameraCalibration.h"
+#include "DepthRegistration.h"
+#include "FrameInfo.h"
+#include "FramePacket.h"
+#include "FrameReadback.h"
+#include "HudLayer.h"
+#include "SdfFont.h"
+#include "SharedFrameOutput.h"
+#include "SnapshotWriter.h"
+#include "SoftwareCompositor.h"
+#include "VideoRecorder.h"
+#include "models\FaceAssetCache.h"
 
 
 class Application
@@ -34,17 +56,53 @@ class Application
 
     const std::string resources_dir = "resources\\";
     const std::string capture_dir = "cap\\";
+    const std::string profiles_dir = "profiles\\";
+    const std::string texture_cache_dir = "cache\\";    // Preprocessed face textures (see FaceTexture), made on first load
 
     //const std::string default_font_file = "fonts\\TitilliumWeb-Bold.ttf";
     const std::string default_font_file = "fonts\\Exo-Bold.ttf";
 
+    const std::string calibration_file = "calibration\\kinect.yml";
+
     const int depth_threshold = 2400; //mm
 
     const bool ssfx_enabled = false;    // Screen-space effects
 
     const bool advanced_view = false;   // If true, show depth video and other information
     const bool show_status = true;     // If true, show status information such as FPS
+    const bool sdf_text = true;         // Draw the status text from a signed distance field atlas (sdf-text.frag) rather than outline-shader.frag
+    const unsigned int status_text_size = 16;
     const bool draw_face_wireframe = false;
+    const bool software_compositing = false;    // Composite the face on the CPU (SoftwareCompositor) instead of with face-blend.frag
+    const bool gpu_blendshapes = true;          // Deform the face mesh in the vertex shader (blendshapes.vert), uploading only its coefficients each frame
+    const std::string detail_mesh_file = "";    // High resolution face mesh (.wfm, under resources/faces) to draw, driven by the tracked mesh; deforms on the CPU
+    const int face_subdivision_levels = 0;      // Or, Loop subdivide the tracked mesh this many times (1-3) to smooth its facets; deforms on the CPU
+    const std::string face_playlist = "";       // Replacement faces to step through with F8: a file under resources/faces listing .wfm files there, one per line; deforms on the CPU
+    const size_t face_cache_cpu_budget = 64 * 1024 * 1024;     // Bytes of playlist meshes and preprocessed textures kept in memory (see FaceAssetCache)
+    const size_t face_cache_gpu_budget = 128 * 1024 * 1024;    // Bytes of playlist textures kept in video memory
+    const int face_prefetch_count = 2;          // Playlist faces after the current one to load in the background
+
+    const bool metrics_enabled = true;      // If true, serve live metrics at http://127.0.0.1:<metrics_port>/metrics
+    const unsigned short metrics_port = 9731;    // Clear of the well known exporter ports (eg. node_exporter on 9100)
+
+    const bool pin_pipeline_threads = true;     // Pin each pipeline stage to its own core (only if there are more cores than stages)
+    const size_t pipeline_pool_size = 18;       // Frames in flight: enough to fill every queue, plus one per stage and the displayed one
+
+    const int worker_threads = -1;              // Threads for splitting up work within a frame (-1 = one per core not running a pipeline stage or the render thread)
+    static const int parallel_band_rows = 32;   // Image rows per task when splitting up work within a frame
+
+    const double record_fps = 30.0;             // Frame rate written into recordings (F9)
+    const size_t record_queue_size = 8;         // Frames waiting to be encoded before new ones are dropped
+    const bool record_raw_streams = true;       // Also record the color and raw depth streams
+    static const int record_readback_latency = 2;   // Frames between starting a readback and collecting it
+
+    const size_t snapshot_backlog = 4;          // Snapshots (F11) waiting to be written before new ones are skipped
+
+    const bool shared_output_enabled = false;   // Publish every displayed frame to shared memory for other processes (see SharedFrameReader)
+    const std::string shared_output_name = "Local\\VirtualMirrorOutput";
+    const int shared_output_slots = 4;          // Frames in the ring, including the ones waiting for their readback
+    const int shared_output_max_width = 1920;   // Largest window that can be published
+    const int shared_output_max_height = 1080;
 
 public:
     std::vector<std::wstring> args;
@@ -55,12 +113,26 @@ public:
 
     int Main();
 
+    // Luminance levels (1%/99%) of an image, for the blend shader's lumaCorrect
+    static sf::Vector2f AnalyzeLevels(cv::Mat image, FrameArena& arena);
+
+    // Normalize a 32F depth image and map it to the JET color map (8UC3)
+    static void ColorizeDepth(const cv::Mat& depth, cv::Mat& colored, FrameArena& arena);
+
 protected:
     void InitializeResources();
     void InitializeWindow();
     void Initialize3D();
 
     //void Capture();
+    void InitializePipeline();
+
+    // Pipeline stages, each runs on its own thread (see InitializePipeline)
+    bool ConvertFrame(FramePacket& packet, FrameArena& arena);
+    bool TrackFrame(FramePacket& packet, FrameArena& arena);
+    bool DeformFrame(FramePacket& packet, FrameArena& arena);
+    bool PrepareComposite(FramePacket& packet, FrameArena& arena);
+
     void Process();
     void Draw();
     void DrawVideo(sf::RenderTarget* target);
@@ -69,13 +141,20 @@ protected:
     void DrawStatus(sf::RenderTarget* target);
 
     void OnKeyPress(sf::Event e);
+    void SelectFace(int index);
 
-    // Captured image frames
-    cv::Mat colorImage;     // 8UC3 (RGB)
-    cv::Mat depthImage;     // 32F, not normalized
-    cv::Mat depthRaw;       // 16U
+    void RecordFrame();
+    void TakeSnapshot();
+    void PublishFrame(bool newPacket);
+
+    void InitializeMetrics();
+    void UpdateLatency();
+    bool WriteMetrics(const std::string& filename);
 
-    cv::Mat faceImage;
+    // Captured image frames (of the frame being displayed)
+    cv::Mat colorImage;     // 8UC3 (RGB)
+    cv::Mat depthImage;     // 32F, not normalized, registered to the color image
+    cv::Mat depthRaw;       // 16U, as captured
 
     bool newFrame;
     bool colorReady;
@@ -83,10 +162,38 @@ protected:
 
     Capture capture;
 
+    CameraCalibration calibration;
+    DepthRegistration depthRegistration;
+
     FaceTracker faceTracker;
 
+    SoftwareCompositor compositor;
+
+    // Recording (F9): the window is read back a few frames late and encoded on the recorder's thread
+    VideoRecorder recorder;
+    FrameReadback readback;
+    std::deque<VideoRecorder::Frame*> recordInFlight;  // Slots for the readbacks in flight, oldest first
+
+    // Snapshots (F11): the buffers are copied on the render thread and written out on the writer's thread
+    SnapshotWriter snapshotWriter;
+    FrameReadback snapshotReadback;
+    SnapshotWriter::Snapshot* snapshotInFlight;     // Waiting for its screenshot readback
+    bool snapshotRequested;
+
+    // Shared memory output: the window is read back like for recording, straight into the shared slot
+    SharedFrameOutput sharedOutput;
+    FrameReadback sharedReadback;
+    std::deque<std::pair<int, cv::Size>> sharedInFlight;   // Slots (and window size) for the readbacks in flight, oldest first
+
+    // Playlist faces (F8): chosen on the render thread, and switched to by the deform stage
+    FaceAssetCache faceCache;
+    std::vector<std::string> facePlaylist;
+    int facePlaylistIndex;                          // -1 until F8 is first pressed
+    std::mutex faceMutex;
+    std::shared_ptr<const FaceAsset> nextFace;      // Guarded by faceMutex
+    std::shared_ptr<const FaceAsset> deformFace;    // Deform stage only: the face the model was last switched to
+
 private:
-    sf::Vector2f AnalyzeLevels(cv::Mat image);
     sf::Vector2f levelCorrection;
 
     sf::Vector2u initialSize;
@@ -95,16 +202,63 @@ private:
     FPSCounter fpsCounter;
     RunningAverage<unsigned int> trackReliability;
 
+    // Frame latency tracking (all in milliseconds)
+    FrameInfo frameInfo;            // Frame currently being displayed
+    FrameInfo trackedFrameInfo;     // Frame the current tracking result came from
+    uint64_t lastTrackedFrameIndex;
+    RollingStatistics<float> captureToTrackLatency;
+    RollingStatistics<float> trackToPresentLatency;
+    RollingStatistics<float> captureToPresentLatency;
+    RollingStatistics<float> trackingAge;
+
+    // Live metrics, see InitializeMetrics()
+    MetricsServer metricsServer;
+    Metrics::Counter* framesPresented;
+    Metrics::Counter* framesDropped;        // Captured but never displayed
+    Metrics::Counter* framesRepeated;       // Displayed more than once
+    Metrics::Histogram* frameTimeHistogram;
+    Metrics::Histogram* captureToTrackHistogram;
+    Metrics::Histogram* trackToPresentHistogram;
+    Metrics::Histogram* captureToPresentHistogram;
+    Metrics::Gauge* arenaUsedGauge;
+    Metrics::Gauge* frameHeapAllocationsGauge;
+    Metrics::Histogram* recordTimeHistogram;
+
+    // Capture -> convert -> track -> deform -> composite prep, then displayed by Draw()
+    Pipeline<FramePacket> pipeline;
+    FramePacket* current;   // Frame being displayed, held until a newer one comes out of the pipeline
+
+    // Render thread temporaries are allocated from here, and released at the start of each frame
+    // (each pipeline stage has its own arena)
+    FrameArena frameArena;
+    unsigned long long frameHeapAllocations;
+
     sf::Shader outlineShader;
+    sf::Shader sdfTextShader;
     sf::Shader blendShader;
+    sf::Shader blendshapeShader;        // blendshapes.vert with face-blend.frag
+    sf::Shader blendshapeWireShader;    // blendshapes.vert alone, for the wireframe
+    bool useBlendshapes;                // The face mesh is deformed on the GPU (see gpu_blendshapes)
 
     sf::Font fps_font;
     sf::Font font;
+    SdfFont sdfFont;
 
     sf::Texture depthTexture;
     sf::Texture colorTexture;
-
-    std::string GetTrackingStatus();
+    sf::RenderTexture ssfxTexture;      // Drawn to when ssfx_enabled, (re)created when the window is resized
+
+    // Status text (see DrawStatus), only rebuilt when it changes
+    HudLayer hud;
+    int hudFps;
+    int hudLatency;
+    int hudStatus;
+    int hudDistance;
+    int hudMemory;
+
+    // Tracking status text per HRESULT, so a failure isn't described again every frame
+    std::map<HRESULT, std::string> trackStatusText;
+    const std::string& GetTrackingStatus();
 
     float raw_depth;
 
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Micro-benchmarks for the per-frame processing stages.
+// Run with: VirtualMirror.exe --benchmark [name ...]
+// If no names are given, all benchmarks are run.
+// Returns nonzero if a benchmark's results were wrong (eg. a MISMATCH), or no names matched.
+namespace Benchmarks
+{
+    int Run(const std::vector<std::string>& names);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <string>
+
+struct CameraIntrinsics
+{
+    CameraIntrinsics() : width(0), height(0), fx(0), fy(0), cx(0), cy(0) {}
+
+    int   width, height;    // Image size the intrinsics apply to
+    float fx, fy;           // Focal length (pixels)
+    float cx, cy;           // Principal point (pixels)
+};
+
+// Intrinsics for the color and depth cameras, and the transform between them.
+// Loaded from an OpenCV FileStorage file, see resources\calibration\kinect.yml
+class CameraCalibration
+{
+public:
+    CameraCalibration();
+
+    bool Load(const std::string& filename);
+
+    CameraIntrinsics color;
+    CameraIntrinsics depth;
+
+    // Takes a point in the depth camera's frame to the color camera's frame (millimetres)
+    cv::Matx33f rotation;
+    cv::Vec3f   translation;
+};
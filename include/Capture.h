@@ -2,37 +2,63 @@
 
 #include <opencv2\core.hpp>
 #include <OpenNI.h>
-#include "utils\Runnable.h"
 
 #include "utils\FPSCounter.h"
+#include "utils\Metrics.h"
+#include "FramePacket.h"
+#include "FrameSynchronizer.h"
 
+#include <atomic>
 #include <mutex>
+#include <string>
 
-class Capture : public Runnable
+// Reads synchronized color/depth frame pairs from the camera (or a recording).
+// Read() is called repeatedly by the capture stage of the pipeline.
+class Capture
 {
 public:
     Capture();
     ~Capture();
 
-    void Initialize();
-    void Process();
+    // Opens the first camera, or a recording if replayFile is given
+    void Initialize(const std::string& replayFile = "");
 
-    //void GetFrame(cv::OutputArray color, cv::OutputArray depth);
-    void GetFrame(cv::Mat *color, cv::Mat *depth);
-    FPSCounter fpsCounter;
+    // Wait for the next matched color/depth pair and copy it into the packet.
+    // Returns false if nothing arrived within wait_timeout.
+    bool Read(FramePacket& packet);
+
+    void GetSyncStatistics(FrameSynchronizer::Statistics* stats);
+
+    // Resolution of the color stream (and of the registered depth), once initialized
+    cv::Size GetColorSize() const { return colorSize; }
+
+    // Safe to call from any thread
+    float GetAverageFps() const { return averageFps; }
 private:
-    void Run();
+    void UpdateSyncMetrics();
+
+    const int wait_timeout = 100;  // ms
 
-    
 
     // OpenNI device members
     openni::Device device;
     openni::VideoStream colorStream;
     openni::VideoStream depthStream;
-    openni::VideoFrameRef colorFrame;
-    openni::VideoFrameRef depthFrame;
+    cv::Size colorSize;
+    uint64_t frameIndex;
+
+    FPSCounter fpsCounter;          // Only touched by the thread calling Read()
+    std::atomic<float> averageFps;  // Copy for other threads
+
+    FrameSynchronizer synchronizer;
+    FrameSynchronizer::Statistics syncStatistics;   // Copy for other threads, guarded by mutex
+
+    std::mutex mutex;   // Guards syncStatistics
 
-    std::mutex mutex;
+    Metrics::Counter* framesCaptured;
+    Metrics::Gauge* timestampSkew;
+    Metrics::Counter* droppedColorFrames;
+    Metrics::Counter* droppedDepthFrames;
 
 
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include "CameraCalibration.h"
+
+// Warps a depth image into the color camera's frame, so that depth can be
+// sampled at the same pixel coordinates as the color image.
+//
+// Each depth pixel's ray (rotated into the color camera's frame) is precomputed
+// once, so per frame a pixel only needs a scale by its depth, a translation and
+// a projection. Where several depth pixels land on the same color pixel the
+// nearest wins. Color pixels that no depth pixel maps to are left as 0 (invalid).
+class DepthRegistration
+{
+public:
+    DepthRegistration();
+    ~DepthRegistration();
+
+    void Initialize(const CameraCalibration& calibration);
+
+    // depth is 16U in millimetres at the calibrated depth resolution,
+    // registered is 16U in millimetres at the calibrated color resolution.
+    void Apply(const cv::Mat& depth, cv::Mat& registered);
+
+    bool IsInitialized() const { return !rayX.empty(); }
+
+private:
+    void ApplyRow(const unsigned short* depth, int y, cv::Mat& registered);
+    void Splat(cv::Mat& registered, int u, int v, float z);
+
+    CameraIntrinsics color;
+    CameraIntrinsics depth;
+    cv::Vec3f translation;
+
+    // Per depth pixel ray direction in the color camera frame (ray.z * depth = color camera z)
+    cv::Mat rayX, rayY, rayZ;   // 32F, depth resolution
+};
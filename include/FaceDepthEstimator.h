@@ -0,0 +1,55 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+// Robust estimate of the distance to a face, from the depth pixels inside its bounding box.
+//
+// Sampling a single pixel is unreliable since depth images are full of holes, and
+// the corners of the face box usually contain background. Instead, valid depths in
+// the box are counted into a fixed histogram (one pass, no sorting), a fraction of
+// the nearest and farthest samples are trimmed off, and the median of what's left
+// is taken. The per-frame estimate is then smoothed over time.
+class FaceDepthEstimator
+{
+public:
+    FaceDepthEstimator();
+    ~FaceDepthEstimator();
+
+    // Trim fractions of the nearest and farthest samples. Background is always behind
+    // the face, so more is trimmed from the far end.
+    void SetTrim(float nearTrim, float farTrim);
+
+    // alpha is the exponential smoothing factor (1 = no smoothing). If the estimate jumps
+    // by more than snapDistance (mm) it's taken immediately, eg. when someone else steps in.
+    // The last estimate is held for holdFrames when the face has no valid depth.
+    void SetFilter(float alpha, float snapDistance, int holdFrames);
+
+    // depth is 16U in millimetres, registered to the image roi is in.
+    // Returns the filtered depth in millimetres, or NAN if unknown.
+    float Update(const cv::Mat& depth, const cv::Rect& roi);
+
+    // Unfiltered estimate for a single frame, or NAN if there are too few valid pixels
+    float Estimate(const cv::Mat& depth, const cv::Rect& roi) const;
+
+    void Reset();
+
+    float GetDepth() const { return depth; }
+    bool IsValid() const { return depth == depth; }
+
+    static const int MinDepth = 400;        // mm, nearest the Kinect can see
+    static const int MaxDepth = 4496;       // mm
+    static const int BinSize = 4;           // mm
+    static const int BinCount = (MaxDepth - MinDepth) / BinSize;
+
+private:
+    float nearTrim;
+    float farTrim;
+    int minValidPixels;
+
+    float alpha;
+    float snapDistance;
+    int holdFrames;
+
+    float depth;
+    int framesSinceValid;
+};
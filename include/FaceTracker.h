@@ -6,9 +6,16 @@
 #include <FaceTrackLib.h> // Part of the Microsoft Kinect Developer Toolkit
 #include "models\FaceModel.h"
 #include "models\CustomFaceModel.h"
+#include "CameraCalibration.h"
+#include "FaceDepthEstimator.h"
 
 #include <SFML\Graphics.hpp>
 
+#include "utils\Metrics.h"
+
+#include <utility>
+#include <vector>
+
 class ft_error : public std::runtime_error
 {
 public:
@@ -28,16 +35,19 @@ public:
     FaceTracker();
     ~FaceTracker();
 
-    void Initialize();
+    void Initialize(const CameraCalibration& calibration);
     void Uninitialize();
 
-    void Track(cv::Mat colorImage, cv::Mat depthImage);
+    // depthImage is the raw depth given to the face tracking library. registeredDepth (16U, mm,
+    // registered to the color image) is optional and used to estimate faceDepth.
+    void Track(cv::Mat colorImage, cv::Mat depthImage, cv::Mat registeredDepth = cv::Mat());
     HRESULT GetTrackStatus() { return (pFTResult != nullptr) ? pFTResult->GetStatus() : -1; }
 
     // Read-only!!
     bool            isTracked;
     bool            hasFace;
     RECT            faceRect;
+    float           faceDepth;      // Filtered distance to the face (mm), NAN if unknown
 
     float           scale;
     sf::Vector3f    rotation;
@@ -58,10 +68,26 @@ private:
     IFTImage*       pDepthImage = NULL;
     FT_SENSOR_DATA  sensorData;
 
+    cv::Mat         colorBuffer;
+    cv::Mat         depthBuffer;
+
+    FaceDepthEstimator depthEstimator;
+
     
     HRESULT         last_exc = S_OK;
 
     void            printTrackingState(std::string message, HRESULT hr);
+
+    // Tracking metrics. Failure counters for every known FT_ERROR code are
+    // registered up front so counting a failure never touches the registry.
+    void            InitializeMetrics();
+    void            CountFailure(HRESULT hr);
+
+    Metrics::Counter* trackAttempts = nullptr;
+    Metrics::Counter* trackSuccesses = nullptr;
+    Metrics::Counter* trackLost = nullptr;
+    std::vector<std::pair<HRESULT, Metrics::Counter*>> failureCounters;
+    Metrics::Counter* otherFailures = nullptr;
 };
 
 
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Metadata carried alongside a captured color/depth frame through the pipeline,
+// used to measure how stale the displayed frame (and face overlay) is.
+//
+// Host times are Profiler::Now() ticks, so they can be compared across threads.
+struct FrameInfo
+{
+    FrameInfo() :
+        frameIndex(0),
+        colorTimestamp(0),
+        depthTimestamp(0),
+        captureTime(0),
+        trackTime(0),
+        presentTime(0) {}
+
+    uint64_t    frameIndex;         // Increments for every frame read from the device (0 = no frame yet)
+
+    uint64_t    colorTimestamp;     // Device timestamps (microseconds, VideoFrameRef::getTimestamp)
+    uint64_t    depthTimestamp;
+
+    long long   captureTime;        // Host time the frames were read from the device
+    long long   trackTime;          // Host time the face tracker finished with the frame
+    long long   presentTime;        // Host time the frame was displayed
+};
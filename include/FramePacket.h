@@ -0,0 +1,64 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <Windows.h>
+#include <SFML\System\Vector2.hpp>
+#include <SFML\System\Vector3.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "FrameInfo.h"
+
+struct FaceAsset;
+
+// Everything known about one captured frame as it moves through the processing
+// pipeline (see Application::InitializePipeline). Each stage fills in its part.
+//
+// Packets are pooled and reused, so the buffers are allocated once.
+struct FramePacket
+{
+    FramePacket() :
+        color(480, 640, CV_8UC3),
+        depthRaw(480, 640, CV_16U),
+        isTracked(false),
+        trackStatus(E_FAIL),
+        faceDepth(0.0f),
+        scale(1.0f),
+        shapeUnitsVersion(0),
+        levelCorrection(0.0f, 1.0f) {}
+
+    FrameInfo info;
+
+    // Capture
+    cv::Mat color;                  // 8UC3 (RGB)
+    cv::Mat depthRaw;               // 16U (mm), as captured
+
+    // Convert
+    cv::Mat depthRegistered;        // 16U (mm), registered to the color image
+    cv::Mat depth;                  // 32F (mm), registered to the color image
+
+    // Track
+    bool            isTracked;
+    HRESULT         trackStatus;
+    cv::Rect        faceRect;       // Within image bounds
+    float           faceDepth;      // mm, NAN if unknown
+    float           scale;
+    sf::Vector3f    rotation;
+    sf::Vector3f    translation;
+    std::vector<float> actionUnits;
+    std::vector<float> shapeUnits;
+    unsigned int    shapeUnitsVersion;
+
+    // Deform
+    std::vector<float> vertices;    // Deformed face mesh, xyz per vertex
+    std::vector<float> coefficients;    // Or, when deformed in the vertex shader: the static then dynamic deformation coefficients
+    std::vector<float> detailVertices;  // The detailed face mesh driven by vertices, if one is loaded
+    std::shared_ptr<const FaceAsset> face;  // The face vertices are for, drawn with its mesh and texture (held, so it's pinned in the face cache); null if not tracked
+
+    // Composite prep
+    cv::Mat colorBGRA;              // Ready for texture upload
+    cv::Mat depthBGRA;              // Color mapped depth, ready for texture upload
+    sf::Vector2f levelCorrection;   // Luma correction for the face overlay
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <SFML\OpenGL.hpp>
+
+#include <vector>
+
+// Reads the framebuffer back to the CPU without stalling the render thread.
+//
+// Begin() queues a glReadPixels into a pixel buffer object, which the GPU
+// fills in the background; the pixels are collected with Collect() a frame or
+// two later, by which time the copy has finished and mapping the buffer doesn't
+// wait. Reads are collected in the order they were started.
+//
+// Pixel buffer objects are OpenGL 2.1; Initialize() returns false if they're
+// not available.
+class FrameReadback
+{
+public:
+    // buffers is the number of reads that can be in flight at once
+    FrameReadback(int buffers = 3);
+    ~FrameReadback();
+
+    // Needs the GL context to be current
+    bool Initialize();
+    void Release();
+
+    bool IsAvailable() const { return !pbos.empty(); }
+
+    // Start reading the lower-left width x height of the framebuffer.
+    // Returns false if every buffer is in use (Collect the oldest first).
+    bool Begin(int width, int height);
+
+    // Finish the oldest read: copy it into frame (8UC4 BGRA, bottom row first),
+    // or throw it away if frame is nullptr. Returns false if nothing is in flight.
+    bool Collect(cv::Mat* frame);
+
+    int GetPending() const { return pending; }
+    int GetBufferCount() const { return static_cast<int>(pbos.size()); }
+
+private:
+    FrameReadback(FrameReadback const&);
+    FrameReadback& operator =(FrameReadback const&);
+
+    struct Read {
+        int width;
+        int height;
+    };
+
+    int                 bufferCount;
+    std::vector<GLuint> pbos;
+    std::vector<Read>   reads;
+    std::vector<size_t> capacity;   // Bytes allocated for each buffer
+    int                 next;       // Buffer for the next Begin()
+    int                 pending;
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <OpenNI.h>
+
+#include "utils\RollingStatistics.h"
+
+#include <cstdint>
+#include <deque>
+
+// Pairs color and depth frames by device timestamp.
+//
+// The two streams run independently, so reading both whenever either has a new
+// frame can hand the tracker a pair captured at different instants. Instead,
+// frames from each stream are queued as they arrive, and a pair is only published
+// once the oldest frame's nearest partner in the other stream is found, and is
+// within the tolerance. Frames that can never be matched are dropped and counted.
+//
+// Frame is anything with a getTimestamp() in microseconds, so the pairing can be
+// checked offline with synthetic frames (see the "sync" benchmark). The capture
+// code uses FrameSynchronizer, for OpenNI frames.
+//
+// Not thread-safe, intended to be driven from the capture thread only.
+template<class Frame>
+class BasicFrameSynchronizer
+{
+public:
+    struct Statistics {
+        Statistics() : matched(0), droppedColor(0), droppedDepth(0),
+            skewMean(0), skewMedian(0), skew95(0), skewMax(0) {}
+
+        unsigned long long matched;
+        unsigned long long droppedColor;    // Unmatched color frames
+        unsigned long long droppedDepth;    // Unmatched depth frames
+
+        // Absolute timestamp difference of matched pairs over the recent window (milliseconds)
+        float skewMean;
+        float skewMedian;
+        float skew95;
+        float skewMax;
+    };
+
+    // tolerance is the largest timestamp difference (microseconds) that still counts as a pair,
+    // defaults to half a frame at 30fps. queueSize is the number of frames kept per stream.
+    BasicFrameSynchronizer(uint64_t tolerance = 16667, unsigned int queueSize = 4) :
+        tolerance(tolerance),
+        queueSize(queueSize),
+        matched(0),
+        droppedColor(0),
+        droppedDepth(0),
+        skew(256, 0.0, 50.0, 100)
+    {
+    }
+
+    void PushColor(const Frame& frame) {
+        Push(colorQueue, frame, droppedColor);
+        Match();
+    }
+
+    void PushDepth(const Frame& frame) {
+        Push(depthQueue, frame, droppedDepth);
+        Match();
+    }
+
+    // Returns the oldest matched pair, if any
+    bool Pop(Frame* color, Frame* depth) {
+        if (matchedQueue.empty())
+            return false;
+
+        *color = matchedQueue.front().color;
+        *depth = matchedQueue.front().depth;
+        matchedQueue.pop_front();
+        return true;
+    }
+
+    // Drop all queued frames, eg. when a replay loops back to the start
+    void Reset() {
+        droppedColor += colorQueue.size();
+        droppedDepth += depthQueue.size();
+        colorQueue.clear();
+        depthQueue.clear();
+        matchedQueue.clear();
+    }
+
+    uint64_t GetTolerance() const { return tolerance; }
+
+    void GetStatistics(Statistics* stats) const {
+        stats->matched = matched;
+        stats->droppedColor = droppedColor;
+        stats->droppedDepth = droppedDepth;
+        stats->skewMean = static_cast<float>(skew.GetMean());
+        stats->skewMedian = static_cast<float>(skew.GetPercentile(0.5));
+        stats->skew95 = static_cast<float>(skew.GetPercentile(0.95));
+        stats->skewMax = skew.GetMaximum();
+    }
+
+private:
+    struct Pair {
+        Frame color;
+        Frame depth;
+    };
+
+    static uint64_t Distance(uint64_t a, uint64_t b) {
+        return (a > b) ? (a - b) : (b - a);
+    }
+
+    void Push(std::deque<Frame>& queue, const Frame& frame, unsigned long long& dropped) {
+        // Timestamps going backwards means the stream restarted (eg. replay looped),
+        // so nothing queued from either stream can be paired with what comes next
+        if (!queue.empty() && frame.getTimestamp() < queue.back().getTimestamp())
+            Reset();
+
+        queue.push_back(frame);
+
+        // Don't hold on to frames forever if the other stream has stalled
+        while (queue.size() > queueSize) {
+            queue.pop_front();
+            dropped++;
+        }
+    }
+
+    void Match() {
+        while (!colorQueue.empty() && !depthQueue.empty()) {
+            // Look for a partner for the oldest queued frame. Every frame in the other
+            // queue is at least as new, so the front of the other queue is its nearest partner.
+            bool colorOldest = colorQueue.front().getTimestamp() <= depthQueue.front().getTimestamp();
+            std::deque<Frame>& oldest = colorOldest ? colorQueue : depthQueue;
+            std::deque<Frame>& other = colorOldest ? depthQueue : colorQueue;
+            unsigned long long& droppedOldest = colorOldest ? droppedColor : droppedDepth;
+
+            uint64_t t0 = oldest.front().getTimestamp();
+            uint64_t t1 = other.front().getTimestamp();
+            uint64_t d = t1 - t0;
+
+            if (d > tolerance) {
+                // Further frames in the other stream will only be later, so this can never be matched
+                oldest.pop_front();
+                droppedOldest++;
+                continue;
+            }
+
+            // If the next frame in the same stream is a closer partner, skip this one.
+            // (If it hasn't arrived yet, publish now rather than wait a frame for it.)
+            if (oldest.size() > 1 && Distance(oldest[1].getTimestamp(), t1) < d) {
+                oldest.pop_front();
+                droppedOldest++;
+                continue;
+            }
+
+            Pair pair;
+            pair.color = colorQueue.front();
+            pair.depth = depthQueue.front();
+            colorQueue.pop_front();
+            depthQueue.pop_front();
+
+            matched++;
+            skew.AddSample(static_cast<float>(d) / 1000.0f);
+
+            matchedQueue.push_back(pair);
+            while (matchedQueue.size() > queueSize)
+                matchedQueue.pop_front();
+        }
+    }
+
+    uint64_t tolerance;
+    unsigned int queueSize;
+
+    std::deque<Frame> colorQueue;
+    std::deque<Frame> depthQueue;
+    std::deque<Pair> matchedQueue;
+
+    unsigned long long matched;
+    unsigned long long droppedColor;
+    unsigned long long droppedDepth;
+    RollingStatistics<float> skew;
+};
+
+typedef BasicFrameSynchronizer<openni::VideoFrameRef> FrameSynchronizer;
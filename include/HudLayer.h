@@ -0,0 +1,76 @@
+#pragma once
+
+#include <SFML\Graphics.hpp>
+
+#include <string>
+#include <vector>
+
+#include "SdfFont.h"
+
+// Retained text overlay for the status display.
+//
+// Each label keeps its text and glyph quads between frames; SetText() only
+// rebuilds a label's quads when the text actually changes, and Draw() draws
+// every label's glyphs in a single draw call (so the outline shader runs once
+// for the whole HUD, rather than once per label).
+//
+// Glyph quads are laid out the same way as sf::Text. Text can come from a
+// regular font, or from a signed distance field atlas (drawn with sdf-text.frag)
+// so it can be scaled up and outlined in one texture fetch.
+class HudLayer
+{
+public:
+    enum Alignment {
+        AlignLeft,      // Position is the top-left of the text
+        AlignRight,     // Position is the top-right of the text
+    };
+
+    HudLayer();
+
+    // The font must outlive the HUD. Clears all labels.
+    void SetFont(const sf::Font& font, unsigned int characterSize);
+    void SetFont(const SdfFont& font, unsigned int characterSize);
+
+    // Returns the label's id, for SetText
+    int AddLabel(sf::Vector2f position, Alignment alignment = AlignLeft, sf::Color color = sf::Color::White);
+
+    void SetText(int label, const char* text);
+    void SetVisible(int label, bool visible);
+
+    void Draw(sf::RenderTarget& target, const sf::Shader* shader = nullptr);
+
+    // Times a label's glyphs have been laid out (for checking text is only rebuilt on change)
+    unsigned long long GetRebuildCount() const { return rebuildCount; }
+
+private:
+    struct Label {
+        sf::Vector2f            position;
+        Alignment               alignment;
+        sf::Color               color;
+        bool                    visible;
+        std::string             text;
+        std::vector<sf::Vertex> vertices;   // Glyph quads, positioned
+    };
+
+    // A glyph's quad relative to the pen position, and its texture rect
+    struct GlyphQuad {
+        float left, top, right, bottom;
+        float u1, v1, u2, v2;
+        float advance;
+    };
+
+    void Layout(Label& label);
+    GlyphQuad GetGlyph(sf::Uint32 c) const;
+    float GetKerning(sf::Uint32 first, sf::Uint32 second) const;
+    const sf::Texture* GetTexture() const;
+
+    const sf::Font*         font;           // One of these is set
+    const SdfFont*          sdfFont;
+    unsigned int            characterSize;
+    std::vector<Label>      labels;
+
+    std::vector<sf::Vertex> batch;          // All visible labels' quads
+    bool                    batchDirty;
+
+    unsigned long long      rebuildCount;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <SFML\Graphics.hpp>
+
+#include <map>
+#include <string>
+
+// Signed distance field glyph atlas, for text that stays sharp at any size and
+// gets its outline and glow from a single texture fetch (see sdf-text.frag).
+//
+// Generate() renders each glyph large with SFML, and stores the distance to
+// the glyph's edge in the atlas' alpha: 0.5 is on the edge, increasing inside
+// the glyph and decreasing outside, reaching 0 or 1 at spread pixels (of the
+// raster size) away. The atlas must be sampled with linear filtering.
+class SdfFont
+{
+public:
+    struct Glyph {
+        sf::FloatRect   bounds;         // Relative to the pen position on the baseline, in raster pixels (including the spread)
+        sf::IntRect     textureRect;    // In the atlas
+        float           advance;        // In raster pixels
+    };
+
+    SdfFont();
+
+    // Build the atlas for the given characters from font, which must outlive this (it's used for kerning).
+    // rasterSize is the character size glyphs are rendered at, and spread the distance (in pixels of that
+    // size) covered by the field, which limits how wide an outline or glow can be.
+    bool Generate(const sf::Font& font, unsigned int rasterSize = 64, int spread = 8,
+        const std::string& characters = DefaultCharacters());
+
+    // Glyph for a character; characters not in the atlas give an empty glyph
+    const Glyph& GetGlyph(sf::Uint32 c) const;
+    float GetKerning(sf::Uint32 first, sf::Uint32 second) const;
+
+    const sf::Texture& GetTexture() const { return texture; }
+    unsigned int GetRasterSize() const { return rasterSize; }
+    int GetSpread() const { return spread; }
+
+    // Printable ASCII
+    static std::string DefaultCharacters();
+
+private:
+    const sf::Font*                 font;
+    unsigned int                    rasterSize;
+    int                             spread;
+    std::map<sf::Uint32, Glyph>     glyphs;
+    Glyph                           empty;
+    sf::Texture                     texture;
+};
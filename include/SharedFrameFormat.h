@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+// Memory layout of the shared frame output (written by SharedFrameOutput, read
+// with SharedFrameReader), which lets other local processes use the mirror image
+// without going through the window.
+//
+// The named file mapping starts with a Header, followed by slotCount slots of
+// slotSize bytes. Each slot is a SlotHeader followed by the color, depth and
+// output images, at the offsets given in the Header. Frames are written to the
+// slots in turn, and Header::published counts the frames published so far, so
+// the latest is in slot (published - 1) % slotCount.
+//
+// Each slot is guarded by a sequence lock: the writer makes SlotHeader::sequence
+// odd before it changes the slot and even again when it's done. A reader notes
+// the (even) sequence, reads what it needs, and then checks the sequence hasn't
+// changed; if it has, the slot was overwritten and what it read is garbage. The
+// writer never waits for readers.
+//
+// Only fixed-size types are used, so it's the same for 32 and 64-bit processes.
+namespace SharedFrame
+{
+    const uint32_t Magic = 0x4D465356;      // "VSFM"
+    const uint32_t Version = 1;
+
+    const uint32_t MaxActionUnits = 16;
+    const uint32_t MaxShapeUnits = 32;
+
+    // Offsets of the images in a slot are aligned to this
+    const uint32_t Alignment = 64;
+
+    enum OutputFormat {
+        OutputNone = 0,     // No output image for this frame
+        OutputBGRA = 1,
+        OutputRGBA = 2,
+    };
+
+    struct Header {
+        uint32_t    magic;              // Magic, set last so a reader never sees a partly written header
+        uint32_t    version;
+        uint32_t    headerSize;         // Offset of slot 0 (sizeof(Header) rounded up to Alignment)
+        uint32_t    slotCount;
+        uint32_t    slotSize;           // Bytes per slot, including its SlotHeader
+
+        uint32_t    colorWidth;         // Size of the color (8UC3 RGB) and depth (16U mm, registered to color) images
+        uint32_t    colorHeight;
+        uint32_t    outputMaxWidth;     // Largest output image (8UC4) that fits in a slot
+        uint32_t    outputMaxHeight;
+
+        uint32_t    colorOffset;        // Offsets of the images from the start of a slot
+        uint32_t    depthOffset;
+        uint32_t    outputOffset;
+
+        volatile long published;        // Frames published (a long for the Interlocked functions)
+        uint32_t    reserved[3];
+    };
+
+    struct SlotHeader {
+        volatile long sequence;         // Odd while the slot is being written
+        uint32_t    reserved;
+
+        uint64_t    frameIndex;         // Increments for every frame read from the camera
+        uint64_t    colorTimestamp;     // Device timestamps (microseconds)
+        uint64_t    depthTimestamp;
+
+        // Tracking results for the frame
+        int32_t     isTracked;
+        int32_t     trackStatus;        // HRESULT
+        int32_t     faceRect[4];        // x, y, width, height in the color image
+        float       faceDepth;          // mm, NAN if unknown
+        float       scale;
+        float       rotation[3];        // Degrees
+        float       translation[3];
+        uint32_t    actionUnitCount;
+        uint32_t    shapeUnitCount;
+        float       actionUnits[MaxActionUnits];
+        float       shapeUnits[MaxShapeUnits];
+
+        // Composited output image
+        uint32_t    outputWidth;
+        uint32_t    outputHeight;
+        uint32_t    outputFormat;       // OutputFormat
+        uint32_t    outputBottomUp;     // Non-zero if the bottom row comes first (as read from OpenGL)
+    };
+}
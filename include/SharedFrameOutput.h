@@ -0,0 +1,67 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <Windows.h>
+
+#include <string>
+#include <vector>
+
+#include "FramePacket.h"
+#include "SharedFrameFormat.h"
+
+// Publishes frames to a named shared memory ring (see SharedFrameFormat.h) for
+// other processes to read with SharedFrameReader.
+//
+// Writing a frame is split in two so its output image can be read back from the
+// GPU a few frames late: Begin() claims a slot and fills in the captured images
+// and tracking results, and Publish() finishes it once the output image has been
+// written to GetOutput(). Several slots can be in flight and may be published in
+// any order, but frames always become the latest in the order they were begun:
+// a slot published early waits until every slot begun before it is published too.
+//
+// The writer never blocks: readers that are too slow find their frame
+// overwritten (see SharedFrameReader).
+class SharedFrameOutput
+{
+public:
+    SharedFrameOutput();
+    ~SharedFrameOutput();
+
+    // name is the file mapping's name, eg. "Local\\VirtualMirrorOutput".
+    // Fails if the sizes are invalid (slotCount must be at least 2, so one frame can
+    // be written while another is read), the mapping can't be created, or another
+    // process already has it.
+    bool Create(const std::string& name, int slotCount, int colorWidth, int colorHeight, int outputMaxWidth, int outputMaxHeight);
+    void Close();
+
+    bool IsOpen() const { return header != nullptr; }
+
+    // Claim the next slot and copy packet's images and tracking results into it.
+    // Returns the slot, or -1 if the output isn't open or too many slots are in flight.
+    int Begin(const FramePacket& packet);
+
+    // The slot's output image, width x height 8UC4, to be written in place.
+    // Empty if it's bigger than the maximum output size.
+    cv::Mat GetOutput(int slot, int width, int height);
+
+    // Finish the slot. It becomes the latest frame once the slots begun before it are published.
+    void Publish(int slot, int outputWidth, int outputHeight, SharedFrame::OutputFormat format, bool bottomUp);
+
+    int GetSlotCount() const { return IsOpen() ? static_cast<int>(header->slotCount) : 0; }
+
+private:
+    SharedFrameOutput(SharedFrameOutput const&);
+    SharedFrameOutput& operator =(SharedFrameOutput const&);
+
+    SharedFrame::SlotHeader* GetSlot(int slot) const;
+
+    HANDLE                  mapping;
+    unsigned char*          view;
+    SharedFrame::Header*    header;
+
+    long                    begun;          // Frames begun
+    long                    published;      // Frames published (made visible to readers)
+    std::vector<long>       slotFrame;      // Which frame (counting from 0) each slot is being written with
+    std::vector<bool>       slotFinished;   // Publish() was called, but an earlier slot is still in flight
+};
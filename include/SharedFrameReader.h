@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SharedFrameFormat.h"
+
+// Reads frames published by another process's SharedFrameOutput. Readers never
+// block the writer, and any number can be attached at once.
+//
+// Frames can be used in place:
+//
+//   SharedFrameReader::View view;
+//   if (reader.Latest(view)) {
+//       ... use view.color, view.depth, view.output ...
+//       if (!reader.Validate(view))
+//           ... the writer overwrote the slot meanwhile, so throw away what was read ...
+//   }
+//
+// or copied out with Read(), which retries until it gets a consistent copy.
+//
+// This only depends on Windows and SharedFrameFormat.h, so it can be dropped
+// into the processes that consume the frames.
+class SharedFrameReader
+{
+public:
+    // A published frame, in place in shared memory
+    struct View {
+        const SharedFrame::SlotHeader*  slot;
+        const unsigned char*            color;      // colorWidth x colorHeight, 8UC3 RGB
+        const uint16_t*                 depth;      // colorWidth x colorHeight, mm
+        const unsigned char*            output;     // slot->outputWidth x slot->outputHeight, 8UC4 (see slot->outputFormat)
+        long                            sequence;   // Of the slot when the view was taken
+        long                            frame;      // Count of frames published (this one included)
+    };
+
+    // A copy of a published frame
+    struct Frame {
+        SharedFrame::SlotHeader     info;
+        std::vector<unsigned char>  color;
+        std::vector<uint16_t>       depth;
+        std::vector<unsigned char>  output;
+        long                        frame;
+    };
+
+    SharedFrameReader();
+    ~SharedFrameReader();
+
+    // Attach to the mapping a SharedFrameOutput created. Fails if it doesn't exist
+    // (yet), or isn't a layout this reader understands.
+    bool Open(const std::string& name);
+    void Close();
+
+    bool IsOpen() const { return header != nullptr; }
+    const SharedFrame::Header* GetHeader() const { return header; }
+
+    // Take a view of the latest frame, if a newer one than the last returned has been published.
+    // Only valid until Validate fails.
+    bool Latest(View& view);
+
+    // True if the view's slot hasn't been overwritten since it was taken, so whatever was read
+    // from it before this call is consistent
+    bool Validate(const View& view) const;
+
+    // Copy the latest frame, if a newer one than the last returned has been published
+    bool Read(Frame& frame);
+
+    // Frames that were overwritten before they could be read consistently
+    unsigned long long GetTornCount() const { return tornCount; }
+
+private:
+    SharedFrameReader(SharedFrameReader const&);
+    SharedFrameReader& operator =(SharedFrameReader const&);
+
+    HANDLE                      mapping;
+    const unsigned char*        view;
+    const SharedFrame::Header*  header;
+
+    long                        lastFrame;      // Published count of the last frame returned
+    unsigned long long          tornCount;
+};
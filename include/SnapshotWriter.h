@@ -0,0 +1,75 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utils\BoundedQueue.h"
+#include "utils\Metrics.h"
+#include "utils\Runnable.h"
+
+// Saves snapshots (F11) to disk on a background thread, so taking one doesn't
+// hitch the render loop.
+//
+// The render thread copies the frame's buffers into a pooled snapshot from
+// Acquire() and hands it over with Submit(); color conversion, depth color
+// mapping and PNG encoding all happen on the writer thread. At most backlog
+// snapshots can be waiting: beyond that Acquire() returns nullptr and the
+// snapshot is skipped.
+//
+// A snapshot is written as
+//   <prefix>_color.png         color stream
+//   <prefix>_depthraw.png      depth in mm (16-bit)
+//   <prefix>_depth.png         normalized, color mapped depth
+//   <prefix>_screenshot.png    the window, if it was read back
+class SnapshotWriter : public Runnable
+{
+public:
+    struct Snapshot {
+        std::string prefix;             // Path and filename prefix
+
+        cv::Mat     color;              // 8UC3 (RGB)
+        cv::Mat     depth;              // 32F (mm), registered to the color image
+        cv::Mat     depthRaw;           // 16U (mm), as captured
+
+        cv::Mat     screenshot;         // Window contents (see screenshotConversion/flipScreenshot), or empty
+        int         screenshotConversion;   // cv::cvtColor code that converts screenshot to BGR
+        bool        flipScreenshot;     // True if screenshot is bottom row first (eg. read from OpenGL)
+    };
+
+    SnapshotWriter(size_t backlog);
+    ~SnapshotWriter();
+
+    // Render thread: take an empty snapshot to fill in, or nullptr if too many are
+    // still being written. Every acquired snapshot must be submitted or discarded.
+    Snapshot* Acquire();
+    void Submit(Snapshot* snapshot);
+    void Discard(Snapshot* snapshot);
+
+    // Snapshots submitted but not written yet
+    size_t GetPending() const { return queue.Size(); }
+
+private:
+    void Run();
+    void Write(Snapshot& snapshot);
+
+    std::vector<std::unique_ptr<Snapshot>> snapshots;
+    BoundedQueue<Snapshot*> pool;
+    BoundedQueue<Snapshot*> queue;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+
+    // Writer thread only
+    cv::Mat converted;
+    cv::Mat flipped;
+
+    Metrics::Counter* writtenCounter;
+    Metrics::Counter* skippedCounter;
+    Metrics::Histogram* writeHistogram;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <SFML\System\Vector2.hpp>
+#include <SFML\System\Vector3.hpp>
+
+#include <vector>
+
+#include "eru\Model.h"
+#include "models\FaceTexture.h"
+
+// Composites the textured face mesh onto a video frame on the CPU, as a
+// drop-in for drawing it with OpenGL and face-blend.frag (so it works without a
+// GL context, and can be tested and benchmarked headless).
+//
+// It follows the GL path as closely as it can: the same camera (Draw3D's
+// perspective and pose transforms), pixel-center sampling with a top-left fill
+// rule, perspective-correct texture coordinates, a depth test where the first of
+// equally near triangles wins, and the same luma-transfer blend and alpha as the
+// shader. Texels are sampled nearest from the face texture's top level, where GL
+// filters across its mip chain, so the two can differ slightly at texel edges.
+//
+// Rendering is deferred: triangles are rasterized to find the visible texel at
+// each pixel, then the blend is shaded 4 pixels at a time. The frame is split
+// into tiles which can be rendered in parallel, with identical output.
+class SoftwareCompositor
+{
+public:
+    // verticalFov is in degrees, as passed to gluPerspective
+    SoftwareCompositor(float verticalFov);
+    ~SoftwareCompositor();
+
+    // Face topology and texture coordinates. The mesh must have texture coordinates.
+    void SetMesh(eruFace::Model& mesh);
+
+    // Face texture (its top level is copied)
+    void SetTexture(const FaceTexture& faceTexture);
+
+    // Render the tiles on the task scheduler
+    void SetTileParallel(bool enable) { tileParallel = enable; }
+
+    // Draw the face into frame (8UC3 or 8UC4, RGB as captured). vertices are xyz per mesh vertex (from
+    // CustomFaceModel::Deform), rotation is in degrees, and lumaCorrect is the
+    // shader's lumaCorrect (see Application::AnalyzeLevels).
+    void Draw(cv::Mat& frame, const std::vector<float>& vertices,
+        sf::Vector3f rotation, sf::Vector3f translation, sf::Vector2f lumaCorrect);
+
+    static const int TileSize = 64;
+
+private:
+    // Screen-space triangle, ready to rasterize
+    struct Triangle {
+        float   x[3], y[3];     // Window coordinates (pixels, y down)
+        float   invW[3];        // 1/w, for perspective correction and depth
+        float   uw[3], vw[3];   // Texture coordinates divided by w
+        int     minX, minY, maxX, maxY;     // Pixel bounds (inclusive)
+    };
+
+    bool SetupTriangle(int face, Triangle& t) const;
+    void RasterizeTile(const cv::Rect& tile);
+    void ShadeTile(cv::Mat& frame, const cv::Rect& tile, sf::Vector2f lumaCorrect);
+
+    float verticalFov;
+    bool tileParallel;
+
+    // Mesh topology (3 indices per face) and per-vertex texture coordinates
+    std::vector<int>    indices;
+    std::vector<float>  texCoords;
+    int                 nVertices;
+
+    cv::Mat             texture;        // 8UC2, luma * alpha and alpha (as FaceTexture)
+
+    // Per frame
+    std::vector<float>      screen;     // x, y, 1/w per vertex
+    std::vector<Triangle>   triangles;
+
+    // Visible texel index per pixel (-1 = not covered), and its depth (1/w, 0 = far)
+    cv::Mat             texelIndex;     // 32S
+    cv::Mat             depthBuffer;    // 32F
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+#include <opencv2\videoio.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utils\BoundedQueue.h"
+#include "utils\Metrics.h"
+#include "utils\Runnable.h"
+
+// Records the composited output (and optionally the raw color/depth streams)
+// to disk on a background thread.
+//
+// The render thread takes an empty frame from a fixed pool with Acquire(),
+// fills it and hands it over with Submit(). Encoding happens on the writer
+// thread. If the writer falls behind the pool runs dry and Acquire() returns
+// nullptr, so frames are dropped rather than ever stalling the render loop.
+//
+// Each recording is written as
+//   <prefix>-<timestamp>_output.avi    composited output (MJPG)
+//   <prefix>-<timestamp>_color.avi     color stream (MJPG), if raw streams are recorded
+//   <prefix>-<timestamp>_depth.raw     depth stream, if raw streams are recorded: for each
+//                                      frame a uint64 frame index, uint32 width and height,
+//                                      then width*height 16-bit depths in mm
+class VideoRecorder : public Runnable
+{
+public:
+    struct Frame {
+        cv::Mat     output;             // Composited output (see outputConversion/flipOutput)
+        int         outputConversion;   // cv::cvtColor code that converts output to BGR
+        bool        flipOutput;         // True if output is bottom row first (eg. read from OpenGL)
+
+        cv::Mat     color;              // 8UC3 RGB as captured (only with raw streams)
+        cv::Mat     depthRaw;           // 16U (only with raw streams)
+        uint64_t    frameIndex;
+
+        unsigned int session;           // Recording the frame belongs to (set by Acquire)
+    };
+
+    VideoRecorder(size_t queueSize, double fps);
+    ~VideoRecorder();
+
+    // Start a new recording. Files are named after prefix (a path) and the current time.
+    void StartRecording(const std::string& prefix, bool rawStreams);
+    void StopRecording();
+
+    bool IsRecording() const { return recording; }
+    bool IsRecordingRawStreams() const { return rawStreams; }
+
+    // Render thread: take an empty frame to fill in, or nullptr if the writer is behind
+    // (in which case the frame is dropped). Every acquired frame must be submitted.
+    Frame* Acquire();
+    void Submit(Frame* frame);
+
+    // Hand back an acquired frame without recording it
+    void Discard(Frame* frame);
+
+    unsigned long long GetFramesWritten() const { return framesWritten; }
+    unsigned long long GetFramesDropped() const { return framesDropped; }
+
+private:
+    void Run();
+    void Write(Frame& frame);
+    void Open(const Frame& frame);
+    void Close();
+
+    double fps;
+
+    std::vector<std::unique_ptr<Frame>> frames;
+    BoundedQueue<Frame*> pool;
+    BoundedQueue<Frame*> queue;
+
+    std::atomic<bool> recording;
+    std::atomic<bool> rawStreams;
+    std::atomic<unsigned int> session;
+    std::atomic<unsigned long long> framesWritten;
+    std::atomic<unsigned long long> framesDropped;
+
+    std::mutex stateMutex;          // Guards filenamePrefix, and wakes the writer
+    std::condition_variable wake;
+    std::string filenamePrefix;
+
+    // Writer thread only
+    unsigned int openSession;
+    bool isOpen;
+    cv::Size outputSize;
+    cv::VideoWriter outputWriter;
+    cv::VideoWriter colorWriter;
+    std::ofstream depthFile;
+    cv::Mat converted;
+    cv::Mat flipped;
+
+    Metrics::Counter* writtenCounter;
+    Metrics::Counter* droppedCounter;
+    Metrics::Histogram* encodeHistogram;
+};
@@ -39,6 +39,7 @@ namespace eruFace
             inline eruFace::Vertex vertex( int v ) const { return _transformedCoords[v]; }
             inline eruFace::Vertex& imageCoord( int v ) { return _imageCoords[v]; }
             inline eruFace::Vertex imageCoords( int v ) const { return _imageCoords[v]; }
+            inline eruFace::Vertex baseCoord( int v ) const { return _baseCoords[v]; }
             inline int nVertices() const { return _baseCoords.nVertices(); }
 
             inline eruFace::Face& face( int f ) { return _faces[f]; }
@@ -52,8 +53,8 @@ namespace eruFace
             inline const Deformation& staticDeformation( int n ) const { return _staticDeformations[n]; }
             inline       Deformation& staticDeformation( int n ) { return _staticDeformations[n]; }
 
-            inline const int dynamicDeformationIndex(std::string name) { return _dynamicIndices.at(name); }
-            inline const int staticDeformationIndex(std::string name) { return _staticIndices.at(name); }
+            inline const int dynamicDeformationIndex(std::string name) const { return _dynamicIndices.at(name); }
+            inline const int staticDeformationIndex(std::string name) const { return _staticIndices.at(name); }
 
             void       setDynamicParam( int, double );
             double     getDynamicParam( int ) const;
@@ -64,6 +65,12 @@ namespace eruFace
             bool       updateStatic();
             bool       updateDynamic();
 
+            // Dynamic parameter changes smaller than the epsilon are ignored. Changes
+            // are otherwise applied as deltas to the dynamic coords, and a full rebuild
+            // from the static coords is done every rebuildInterval incremental updates
+            // to bound accumulated floating point drift.
+            void       setDynamicUpdatePolicy( double epsilon, int rebuildInterval );
+
             // Global transform (pose)
             void       setGlobal          (const eruMath::Vector3d& r, double s, const eruMath::Vector3d& t)          { _rotation = r; _scale = s; _translation = t;         }
             void       setGlobal          (const eruMath::Vector3d& r, const eruMath::Vector3d& s, const eruMath::Vector3d& t)	{ _rotation = r; _scale = s; _translation = t;         }
@@ -97,6 +104,7 @@ namespace eruFace
             void       setSmdFilename     (const char*);
 
             // Copying
+            void       copyAll            (const Model&);     // Everything (copies are otherwise private, so none are made by accident)
             void       copyTexCoords      (const Model&);
             void       copyTexCoordsFromVertices (const Model&);
             void       copyStaticParams   (const Model&);
@@ -110,7 +118,7 @@ namespace eruFace
             //virtual void copyTexture      (const eruImg::Image& newTex, const char* fname);
             //bool       fixTexCoords       (double viewPortWidth, double viewPortHeight);
             //bool       hasTexture         ()               { return (_texture.Valid() && hasTexCoords()); }
-            bool       hasTexCoords       ()               { return _texCoords.size()>0; }
+            bool       hasTexCoords       () const         { return _texCoords.size()>0; }
             //int        getTexWidth        ()               { return _texture.Width(); }
             //int        getTexHeight       ()               { return _texture.Height(); }
             //void       initTexture        ( int w, int h, int t ) { _texture.Init( w, h, t ); }
@@ -122,9 +130,16 @@ namespace eruFace
             friend std::istream& operator >>   (std::istream&, Model&);
             friend std::ostream& operator <<   (std::ostream&, const Model&);
 
+            // False if the file can't be read or (for .wfm) is malformed, in which case the
+            // model is left empty and the error, with its line, is written to std::cerr
             bool       read               ( const std::string& );
             bool       read               ( std::istream& );
 
+            // Parses a whole .wfm file held in memory, in a single pass. Throws
+            // std::runtime_error naming the source and line on malformed input
+            // (read() catches it), leaving the model partly parsed.
+            void       parse              ( const std::string& text, const std::string& source = "wfm" );
+
             virtual bool readTexture      ( const std::string& );
             bool       write              ( const std::string& );
             bool       writeVRML          ( const std::string& );
@@ -140,6 +155,8 @@ namespace eruFace
 
             std::vector<Deformation> _dynamicDeformations;
             std::vector<double>      _dynamicParams;
+            std::vector<double>      _dynamicParamsApplied;  // Params currently baked into _dynamicCoords
+            std::vector<bool>        _dynamicParamsDirty;
             std::unordered_map<std::string, int> _dynamicIndices;
             
             std::vector<Deformation> _staticDeformations;
@@ -152,8 +169,13 @@ namespace eruFace
             eruMath::Matrix   _transform;
 
             bool _staticParamsModified;
-            bool _dynamicParamsModified;
+            bool _dynamicParamsModified;    // Full rebuild of _dynamicCoords required
+            bool _dynamicParamsDirtyAny;    // At least one param needs a delta applied
             bool _transformModified;
+
+            double _dynamicParamEpsilon;
+            int    _dynamicRebuildInterval;
+            int    _dynamicIncrementalUpdates;
             bool _newTexture;
 
             std::vector<TexCoord> _texCoords;
@@ -182,6 +204,9 @@ namespace eruFace
             void       readTexCoords      ( std::istream& );
             void       readGlobal         ( std::istream& );
 
+            void       indexDynamicDeformations();
+            void       indexStaticDeformations();
+
             bool       writeAMD           ( std::ostream& ) const;
             bool       writeSMD           ( std::ostream& ) const;
 
@@ -44,14 +44,14 @@ namespace eru {
   /// \brief Get the next line from a stream.
   ///
   /// The line is read to and returned as a string.
-  /// A maximum of 10000 empty lines is ignored.
+  /// Empty lines are skipped; an empty string is returned at the end of the stream.
   
 	inline std::string getNextLine(std::istream& is) {
 		std::string line;
 		//is.ignore(10000, '\n');
 		do {
 			std::getline(is, line);
-		}while(line.length() == 0);
+		}while(line.length() == 0 && is);
 		return line;
 	}
 
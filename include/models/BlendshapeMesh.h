@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Windows.h>
+#include <SFML\OpenGL.hpp>
+
+#include <vector>
+
+#include "eru\Model.h"
+
+// The face mesh and its deformations in GPU memory, deformed in the vertex
+// shader (blendshapes.vert) rather than on the CPU.
+//
+// Initialize() uploads the base vertices, texture coordinates and faces, and
+// every deformation's displacements (static ones first, then dynamic), once.
+// Each frame Draw() only uploads the deformation coefficients, so the CPU to GPU
+// traffic depends on the number of parameters rather than the number of vertices.
+//
+// The displacements are stored per vertex in a float texture, each texel being
+// (deformation, dx, dy, dz); a vertex's second texture coordinate is the first
+// texel of its run and the run's length. Needs OpenGL 2.0 with vertex texture
+// fetch and float textures; Initialize() returns false if they're not available.
+class BlendshapeMesh
+{
+public:
+    static const int MaxDeformations = 256;     // Static and dynamic, as MAX_DEFORMATIONS in blendshapes.vert
+    static const int DisplacementUnit = 7;      // Texture unit for the displacements (sf::Shader uses them from 1 up)
+
+    BlendshapeMesh();
+    ~BlendshapeMesh();
+
+    // Needs the GL context to be current
+    bool Initialize(const eruFace::Model& model);
+    void Release();
+
+    bool IsAvailable() const { return vertexBuffer != 0; }
+
+    // Number of coefficients Draw() expects: the model's static deformations, then its dynamic ones
+    int GetCoefficientCount() const { return coefficientCount; }
+
+    // Draw the deformed mesh with the current modelview/projection. A shader built
+    // from blendshapes.vert must be bound (eg. with sf::Shader::bind).
+    void Draw(const std::vector<float>& coefficients);
+
+private:
+    // Where a shader program's uniforms are, looked up the first time it's drawn with
+    struct ProgramUniforms {
+        GLint   program;
+        GLint   coefficients;
+    };
+
+    const ProgramUniforms& GetUniforms(GLint program);
+
+    GLuint              vertexBuffer;       // Per vertex: base position, texture coordinate, displacement run
+    GLuint              indexBuffer;
+    GLuint              displacementTexture;
+    int                 displacementWidth;
+    int                 displacementHeight;
+    int                 indexCount;
+    int                 coefficientCount;
+
+    float               modelTransform[16]; // The model's global scale, rotation and translation (column major)
+    std::vector<float>  packed;             // Coefficients, padded to whole vec4s
+    std::vector<ProgramUniforms> programs;
+};
@@ -0,0 +1,25 @@
+// Generated by scripts/embed_wfm.py from resources/faces/candide3_textured.wfm. Do not edit.
+#pragma once
+
+// candide3_textured.wfm, compiled in for FixedFaceKernel
+struct Candide3Mesh
+{
+    static const int VertexCount = 113;
+    static const int FaceCount = 184;
+    static const int DynamicCount = 65;
+    static const int DynamicDisplacementCount = 257;
+    static const int StaticCount = 14;
+    static const int StaticDisplacementCount = 241;
+
+    static const float BaseCoords[VertexCount * 3];
+    static const int Faces[FaceCount * 3];
+
+    // One entry per displacement: the deformation it belongs to, its vertex, and xyz
+    static const int DynamicDeformation[DynamicDisplacementCount];
+    static const int DynamicVertex[DynamicDisplacementCount];
+    static const float DynamicDisplacement[DynamicDisplacementCount * 3];
+
+    static const int StaticDeformation[StaticDisplacementCount];
+    static const int StaticVertex[StaticDisplacementCount];
+    static const float StaticDisplacement[StaticDisplacementCount * 3];
+};
@@ -4,9 +4,18 @@
 #include <Windows.h>
 #include <FaceTrackLib.h> // Part of the Microsoft Kinect Developer Toolkit
 
+#include <memory>
 #include <vector>
 
 #include "eru\Model.h"
+#include "models\BlendshapeMesh.h"
+#include "models\Candide3Mesh.h"
+#include "models\FaceAssetCache.h"
+#include "models\FaceTexture.h"
+#include "models\FixedFaceKernel.h"
+#include "models\LoopSubdivision.h"
+#include "models\MeshTransfer.h"
+#include "models\ShapeUnitCache.h"
 #include <SFML\Graphics.hpp>
 
 class CustomFaceModel : public FaceModel
@@ -17,17 +26,113 @@ public:
 
     bool LoadMesh(std::string filename);
 
+    // Or from a face already loaded (eg. by FaceAssetCache), with its texture uploaded. The mesh
+    // is copied, and the face is kept for its texture.
+    bool LoadMesh(std::shared_ptr<const FaceAsset> face);
+
+    // Where preprocessed face textures are cached (see FaceTexture). Set before loading meshes.
+    void SetTextureCache(const std::string& directory) { textureCacheDirectory = directory; }
+
+    // Whether the tracker can drive face (it has every deformation the AUs/SUs map to)
+    static bool CanDrive(const eruFace::Model& face);
+
+    // Deform a copy of face (eg. from FaceAssetCache) instead of the mesh loaded so far, which must
+    // be able to drive it. Like Deform(), this can be called from a different thread to UpdateParameters,
+    // but nothing else may be using the mesh meanwhile. Its texture is the caller's to draw with.
+    void SetFace(const eruFace::Model& face);
+
+    // Load a high resolution face mesh (.wfm) to draw instead of the tracked one, driven by it
+    // (see MeshTransfer). It must be modelled over the tracked mesh as loaded, after each file's
+    // global transform. Its texture is its own, or the tracked mesh's if it doesn't name one.
+    bool LoadDetailMesh(std::string filename);
+
+    // Or instead, draw the tracked mesh Loop subdivided (1 to LoopSubdivision::MaxLevels times), with its texture
+    bool SubdivideMesh(int levels);
+
+    // Either of the above, drawn with TransferToDetail() and DrawDetailGL()
+    bool HasDetailMesh() const { return transfer.IsBound() || subdivision.IsBuilt(); }
+
     void Initialize(IFTFaceTracker* pFaceTracker);
-    void UpdateModel(IFTResult* pFTResult, FT_CAMERA_CONFIG* pCameraConfig);
+
+    // Read the AUs (and SUs, until they've converged) for the tracked face into
+    // actionUnits/shapeUnits. Must be called from the tracking thread.
+    void UpdateParameters(IFTResult* pFTResult);
+
+    // Deform the mesh with the given parameters, and copy out the resulting vertices
+    // (xyz per vertex). Shape units are only re-applied when shapeUnitsVersion changes.
+    // This can run on a different thread to UpdateParameters. The compiled in Candide-3
+    // kernel is used if the mesh is Candide-3, in which case mesh's own vertices are left at rest.
+    void Deform(const std::vector<float>& actionUnits, const std::vector<float>& shapeUnits,
+        unsigned int shapeUnitsVersion, std::vector<float>* vertices);
+
+    // Instead of Deform(): the coefficients for the blendshapes to deform the mesh in the vertex
+    // shader, the same as Deform() would on the CPU (static then dynamic deformations). Leaves the mesh alone.
+    void GetCoefficients(const std::vector<float>& actionUnits, const std::vector<float>& shapeUnits,
+        std::vector<float>* coefficients) const;
+
+    // The detailed (or subdivided) mesh's vertices (xyz per vertex) for vertices from Deform()
+    void TransferToDetail(const std::vector<float>& vertices, std::vector<float>* detailVertices) const;
+
+    // Incremented whenever shapeUnits changes
+    unsigned int GetShapeUnitsVersion() const { return shapeUnitsVersion; }
+
+    // Load (or create on convergence) the cached shape units for a user
+    void SetUserProfile(std::string filename);
+
+    // Called when the tracked face is lost, so the SUs of the next person are re-evaluated
+    void ResetShapeUnits();
 
     virtual void DrawGL();
 
+    // Draw the mesh with vertices from Deform()
+    void DrawGL(const std::vector<float>& vertices);
+
+    // Draw with vertices from Deform() and the faces/texture coordinates of topology, the mesh they
+    // were deformed as (so the mesh itself can be switched with SetFace() meanwhile)
+    static void DrawGL(const std::vector<float>& vertices, const eruFace::Model& topology);
+
+    // Draw the detailed (or subdivided) mesh with vertices from TransferToDetail()
+    void DrawDetailGL(const std::vector<float>& detailVertices);
+
+    // Draw the mesh deformed on the GPU with coefficients from GetCoefficients(). Needs
+    // blendshapes to be initialized, and a shader built from blendshapes.vert to be bound.
+    void DrawBlendshapes(const std::vector<float>& coefficients);
+
     eruFace::Model      mesh;
-    sf::Texture         texture;
+    BlendshapeMesh      blendshapes;    // The mesh in GPU memory, when deforming it in the vertex shader
+    ShapeUnitCache      suCache;
+
+    // The loaded face's texture, and what it was uploaded from (also for software compositing)
+    const sf::Texture&  GetTexture() const { return loadedFace->texture; }
+    const FaceTexture&  GetFaceTexture() const { return loadedFace->faceTexture; }
+
+    eruFace::Model      detailMesh;     // See LoadDetailMesh
+    sf::Texture         detailTexture;
 
 private:
+    void                ApplyShapeUnits(const std::vector<float>& shapeUnits);
+    void                MapParameters();
+
     bool                hasModel;
 
+    std::shared_ptr<const FaceAsset> loadedFace;    // See LoadMesh
+
+    std::string         profileFilename;
+    std::string         textureCacheDirectory;
+
+    unsigned int        shapeUnitsVersion;
+    unsigned int        appliedShapeUnitsVersion;
+    bool                shapeUnitsApplied;      // False when the mesh has been switched since
+
+    FixedFaceKernel<Candide3Mesh> candide3;
+    bool                useCandide3;    // The mesh matches candide3's tables
+
+    MeshTransfer        transfer;
+    LoopSubdivision     subdivision;
+    int                 detailVertexCount;
+    std::vector<float>  detailTexCoords;    // uv per vertex, for drawing the detailed mesh as vertex arrays
+    std::vector<GLuint> detailIndices;
+
     std::vector<int>    su_map;
     std::vector<int>    au_map;
 
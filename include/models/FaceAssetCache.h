@@ -0,0 +1,132 @@
+#pragma once
+
+#include <SFML\Graphics\Texture.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "eru\Model.h"
+#include "models\FaceTexture.h"
+#include "utils\Metrics.h"
+#include "utils\Runnable.h"
+
+// A replacement face from the library: its mesh and texture, as loaded
+struct FaceAsset
+{
+    FaceAsset() : uploaded(false) {}
+
+    std::string     filename;       // The .wfm it was loaded from
+    eruFace::Model  mesh;           // Never deformed (CustomFaceModel::SetFace takes a copy)
+    FaceTexture     faceTexture;    // Preprocessed, see FaceTexture
+    sf::Texture     texture;        // faceTexture on the GPU, when uploaded
+    bool            uploaded;
+
+private:
+    FaceAsset(FaceAsset const&);
+    FaceAsset& operator =(FaceAsset const&);
+};
+
+// Keeps a library of replacement faces (by .wfm filename) within a memory budget,
+// so only the faces in use, or about to be, are resident however large the
+// library is.
+//
+// Meshes and preprocessed textures count against the CPU budget, and uploaded
+// textures against the GPU budget. Past either budget, the least recently used
+// faces are evicted: their GL textures first (uploading them again from the
+// preprocessed copy is cheap), then the faces themselves. A face is pinned while
+// anything outside the cache holds it (eg. the FramePackets drawn with it), and
+// pinned faces are never evicted, so they alone can take the cache over budget.
+//
+// Prefetch() queues faces, eg. the next ones in a playlist, to be read on a loader
+// thread so Acquire() finds them resident. The loader only reads files: textures
+// are uploaded, and faces evicted, by Acquire() and Update(), which must be called
+// from the thread with the GL context.
+class FaceAssetCache : public Runnable
+{
+public:
+    struct Statistics {
+        unsigned long long  hits;
+        unsigned long long  misses;             // Including faces still being prefetched
+        unsigned long long  evictions;          // Whole faces
+        unsigned long long  textureEvictions;   // GL textures only
+        unsigned long long  prefetches;         // Faces loaded on the loader thread
+        unsigned long long  failures;
+        size_t              cpuBytes;
+        size_t              gpuBytes;
+        int                 faces;              // Resident (or loading)
+        int                 pinned;
+    };
+
+    // name labels the cache's metrics (cache="name")
+    FaceAssetCache(const std::string& name, size_t cpuBudget, size_t gpuBudget);
+    ~FaceAssetCache();
+
+    // Where preprocessed face textures are cached (see FaceTexture). Set before loading any faces.
+    void SetTextureCache(const std::string& directory) { textureCacheDirectory = directory; }
+
+    // Render thread: the face, with its texture uploaded. If it isn't resident it's
+    // loaded here (or waited for, if it's being prefetched). nullptr if it can't be loaded.
+    std::shared_ptr<const FaceAsset> Acquire(const std::string& filename);
+
+    // Load these faces in the background, in order, instead of any still waiting to be
+    // prefetched. Those already resident are marked as recently used.
+    void Prefetch(const std::vector<std::string>& filenames);
+
+    // Render thread, once a frame: upload one prefetched texture (if it fits the budget),
+    // and evict down to the budgets
+    void Update();
+
+    bool IsResident(const std::string& filename) const;
+    Statistics GetStatistics() const;
+
+private:
+    struct Entry {
+        std::string                 filename;
+        std::shared_ptr<FaceAsset>  asset;      // nullptr while loading
+        size_t                      cpuBytes;
+        size_t                      gpuBytes;   // 0 unless uploaded
+    };
+    typedef std::list<Entry> EntryList;
+
+    void Run();
+
+    // Read a face (any thread, without the lock), and add it to its loading entry (with the lock)
+    std::shared_ptr<FaceAsset> Load(const std::string& filename) const;
+    void Finish(const std::string& filename, const std::shared_ptr<FaceAsset>& asset);
+
+    bool Upload(const std::shared_ptr<FaceAsset>& asset);
+    void Evict();
+
+    static bool IsPinned(const Entry& entry) { return entry.asset.use_count() > 1; }
+    static size_t TextureBytes(const FaceTexture& texture);
+    static size_t MeshBytes(const eruFace::Model& mesh);
+
+    const size_t cpuBudget;
+    const size_t gpuBudget;
+    const std::string metricLabels;
+    std::string textureCacheDirectory;
+
+    mutable std::mutex entriesMutex;
+    std::condition_variable loaded;     // A face finished loading
+    std::condition_variable wake;       // Something to prefetch, or stopping
+
+    EntryList entries;      // Most recently used first
+    std::unordered_map<std::string, EntryList::iterator> index;
+    std::deque<std::string> prefetchQueue;
+    size_t cpuBytes;
+    size_t gpuBytes;
+
+    Metrics::Counter* hitCounter;
+    Metrics::Counter* missCounter;
+    Metrics::Counter* evictionCounter;
+    Metrics::Counter* textureEvictionCounter;
+    Metrics::Counter* prefetchCounter;
+    Metrics::Counter* failureCounter;
+};
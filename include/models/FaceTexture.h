@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <SFML\Graphics\Texture.hpp>
+#include <SFML\System\Vector2.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A face texture, preprocessed into what face-blend.frag (and SoftwareCompositor)
+// actually use of it: its luma premultiplied by alpha, and its alpha. Two bytes per texel, with a mip chain of
+// box filtered levels (which is correct for premultiplied texels).
+//
+// Preprocessing decodes and analyzes the whole image, so the result is kept in a
+// cache file named by a hash of the image's contents. Later loads of the same image
+// map that file instead, and uploading it is just handing each level to GL.
+class FaceTexture
+{
+public:
+    static const int HistogramSize = 256;
+    static const int MaxLevels = 16;
+
+    FaceTexture();
+    ~FaceTexture();
+
+    // Load an image file, preprocessed. With a cache directory, the preprocessed texture
+    // is mapped from there if it has been cached, and written there if not.
+    bool Load(const std::string& filename, const std::string& cacheDirectory = "");
+    void Release();
+
+    bool IsLoaded() const { return header != nullptr; }
+    bool WasCached() const { return cached; }   // Mapped from the cache, rather than preprocessed
+
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetLevelCount() const;
+    int GetLevelWidth(int level) const;
+    int GetLevelHeight(int level) const;
+
+    // A level's texels (rows packed): luma * alpha, alpha
+    const unsigned char* GetLevel(int level) const;
+
+    // Histogram of the image's luma (over texels with any alpha), and its 1%/99% levels (0-1).
+    // The texels aren't normalized to these, the blend shader draws the luma as is.
+    const uint32_t* GetHistogram() const;
+    sf::Vector2f GetLumaRange() const;
+
+    // (Re)create texture as a luminance/alpha texture with the mip chain, filtered trilinearly.
+    // Needs a GL context, as sf::Texture does.
+    bool Upload(sf::Texture& texture) const;
+
+    // The cache file for an image whose contents hash to hash
+    static std::string GetCacheFilename(const std::string& cacheDirectory, uint64_t hash);
+
+private:
+    FaceTexture(FaceTexture const&);
+    FaceTexture& operator =(FaceTexture const&);
+
+    // Cache file layout: this header, then the levels
+    struct FileHeader {
+        uint32_t    magic;
+        uint32_t    version;
+        uint64_t    sourceHash;     // Of the image file's contents
+        uint32_t    width;
+        uint32_t    height;
+        uint32_t    levelCount;
+        float       lumaLow;
+        float       lumaHigh;
+        uint32_t    histogram[HistogramSize];
+        uint32_t    levelOffsets[MaxLevels];    // From the start of the file
+        uint32_t    fileSize;
+    };
+
+    bool Map(const std::string& cacheFile, uint64_t hash);
+    bool Preprocess(const std::vector<char>& image, uint64_t hash);
+    bool Write(const std::string& cacheDirectory) const;
+
+    HANDLE                      file;       // When mapped from the cache
+    HANDLE                      mapping;
+    const unsigned char*        view;
+    std::vector<unsigned char>  buffer;     // When preprocessed
+
+    const FileHeader*           header;     // In view or buffer
+    bool                        cached;
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cmath>
+
+#include "eru\Model.h"
+
+// Deforms and poses a face mesh whose tables are compiled in (Mesh, eg. Candide3Mesh,
+// from scripts/embed_wfm.py) as eruFace::Model does: static deformations, dynamic
+// deformations, then scale, rotation and translation.
+//
+// Every loop's trip count is a compile time constant and the coordinates are flat
+// float arrays, so the compiler can unroll the displacement loops and vectorize the
+// transform. The parameters and pose are read from a Model holding the same mesh
+// (see Matches()), so it can stand in for the Model's own update.
+template<class Mesh>
+class FixedFaceKernel
+{
+public:
+    static const int VertexCount = Mesh::VertexCount;
+
+    FixedFaceKernel() {
+        for (int i = 0; i < VertexCount * 3; i++)
+            staticCoords[i] = Mesh::BaseCoords[i];
+    }
+
+    // Whether model was loaded from the same mesh as the tables (vertices, faces and deformations)
+    static bool Matches(const eruFace::Model& model) {
+        const double tolerance = 1e-6;
+
+        if (model.nVertices() != Mesh::VertexCount || model.nFaces() != Mesh::FaceCount ||
+            model.nDynamicDeformations() != Mesh::DynamicCount || model.nStaticDeformations() != Mesh::StaticCount)
+            return false;
+
+        for (int i = 0; i < Mesh::VertexCount; i++) {
+            auto v = model.baseCoord(i);
+            for (int j = 0; j < 3; j++) {
+                if (fabs(v[j] - Mesh::BaseCoords[i * 3 + j]) > tolerance)
+                    return false;
+            }
+        }
+
+        for (int f = 0; f < Mesh::FaceCount; f++) {
+            auto face = model.face(f);
+            for (int j = 0; j < 3; j++) {
+                if (face[j] != Mesh::Faces[f * 3 + j])
+                    return false;
+            }
+        }
+
+        return MatchesDeformations(model, false, Mesh::DynamicDeformation, Mesh::DynamicVertex, Mesh::DynamicDisplacement, Mesh::DynamicDisplacementCount) &&
+            MatchesDeformations(model, true, Mesh::StaticDeformation, Mesh::StaticVertex, Mesh::StaticDisplacement, Mesh::StaticDisplacementCount);
+    }
+
+    // Apply the model's static parameters (only needed when they change)
+    void UpdateStatic(const eruFace::Model& model) {
+        float params[Mesh::StaticCount];
+        for (int i = 0; i < Mesh::StaticCount; i++)
+            params[i] = static_cast<float>(model.getStaticParam(i));
+
+        for (int i = 0; i < VertexCount * 3; i++)
+            staticCoords[i] = Mesh::BaseCoords[i];
+
+        for (int k = 0; k < Mesh::StaticDisplacementCount; k++) {
+            float p = params[Mesh::StaticDeformation[k]];
+            float* v = &staticCoords[Mesh::StaticVertex[k] * 3];
+            v[0] += p * Mesh::StaticDisplacement[k * 3 + 0];
+            v[1] += p * Mesh::StaticDisplacement[k * 3 + 1];
+            v[2] += p * Mesh::StaticDisplacement[k * 3 + 2];
+        }
+    }
+
+    // Apply the model's dynamic parameters and pose to the static coords, writing
+    // VertexCount xyz vertices (as Model::updateGlobal() then Model::vertex())
+    void Deform(const eruFace::Model& model, float* vertices) {
+        float params[Mesh::DynamicCount];
+        for (int i = 0; i < Mesh::DynamicCount; i++)
+            params[i] = static_cast<float>(model.getDynamicParam(i));
+
+        for (int i = 0; i < VertexCount * 3; i++)
+            dynamicCoords[i] = staticCoords[i];
+
+        for (int k = 0; k < Mesh::DynamicDisplacementCount; k++) {
+            float p = params[Mesh::DynamicDeformation[k]];
+            float* v = &dynamicCoords[Mesh::DynamicVertex[k] * 3];
+            v[0] += p * Mesh::DynamicDisplacement[k * 3 + 0];
+            v[1] += p * Mesh::DynamicDisplacement[k * 3 + 1];
+            v[2] += p * Mesh::DynamicDisplacement[k * 3 + 2];
+        }
+
+        // Scale then rotate (as VertexSet::rotate) as one matrix, then translate
+        eruMath::Vector3d r, s, t;
+        model.getGlobal(r, s, t);
+        double cx = cos(r[0]), sx = sin(r[0]);
+        double cy = cos(r[1]), sy = sin(r[1]);
+        double cz = cos(r[2]), sz = sin(r[2]);
+        const double rotation[9] = {
+            cz * cy, -sz * cx - cz * sy * sx,  sz * sx - cz * sy * cx,
+            sz * cy,  cz * cx - sz * sy * sx, -cz * sx - sz * sy * cx,
+            sy,       cy * sx,                 cy * cx,
+        };
+
+        float m[9];
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 3; col++)
+                m[row * 3 + col] = static_cast<float>(rotation[row * 3 + col] * s[col]);
+        }
+        float tx = static_cast<float>(t[0]), ty = static_cast<float>(t[1]), tz = static_cast<float>(t[2]);
+
+        for (int i = 0; i < VertexCount; i++) {
+            float x = dynamicCoords[i * 3 + 0];
+            float y = dynamicCoords[i * 3 + 1];
+            float z = dynamicCoords[i * 3 + 2];
+            vertices[i * 3 + 0] = m[0] * x + m[1] * y + m[2] * z + tx;
+            vertices[i * 3 + 1] = m[3] * x + m[4] * y + m[5] * z + ty;
+            vertices[i * 3 + 2] = m[6] * x + m[7] * y + m[8] * z + tz;
+        }
+    }
+
+private:
+    static bool MatchesDeformations(const eruFace::Model& model, bool isStatic,
+        const int* deformation, const int* vertex, const float* displacement, int count)
+    {
+        const double tolerance = 1e-6;
+
+        // The tables list each deformation's displacements in order
+        int k = 0;
+        int n = isStatic ? model.nStaticDeformations() : model.nDynamicDeformations();
+        for (int d = 0; d < n; d++) {
+            const eruFace::Deformation& def = isStatic ? model.staticDeformation(d) : model.dynamicDeformation(d);
+            for (int i = 0; i < def.nDisplacements(); i++, k++) {
+                if (k >= count || deformation[k] != d || vertex[k] != def.vertexNo(i))
+                    return false;
+                for (int j = 0; j < 3; j++) {
+                    if (fabs(def[i][j] - displacement[k * 3 + j]) > tolerance)
+                        return false;
+                }
+            }
+        }
+        return k == count;
+    }
+
+    float   staticCoords[VertexCount * 3];
+    float   dynamicCoords[VertexCount * 3];
+};
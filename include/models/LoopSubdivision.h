@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include "eru\Model.h"
+
+// Loop subdivision of the face mesh, to smooth the facets of the low-poly Candide
+// silhouette when the face is drawn large.
+//
+// Build() refines the mesh's topology once, and composes each level's Loop rules
+// into a single stencil per refined vertex over the original vertices. Apply() is
+// then one sparse matrix-vector product from the deformed vertices, whatever the
+// level. Texture coordinates go through the same stencils once, at build time.
+//
+// Edges with other than two faces (the outline, eyes and mouth) are treated as
+// boundary creases, and vertices where they don't form a simple curve are kept fixed.
+class LoopSubdivision
+{
+public:
+    static const int MaxLevels = 3;
+
+    LoopSubdivision();
+
+    // Refine the mesh's faces levels times (1 to MaxLevels)
+    bool Build(const eruFace::Model& mesh, int levels);
+    void Clear();
+
+    bool IsBuilt() const { return levels > 0; }
+    int GetLevels() const { return levels; }
+    int GetSourceCount() const { return sourceCount; }
+    int GetVertexCount() const { return static_cast<int>(offsets.size()) - 1; }
+    int GetStencilSize() const { return static_cast<int>(indices.size()); }    // Total weights over all stencils
+
+    // The refined triangles (3 vertex indices each), and uv per refined vertex (empty if the mesh has none)
+    const std::vector<int>& GetFaces() const { return faces; }
+    const std::vector<float>& GetTexCoords() const { return texCoords; }
+
+    // The refined vertices (xyz) for the mesh's vertices, eg. from CustomFaceModel::Deform.
+    // Returns false if source has fewer vertices than the mesh was built with.
+    bool Apply(const std::vector<float>& source, std::vector<float>* target) const;
+
+private:
+    int                 levels;
+    int                 sourceCount;
+
+    std::vector<int>    faces;
+    std::vector<float>  texCoords;
+
+    std::vector<int>    offsets;        // Each refined vertex's stencil is [offsets[v], offsets[v + 1])
+    std::vector<int>    indices;
+    std::vector<float>  weights;
+};
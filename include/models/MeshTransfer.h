@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+// Drives a high resolution face mesh from the deformed vertices of the tracked
+// (Candide-3) mesh, so detail can be drawn without adding to the tracking cost.
+//
+// Bind() ties each vertex of the detailed mesh to its nearest few tracked
+// vertices, both meshes at rest. Its weights are the smallest affine combination
+// of those vertices that reproduces its position (a generalized barycentric
+// coordinate, favouring the nearest), and whatever the weights can't reproduce is
+// kept as a fixed offset. Apply() is then just a sparse matrix-vector product from
+// the deformed tracked vertices, split across cores.
+class MeshTransfer
+{
+public:
+    static const int Neighbors = 6;     // Tracked vertices each detailed vertex follows
+
+    MeshTransfer();
+
+    // Both are xyz per vertex, at rest and in the same space (as CustomFaceModel::Deform returns them)
+    void Bind(const std::vector<float>& source, const std::vector<float>& target);
+    void Clear();
+
+    bool IsBound() const { return targetCount > 0; }
+    int GetSourceCount() const { return sourceCount; }
+    int GetTargetCount() const { return targetCount; }
+
+    // The detailed mesh's vertices (xyz) for deformed tracked ones. Returns false
+    // if source has fewer vertices than were bound.
+    bool Apply(const std::vector<float>& source, std::vector<float>* target) const;
+
+private:
+    int                 sourceCount;
+    int                 targetCount;
+    int                 neighbors;      // Per target vertex (Neighbors, or fewer if the source is tiny)
+
+    std::vector<int>    indices;        // neighbors per target vertex
+    std::vector<float>  weights;
+    std::vector<float>  offsets;        // xyz per target vertex
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Caches the face tracker's shape units (SUs) so the personalised static mesh
+// only has to be rebuilt when the SUs actually change. Once the tracker reports
+// that the SUs have converged, the cache is frozen and the SU path can be skipped
+// entirely until the cache is reset (eg. a different person is tracked).
+class ShapeUnitCache
+{
+public:
+    ShapeUnitCache(float threshold = 0.01f);
+    ~ShapeUnitCache();
+
+    // Feed the latest SUs from the tracker.
+    // Returns true if the cached SUs changed by more than the threshold,
+    // in which case the static mesh should be updated.
+    bool Update(float headScale, const float* pSUCoefs, unsigned int suCount, bool haveConverged);
+
+    // Unfreeze the cache so the next SUs from the tracker are considered again.
+    // If the cache was loaded from or saved to a user profile it stays frozen.
+    void Reset();
+
+    bool IsFrozen() const { return frozen; }
+    bool IsPinned() const { return pinned; }
+    bool IsValid() const { return !shapeUnits.empty(); }
+
+    float GetHeadScale() const { return headScale; }
+    const std::vector<float>& GetShapeUnits() const { return shapeUnits; }
+
+    // Persist the SUs for a user, so they don't need to re-converge next session.
+    // A loaded or saved cache is frozen and pinned.
+    bool Load(const std::string& filename);
+    bool Save(const std::string& filename);
+
+private:
+    float               threshold;
+    bool                frozen;
+    bool                pinned;
+
+    float               headScale;
+    std::vector<float>  shapeUnits;
+};
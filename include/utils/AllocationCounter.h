@@ -0,0 +1,17 @@
+#pragma once
+
+// Counts calls to the global operator new and new[] (plain and nothrow), so we
+// can check that steady-state frames aren't hitting the heap. (Note that this
+// can't see allocations made with malloc directly, eg. inside OpenCV/OpenNI.)
+//
+// Steady-state frames aren't entirely allocation free yet. What still allocates:
+//  - The Kinect face tracking SDK, and OpenCV's own temporaries (cv::fastMalloc),
+//    every frame. Neither goes through operator new, so neither is counted here.
+//  - sf::Text, when the status text changes.
+//  - One-offs the first time something new turns up, eg. a tracking error not
+//    seen before.
+namespace AllocationCounter
+{
+    unsigned long long GetAllocationCount();
+    unsigned long long GetAllocatedBytes();
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Fixed-capacity lock-free multi-producer/multi-consumer queue
+// (Dmitry Vyukov's bounded MPMC queue).
+//
+// Each cell carries a sequence number which tells producers and consumers
+// whether it is free to write or ready to read, so pushing and popping are a
+// single compare-and-swap on the shared position in the common case, and
+// never block. Capacity is rounded up to a power of two.
+//
+// WaitPush()/WaitPop() are for a thread with nothing else to do: they spin
+// briefly, then sleep on a condition variable until the other side makes
+// progress. Pushes and pops only touch the lock when somebody is asleep.
+template<class T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity) :
+        capacity(RoundUp(capacity)),
+        mask(RoundUp(capacity) - 1),
+        cells(new Cell[RoundUp(capacity)]),
+        enqueuePos(0),
+        dequeuePos(0),
+        waiters(0)
+    {
+        for (size_t i = 0; i < this->capacity; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~BoundedQueue() {}
+
+    // Returns false if the queue is full
+    bool TryPush(const T& item) {
+        if (!Push(item))
+            return false;
+        Notify();
+        return true;
+    }
+
+    // Returns false if the queue is empty
+    bool TryPop(T& item) {
+        if (!Pop(item))
+            return false;
+        Notify();
+        return true;
+    }
+
+    // Push, waiting for space if it's full. Returns false (without pushing) if stop is set.
+    bool WaitPush(const T& item, const std::atomic<bool>& stop) {
+        return Wait([&] { return Push(item); }, stop);
+    }
+
+    // Pop, waiting for an item if it's empty. Returns false if stop is set.
+    bool WaitPop(T& item, const std::atomic<bool>& stop) {
+        return Wait([&] { return Pop(item); }, stop);
+    }
+
+    // Wake any waiting threads so they see their stop flag (set it first)
+    void WakeAll() {
+        {
+            std::lock_guard<std::mutex> lock(waitMutex);
+        }
+        wakeup.notify_all();
+    }
+
+    // Approximate number of queued items (exact when the queue is idle)
+    size_t Size() const {
+        size_t enq = enqueuePos.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos.load(std::memory_order_relaxed);
+        return (enq > deq) ? (enq - deq) : 0;
+    }
+
+    size_t Capacity() const { return capacity; }
+
+private:
+    BoundedQueue(BoundedQueue const&);
+    BoundedQueue& operator =(BoundedQueue const&);
+
+    bool Push(const T& item) {
+        Cell* cell;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;   // Full
+            }
+            else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& item) {
+        Cell* cell;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;   // Empty
+            }
+            else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = cell->data;
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<class F>
+    bool Wait(F attempt, const std::atomic<bool>& stop) {
+        // Most waits in a pipeline are short, so don't go to sleep straight away
+        for (int spin = 0; spin < 64; spin++) {
+            if (attempt()) {
+                Notify();
+                return true;
+            }
+            if (stop.load(std::memory_order_relaxed))
+                return false;
+            std::this_thread::yield();
+        }
+
+        // Announce the waiter before checking again, so a push or pop that the check
+        // misses is sure to see it and notify (see Notify)
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool done;
+        {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            while (!(done = attempt()) && !stop.load())
+                wakeup.wait(lock);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+
+        if (done)
+            Notify();
+        return done;
+    }
+
+    void Notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0)
+            WakeAll();
+    }
+
+    static size_t RoundUp(size_t n) {
+        size_t c = 2;
+        while (c < n)
+            c <<= 1;
+        return c;
+    }
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    // Producer and consumer positions on separate cache lines
+    char pad0[64];
+    std::atomic<size_t> enqueuePos;
+    char pad1[64];
+    std::atomic<size_t> dequeuePos;
+    char pad2[64];
+
+    std::atomic<int>        waiters;    // Threads asleep in Wait()
+    std::mutex              waitMutex;
+    std::condition_variable wakeup;
+};
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <SFML\System.hpp>
-#include <vector>
+#include "utils\RollingStatistics.h"
 
 class FPSCounter
 {
 public:
-    FPSCounter(int samples=128): c_samples(samples), hist(samples), count(0), idx(0) {}
+    // Interval percentiles are resolved to 1ms over 0-100ms
+    FPSCounter(int samples=128): intervals(samples, 0.0, 0.1, 100) {}
     ~FPSCounter();
 
     void BeginPeriod();
@@ -18,15 +19,14 @@ public:
     float GetAverageInterval();
     float GetCurrentInterval();
 
-private:
-    int c_samples;
+    float GetMaximumInterval();
+    float GetIntervalStdDev();
+    float GetIntervalPercentile(float p);
 
+private:
     sf::Clock clock;
 
-    std::vector<float> hist;
-    int idx;
-    int count;
+    RollingStatistics<float> intervals;
 
     void AddSample(float interval);
 };
-
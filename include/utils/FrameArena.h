@@ -0,0 +1,54 @@
+#pragma once
+
+#include <opencv2\core.hpp>
+
+#include <atomic>
+#include <vector>
+
+// Bump allocator for short-lived per-frame buffers.
+// Memory handed out by the arena is only reclaimed when Reset() is called at the
+// start of the next frame, so anything allocated from it must not outlive the frame.
+class FrameArena
+{
+public:
+    FrameArena(size_t capacity = 16 * 1024 * 1024);
+    ~FrameArena();
+
+    FrameArena(FrameArena const&) = delete;
+    FrameArena& operator =(FrameArena const&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = 64);
+
+    // Release everything allocated in the previous frame.
+    // If the arena overflowed, it is grown so the next frame fits.
+    // Throws std::logic_error if a matrix allocated from the arena is still alive.
+    void Reset();
+
+    // Returns an empty matrix whose data will be allocated from the arena
+    cv::Mat NewMat();
+    cv::MatAllocator* GetMatAllocator();
+
+    size_t GetCapacity() const { return capacity; }
+    size_t GetUsed() const { return used; }
+    size_t GetPeak() const { return peak; }
+
+    // Number of allocations that didn't fit and had to go to the heap
+    unsigned int GetOverflowCount() const { return overflowCount; }
+
+private:
+    class MatAllocator;
+
+    void FreeOverflow();
+
+    unsigned char*      buffer;
+    size_t              capacity;
+    size_t              used;
+    size_t              peak;
+    size_t              overflowBytes;
+    unsigned int        overflowCount;
+
+    std::vector<void*>  overflowBlocks;
+
+    std::atomic<int>    liveMats;
+    MatAllocator*       matAllocator;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Registry of pipeline metrics (counters, gauges and histograms) that can be
+// rendered in the Prometheus text exposition format.
+//
+// Metrics are registered once at startup and then updated from the capture,
+// tracking and render threads using atomics only, so updating a metric on the
+// hot path never takes a lock. The registry lock is only held while registering,
+// removing or rendering. Anything that registers metrics (or callbacks capturing
+// itself) and doesn't live as long as the process must Remove() them.
+namespace Metrics
+{
+    class Counter
+    {
+    public:
+        Counter() : value(0) {}
+
+        void Increment(unsigned long long n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+        unsigned long long Get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<unsigned long long> value;
+    };
+
+    class Gauge
+    {
+    public:
+        Gauge() : value(0.0) {}
+
+        void Set(double v) { value.store(v, std::memory_order_relaxed); }
+        double Get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<double> value;
+    };
+
+    class Histogram
+    {
+    public:
+        // bounds are the (ascending) upper bounds of each bucket, excluding +Inf
+        Histogram(const std::vector<double>& bounds);
+
+        void Observe(double v);
+
+        const std::vector<double>& GetBounds() const { return bounds; }
+        unsigned long long GetBucketCount(int i) const { return counts[i].load(std::memory_order_relaxed); }
+        unsigned long long GetCount() const { return count.load(std::memory_order_relaxed); }
+        double GetSum() const { return sum.load(std::memory_order_relaxed); }
+
+    private:
+        std::vector<double> bounds;
+        std::unique_ptr<std::atomic<unsigned long long>[]> counts;  // Not cumulative
+        std::atomic<unsigned long long> count;
+        std::atomic<double> sum;
+    };
+
+    class Registry
+    {
+    public:
+        Registry();
+        ~Registry();
+
+        // labels are in Prometheus syntax without braces, eg. hresult="0x80004005".
+        // Several metrics may share a name if they have different labels.
+        Counter&   AddCounter(const std::string& name, const std::string& help, const std::string& labels = "");
+        Gauge&     AddGauge(const std::string& name, const std::string& help, const std::string& labels = "");
+        Histogram& AddHistogram(const std::string& name, const std::string& help, const std::vector<double>& bounds, const std::string& labels = "");
+
+        // Gauge whose value is computed when the metrics are rendered
+        void       AddCallbackGauge(const std::string& name, const std::string& help, std::function<double()> callback);
+        void       AddCallbackGauge(const std::string& name, const std::string& help, const std::string& labels, std::function<double()> callback);
+
+        // Counter whose (monotonic) total is read when the metrics are rendered
+        void       AddCallbackCounter(const std::string& name, const std::string& help, std::function<unsigned long long()> callback);
+
+        // Unregister the metrics with this name and labels (eg. when whatever they belong to is
+        // destroyed), deleting them. Once this returns, none of their callbacks are running.
+        void       Remove(const std::string& name, const std::string& labels = "");
+
+        void       Render(std::ostream& os);
+
+    private:
+        Registry(Registry const&);
+        Registry& operator =(Registry const&);
+
+        enum Type { counter, gauge, histogram, callback, callbackCounter };
+
+        struct Entry {
+            Type        type;
+            std::string name;
+            std::string help;
+            std::string labels;
+            void*       metric;
+            std::function<double()> fn;
+            std::function<unsigned long long()> counterFn;
+        };
+
+        void Add(Type type, const std::string& name, const std::string& help, const std::string& labels, void* metric);
+        static void RenderEntry(std::ostream& os, const Entry& e);
+
+        std::mutex          mutex;
+        std::vector<Entry>  entries;
+    };
+
+    // Process-wide registry
+    Registry& GetRegistry();
+
+    // Common bucket bounds for stage latencies, in milliseconds
+    const std::vector<double>& LatencyBuckets();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "utils\Runnable.h"
+
+#include <cstdint>
+#include <string>
+
+// Serves the metrics registry in the Prometheus text format over HTTP on the
+// loopback interface, eg. http://127.0.0.1:9731/metrics
+// Requests are handled one at a time on a background thread, so scraping
+// never blocks the capture or render threads.
+class MetricsServer : public Runnable
+{
+public:
+    MetricsServer(unsigned short port);
+    ~MetricsServer();
+
+    // Start listening. Metrics are optional, so if that fails (eg. the port is taken)
+    // it's logged and false returned rather than thrown, and the server shouldn't be started.
+    bool Initialize();
+    bool IsListening() const;
+
+    unsigned short GetPort() const { return port; }
+
+private:
+    void Run();
+    void HandleClient(uintptr_t client);
+
+    unsigned short port;
+    uintptr_t listenSocket;     // SOCKET, kept out of the header to avoid pulling in winsock
+    bool wsaStarted;
+};
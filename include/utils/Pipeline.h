@@ -0,0 +1,309 @@
+#pragma once
+
+#include "utils\BoundedQueue.h"
+#include "utils\FrameArena.h"
+#include "utils\Metrics.h"
+#include "utils\Profiler.h"
+#include "utils\Runnable.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Small dataflow pipeline: a chain of stages, each running on its own worker
+// thread, connected by bounded lock-free queues.
+//
+// Items (eg. frames) come from a fixed pool owned by the pipeline, so nothing
+// is allocated once it's running. The first stage takes an empty item from the
+// pool and fills it, each following stage takes the previous stage's output,
+// and the last stage's output is collected by the owner with TryReceive().
+// Items must be handed back with Release() once they're no longer needed.
+//
+// A stage with no input waits on its queue (see BoundedQueue::WaitPop) rather than
+// polling it. Each connection has a policy for when it's full:
+//   Block       the producing stage waits (back-pressure on everything upstream)
+//   DropOldest  the oldest queued item is dropped, keeping latency down
+//
+// Per-stage throughput, busy/blocked time, queue depth and drops are exported
+// to the metrics registry, labelled by stage name.
+namespace PipelineDetail
+{
+    // Pin the calling thread to a core (no-op if core < 0)
+    void PinCurrentThread(int core);
+
+    int CoreCount();
+}
+
+template<class T>
+class Pipeline
+{
+public:
+    enum QueuePolicy { Block, DropOldest };
+
+    // Process an item in place. Returning false discards it (eg. no new frame available).
+    // The arena is reset before every item, for the stage's temporaries.
+    typedef std::function<bool(T& item, FrameArena& arena)> StageFunction;
+
+    struct StageStatistics {
+        std::string         name;
+        unsigned long long  processed;
+        unsigned long long  discarded;      // Returned false
+        unsigned long long  dropped;        // Dropped from this stage's output queue
+        size_t              queueDepth;     // Items waiting in this stage's output queue
+        size_t              queueCapacity;
+        double              busySeconds;    // Total time spent processing
+        double              blockedSeconds; // Total time spent waiting for space downstream
+        int                 core;
+    };
+
+    Pipeline(const std::string& name, size_t poolSize) :
+        name(name),
+        pool(poolSize),
+        failed(false)
+    {
+        for (size_t i = 0; i < poolSize; i++) {
+            items.push_back(std::unique_ptr<T>(new T()));
+            pool.TryPush(items.back().get());
+        }
+    }
+
+    ~Pipeline() { Stop(); }
+
+    // Add a stage to the end of the pipeline. Must be called before Start().
+    // threadName must be a string literal (it's passed to the profiler).
+    void AddStage(const char* threadName, StageFunction fn, size_t outputCapacity, QueuePolicy policy) {
+        Stage* input = stages.empty() ? nullptr : stages.back().get();
+        stages.push_back(std::unique_ptr<Stage>(new Stage(this, threadName, fn, input, outputCapacity, policy)));
+    }
+
+    // Start the worker threads. If pinThreads is set, each stage is pinned to its own core
+    // (leaving core 0 for the thread that collects the output). That's only done if there are
+    // more cores than stages: sharing cores would serialize stages that could run in parallel.
+    void Start(bool pinThreads) {
+        int cores = PipelineDetail::CoreCount();
+        bool pin = pinThreads && cores > static_cast<int>(stages.size());
+        for (size_t i = 0; i < stages.size(); i++) {
+            int core = pin ? static_cast<int>(1 + i) : -1;
+            stages[i]->SetCore(core);
+            stages[i]->Start();
+        }
+    }
+
+    void Stop() {
+        for (auto& s : stages)
+            s->Stop();
+    }
+
+    // Take the next item from the end of the pipeline, if there is one
+    bool TryReceive(T*& item) {
+        return !stages.empty() && stages.back()->output.TryPop(item);
+    }
+
+    void Release(T* item) {
+        if (item != nullptr)
+            pool.TryPush(item);
+    }
+
+    size_t GetPoolAvailable() const { return pool.Size(); }
+    size_t GetStageCount() const { return stages.size(); }
+
+    // If a stage threw, rethrow its error on the calling thread
+    void CheckError() {
+        if (failed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            throw std::runtime_error(error);
+        }
+    }
+
+    void GetStatistics(std::vector<StageStatistics>& stats) const {
+        stats.resize(stages.size());
+        for (size_t i = 0; i < stages.size(); i++)
+            stages[i]->GetStatistics(&stats[i]);
+    }
+
+private:
+    Pipeline(Pipeline const&);
+    Pipeline& operator =(Pipeline const&);
+
+    class Stage : public Runnable
+    {
+    public:
+        Stage(Pipeline* pipeline, const char* threadName, StageFunction fn, Stage* input, size_t capacity, QueuePolicy policy) :
+            pipeline(pipeline),
+            threadName(threadName),
+            labels("pipeline=\"" + pipeline->name + "\",stage=\"" + threadName + "\""),
+            fn(fn),
+            input(input),
+            output(capacity),
+            policy(policy),
+            core(-1),
+            processed(0),
+            discarded(0),
+            dropped(0),
+            busyTicks(0),
+            blockedTicks(0),
+            arena(4 * 1024 * 1024)
+        {
+            auto& registry = Metrics::GetRegistry();
+            processedCounter = &registry.AddCounter("pipeline_stage_processed_total", "Items processed by the stage", labels);
+            droppedCounter = &registry.AddCounter("pipeline_stage_dropped_total", "Items dropped from the stage's output queue", labels);
+            busyHistogram = &registry.AddHistogram("pipeline_stage_busy_ms", "Time spent processing each item", Metrics::LatencyBuckets(), labels);
+            registry.AddCallbackGauge("pipeline_stage_queue_depth", "Items waiting in the stage's output queue",
+                labels, [this] { return static_cast<double>(output.Size()); });
+            registry.AddCallbackGauge("pipeline_stage_blocked_seconds", "Time spent waiting for space downstream",
+                labels, [this] { return Profiler::TicksToSeconds(blockedTicks.load(std::memory_order_relaxed)); });
+        }
+
+        // The metric callbacks capture this, so they must go with the stage.
+        // (The pipeline has already stopped every stage's thread by now.)
+        ~Stage() {
+            auto& registry = Metrics::GetRegistry();
+            registry.Remove("pipeline_stage_queue_depth", labels);
+            registry.Remove("pipeline_stage_blocked_seconds", labels);
+            registry.Remove("pipeline_stage_processed_total", labels);
+            registry.Remove("pipeline_stage_dropped_total", labels);
+            registry.Remove("pipeline_stage_busy_ms", labels);
+        }
+
+        void SetCore(int core) { this->core = core; }
+
+        // Wake the thread if it's waiting on a queue, then wait for it to finish
+        void Stop() {
+            m_stop = true;
+            Source().WakeAll();
+            output.WakeAll();
+            Runnable::Stop();
+        }
+
+        void GetStatistics(StageStatistics* s) const {
+            s->name = threadName;
+            s->processed = processed.load(std::memory_order_relaxed);
+            s->discarded = discarded.load(std::memory_order_relaxed);
+            s->dropped = dropped.load(std::memory_order_relaxed);
+            s->queueDepth = output.Size();
+            s->queueCapacity = output.Capacity();
+            s->busySeconds = Profiler::TicksToSeconds(busyTicks.load(std::memory_order_relaxed));
+            s->blockedSeconds = Profiler::TicksToSeconds(blockedTicks.load(std::memory_order_relaxed));
+            s->core = core;
+        }
+
+        BoundedQueue<T*> output;
+
+    private:
+        void Run() {
+            Profiler::SetThreadName(threadName);
+            PipelineDetail::PinCurrentThread(core);
+
+            try {
+                Loop();
+            }
+            catch (std::exception& e) {
+                pipeline->SetError(std::string(threadName) + ": " + e.what());
+            }
+        }
+
+        void Loop() {
+            while (!m_stop) {
+                T* item = nullptr;
+                if (!Acquire(item))
+                    continue;
+
+                arena.Reset();
+
+                long long start = Profiler::Now();
+                bool keep;
+                {
+                    PROFILE_SCOPE(threadName);
+                    keep = fn(*item, arena);
+                }
+                long long end = Profiler::Now();
+                busyTicks.fetch_add(end - start, std::memory_order_relaxed);
+
+                if (!keep) {
+                    discarded.fetch_add(1, std::memory_order_relaxed);
+                    pipeline->Release(item);
+                    continue;
+                }
+
+                processed.fetch_add(1, std::memory_order_relaxed);
+                processedCounter->Increment();
+                busyHistogram->Observe(Profiler::TicksToSeconds(end - start) * 1000.0);
+
+                Publish(item);
+            }
+        }
+
+        // The previous stage's output, or the pool of empty items
+        BoundedQueue<T*>& Source() {
+            return (input != nullptr) ? input->output : pipeline->pool;
+        }
+
+        // Take the next item, waiting for one (false if stopped meanwhile)
+        bool Acquire(T*& item) {
+            return Source().WaitPop(item, m_stop);
+        }
+
+        void Publish(T* item) {
+            long long start = Profiler::Now();
+
+            if (policy == Block) {
+                if (!output.WaitPush(item, m_stop))
+                    pipeline->Release(item);
+            }
+            else {
+                while (!output.TryPush(item)) {
+                    // Make room by throwing away the oldest queued item
+                    T* oldest = nullptr;
+                    if (output.TryPop(oldest)) {
+                        pipeline->Release(oldest);
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        droppedCounter->Increment();
+                    }
+                }
+            }
+
+            blockedTicks.fetch_add(Profiler::Now() - start, std::memory_order_relaxed);
+        }
+
+        Pipeline*       pipeline;
+        const char*     threadName;
+        std::string     labels;     // Metric labels
+        StageFunction   fn;
+        Stage*          input;
+        QueuePolicy     policy;
+        int             core;
+
+        std::atomic<unsigned long long> processed;
+        std::atomic<unsigned long long> discarded;
+        std::atomic<unsigned long long> dropped;
+        std::atomic<long long>          busyTicks;
+        std::atomic<long long>          blockedTicks;
+
+        Metrics::Counter*   processedCounter;
+        Metrics::Counter*   droppedCounter;
+        Metrics::Histogram* busyHistogram;
+
+        FrameArena      arena;
+    };
+
+    void SetError(const std::string& message) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!failed) {
+            error = message;
+            failed.store(true, std::memory_order_release);
+        }
+    }
+
+    std::string name;
+    BoundedQueue<T*> pool;
+    std::vector<std::unique_ptr<T>> items;
+    std::vector<std::unique_ptr<Stage>> stages;
+
+    std::mutex errorMutex;
+    std::string error;
+    std::atomic<bool> failed;
+};
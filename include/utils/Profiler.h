@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+
+// Low-overhead hierarchical scope profiler.
+//
+// Each thread records completed scopes into its own fixed-size ring buffer,
+// so recording never takes a lock. The recorded events can be exported in the
+// Chrome trace-event format (load in chrome://tracing) to see where each
+// frame's time goes across the capture and render threads.
+//
+// Scope names must be string literals (only the pointer is stored).
+// Nested scopes show up as a hierarchy in the trace viewer.
+//
+// Usage:
+//   void Foo() {
+//       PROFILE_SCOPE("Foo");
+//       ...
+//   }
+
+namespace Profiler
+{
+    class Scope
+    {
+    public:
+        Scope(const char* name);
+        ~Scope();
+
+    private:
+        Scope(Scope const&);
+        Scope& operator =(Scope const&);
+
+        const char* name;
+        long long   start;
+    };
+
+    // Name the calling thread in the exported trace
+    void SetThreadName(const char* name);
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+
+    // High resolution timestamp (QueryPerformanceCounter ticks)
+    long long Now();
+    double TicksToSeconds(long long ticks);
+
+    // Write all events currently held in the thread buffers as Chrome trace-event JSON
+    bool WriteChromeTrace(const std::string& filename);
+}
+
+#ifndef PROFILER_DISABLED
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+// Statistics over a sliding window of the most recent samples.
+// Adding a sample and querying the mean/variance/min/max are O(1) (amortized),
+// percentiles are approximated from a fixed-bucket histogram covering [histMin, histMax].
+template<class T>
+class RollingStatistics
+{
+public:
+    RollingStatistics(int samples = 128, double histMin = 0.0, double histMax = 1.0, int histBuckets = 64) :
+        max_samples(samples),
+        idx(0),
+        count(0),
+        seq(0),
+        sinceRenormalize(0),
+        history(samples),
+        sum(0.0),
+        sumSq(0.0),
+        current(0),
+        minimum(samples),
+        maximum(samples),
+        histMin(histMin),
+        histMax(histMax),
+        histogram(histBuckets, 0) {}
+
+    ~RollingStatistics() {}
+
+    void AddSample(T sample) {
+        if (count == max_samples) {
+            // Window is full, so the sample in this slot drops out
+            T old = history[idx];
+            sum -= static_cast<double>(old);
+            sumSq -= static_cast<double>(old) * static_cast<double>(old);
+            histogram[Bucket(old)]--;
+        }
+        else {
+            count++;
+        }
+
+        history[idx] = sample;
+        sum += static_cast<double>(sample);
+        sumSq += static_cast<double>(sample) * static_cast<double>(sample);
+        histogram[Bucket(sample)]++;
+
+        minimum.Push(seq, sample, max_samples, false);
+        maximum.Push(seq, sample, max_samples, true);
+
+        if (++idx == max_samples)
+            idx = 0;
+        seq++;
+
+        // Running sums of floating point values slowly drift, so re-sum once per window
+        if (++sinceRenormalize >= max_samples)
+            Renormalize();
+
+        current = sample;
+    }
+
+    void Clear() {
+        count = 0;
+        idx = 0;
+        seq = 0;
+        sinceRenormalize = 0;
+        sum = 0.0;
+        sumSq = 0.0;
+        current = 0;
+        minimum.Clear();
+        maximum.Clear();
+        histogram.assign(histogram.size(), 0);
+    }
+
+    int GetSampleCount() const { return count; }
+    T GetCurrent() const { return current; }
+
+    double GetMean() const {
+        return (count > 0) ? sum / static_cast<double>(count) : 0.0;
+    }
+
+    double GetVariance() const {
+        if (count == 0)
+            return 0.0;
+        double mean = GetMean();
+        double var = sumSq / static_cast<double>(count) - mean * mean;
+        return (var > 0.0) ? var : 0.0;
+    }
+
+    double GetStdDev() const { return sqrt(GetVariance()); }
+
+    T GetMinimum() const { return (count > 0) ? minimum.Front() : T(0); }
+    T GetMaximum() const { return (count > 0) ? maximum.Front() : T(0); }
+
+    // Approximate percentile (p = 0..1), linearly interpolated within a histogram bucket.
+    // Samples outside the histogram range are counted in the first/last bucket.
+    double GetPercentile(double p) const {
+        if (count == 0)
+            return 0.0;
+
+        double target = p * static_cast<double>(count);
+        double bucketWidth = (histMax - histMin) / static_cast<double>(histogram.size());
+        int csum = 0;
+        for (unsigned int i = 0; i < histogram.size(); i++) {
+            if (histogram[i] > 0 && csum + histogram[i] >= target) {
+                double frac = (target - csum) / static_cast<double>(histogram[i]);
+                return histMin + (static_cast<double>(i) + frac) * bucketWidth;
+            }
+            csum += histogram[i];
+        }
+        return histMax;
+    }
+
+private:
+    // Monotonic queue of candidate minimums (or maximums) within the window
+    class MonotonicQueue
+    {
+    public:
+        MonotonicQueue(int capacity) : seqs(capacity), values(capacity), head(0), size(0) {}
+
+        void Push(long long s, T value, int window, bool keepLarger) {
+            int capacity = static_cast<int>(values.size());
+
+            // Drop samples which have left the window
+            while (size > 0 && seqs[head] <= s - window) {
+                head = (head + 1 == capacity) ? 0 : head + 1;
+                size--;
+            }
+
+            // Drop samples which can no longer be the min/max
+            while (size > 0) {
+                T back = values[(head + size - 1) % capacity];
+                if (keepLarger ? (back > value) : (back < value))
+                    break;
+                size--;
+            }
+
+            int tail = (head + size) % capacity;
+            seqs[tail] = s;
+            values[tail] = value;
+            size++;
+        }
+
+        T Front() const { return values[head]; }
+        void Clear() { head = 0; size = 0; }
+
+    private:
+        std::vector<long long> seqs;
+        std::vector<T>  values;
+        int             head;
+        int             size;
+    };
+
+    int Bucket(T sample) const {
+        int n = static_cast<int>(histogram.size());
+        int b = static_cast<int>((static_cast<double>(sample) - histMin) / (histMax - histMin) * n);
+        return (b < 0) ? 0 : ((b >= n) ? n - 1 : b);
+    }
+
+    void Renormalize() {
+        sum = 0.0;
+        sumSq = 0.0;
+        for (int i = 0; i < count; i++) {
+            sum += static_cast<double>(history[i]);
+            sumSq += static_cast<double>(history[i]) * static_cast<double>(history[i]);
+        }
+        sinceRenormalize = 0;
+    }
+
+    int             max_samples;
+    int             idx;
+    int             count;
+    long long       seq;
+    int             sinceRenormalize;
+
+    std::vector<T>  history;
+
+    double          sum;
+    double          sumSq;
+    T               current;
+
+    MonotonicQueue  minimum;
+    MonotonicQueue  maximum;
+
+    double          histMin;
+    double          histMax;
+    std::vector<int> histogram;
+};
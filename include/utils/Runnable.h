@@ -14,7 +14,7 @@ public:
     Runnable(Runnable const&) = delete;
     Runnable& operator =(Runnable const&) = delete;
 
-    void Stop() { m_stop = true; if (m_started) { m_thread.join(); } }
+    void Stop() { m_stop = true; if (m_started && m_thread.joinable()) { m_thread.join(); } }
     void Start() { m_thread = std::thread(&Runnable::Run, this); m_started = true; }
 
 protected:
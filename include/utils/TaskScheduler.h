@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for splitting a single operation (an image, a mesh)
+// across cores.
+//
+// ParallelFor() cuts a range into fixed-size chunks and queues them on a worker's
+// deque. Each worker takes work from the back of its own deque and, when that's
+// empty, steals from the front of the others'. The calling thread works on chunks
+// too until the whole range is done, so nested or concurrent calls (eg. from
+// several pipeline stages at once) can't deadlock.
+//
+// Chunk boundaries depend only on the range and grain, never on the number of
+// threads, so a result combined per chunk in chunk order is identical however the
+// work happened to be scheduled.
+class TaskScheduler
+{
+public:
+    typedef std::function<void(int begin, int end)> RangeFunction;
+
+    // threads is the number of worker threads, not counting callers of ParallelFor.
+    // With 0 workers, everything runs on the calling thread.
+    explicit TaskScheduler(int threads);
+    ~TaskScheduler();
+
+    // Must not be called while a ParallelFor is running
+    void SetThreadCount(int threads);
+    int GetThreadCount() const { return static_cast<int>(workers.size()); }
+
+    // Run fn on [begin, end) in chunks of grain items, and wait for them all.
+    // If fn throws, the first exception is rethrown here once every chunk has finished.
+    void ParallelFor(int begin, int end, int grain, const RangeFunction& fn);
+
+    static int ChunkCount(int begin, int end, int grain) {
+        return (end > begin) ? (end - begin + grain - 1) / grain : 0;
+    }
+
+    // Workers (not counting the caller) to use by default: one per core, less one
+    static int DefaultThreadCount();
+
+    // Workers to use when busyThreads other threads (eg. pipeline stages) already
+    // keep cores busy: one per core left over
+    static int SpareThreadCount(int busyThreads);
+
+    // Scheduler shared by the image and mesh code
+    static TaskScheduler& Default();
+
+private:
+    TaskScheduler(TaskScheduler const&);
+    TaskScheduler& operator =(TaskScheduler const&);
+
+    struct Job {
+        const RangeFunction*    fn;
+        std::atomic<int>        remaining;
+        std::mutex              errorMutex;
+        std::exception_ptr      error;
+    };
+
+    struct Task {
+        Job*    job;
+        int     begin;
+        int     end;
+    };
+
+    // Deque of tasks owned by one worker. Chunks are coarse, so a lock is cheap enough here.
+    // It's a ring buffer that only grows (std::deque would allocate a block per task), so
+    // once it's as big as it needs to be, queueing a ParallelFor doesn't touch the heap.
+    class WorkQueue
+    {
+    public:
+        WorkQueue() : head(0), count(0) {}
+
+        void Push(const Task& task);
+        bool PopBack(Task& task);
+        bool PopFront(Task& task);
+
+    private:
+        std::mutex          queueMutex;
+        std::vector<Task>   tasks;
+        size_t              head;
+        size_t              count;
+    };
+
+    void StartWorkers(int threads);
+    void StopWorkers();
+    void WorkerLoop(int index);
+
+    // Own queue first (newest task, still warm in cache), then steal the oldest from the others
+    bool FindTask(int self, Task& task);
+    void Execute(const Task& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;     // One per worker
+    std::vector<std::thread>                workers;
+
+    std::atomic<bool>       stopping;
+    std::atomic<int>        queued;         // Tasks waiting in any queue
+    std::atomic<unsigned>   nextQueue;      // Round-robin target for jobs from non-workers
+
+    std::mutex              wakeMutex;
+    std::condition_variable wake;
+};
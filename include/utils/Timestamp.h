@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Local wall-clock time for filenames, eg. "20141103-142501-042" (with milliseconds,
+// so files saved in quick succession don't overwrite each other).
+std::string FormatTimestamp();
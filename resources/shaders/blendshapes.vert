@@ -0,0 +1,46 @@
+#version 120
+
+//
+// Deforms the face mesh on the GPU (see BlendshapeMesh): each vertex is its base
+// position plus coefficient * displacement for every deformation that moves it,
+// then the model's own transform from the .wfm file, then the head pose (modelview).
+//
+
+#define MAX_DEFORMATIONS 256
+
+uniform vec4 coefficients[MAX_DEFORMATIONS / 4];    // Static then dynamic deformations, four to a vec4
+uniform mat4 modelTransform;                        // The model's global scale, rotation and translation
+
+uniform sampler2D displacements;                    // Per displacement: (deformation, dx, dy, dz)
+uniform vec2 displacementsSize;                     // Width and height of the displacements texture
+
+const vec4 components = vec4(0.0, 1.0, 2.0, 3.0);
+
+float coefficient(float deformation)
+{
+    // Select the component without indexing a vector dynamically
+    float slot = floor(deformation / 4.0);
+    vec4 select = vec4(equal(components, vec4(deformation - slot * 4.0)));
+    return dot(coefficients[int(slot)], select);
+}
+
+void main()
+{
+    vec3 position = gl_Vertex.xyz;
+
+    // The vertex's displacements are a run of texels, given by its second texture coordinate (first, count)
+    float first = gl_MultiTexCoord1.x;
+    int count = int(gl_MultiTexCoord1.y);
+    for (int i = 0; i < count; i++) {
+        float index = first + float(i);
+        float row = floor(index / displacementsSize.x);
+        vec2 uv = (vec2(index - row * displacementsSize.x, row) + 0.5) / displacementsSize;
+
+        vec4 d = texture2DLod(displacements, uv, 0.0);
+        position += coefficient(d.x) * d.yzw;
+    }
+
+    gl_Position = gl_ModelViewProjectionMatrix * (modelTransform * vec4(position, 1.0));
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+    gl_FrontColor = gl_Color;
+}
@@ -15,7 +15,7 @@ uniform sampler2D backgroundTexture;
 
 // YCbCr
 mat3 rgb2yuv = mat3(
-     0.299,   0.587,    0.144,
+     0.299,   0.587,    0.114,
     -0.1687, -0.3313,   0.5,
      0.5,    -0.4187,  -0.0813
 );
@@ -42,30 +42,27 @@ void main()
 {
     //// YUV Luminance Blend ////
 
-    // Overlay texture colour (RGBA)
+    // Overlay texture (see FaceTexture): luma premultiplied by alpha, and alpha
     vec2 fg_uv = gl_TexCoord[0].xy;
 	vec4 fg_color = texture2D(overlayTexture, fg_uv);
+    float fg_alpha = fg_color.a;
 
     // Video/Background texture colour (RGBA)
     vec2 bg_uv = (gl_FragCoord.xy / iResolution) * vec2(1.0, -1.0) + vec2(0.0, 1.0);
 	vec4 bg_color = texture2D(backgroundTexture, bg_uv);
 
-    // Convert RGBA to YUV colour space
-    vec3 fg_yuv = fg_color.rgb * rgb2yuv;
+    // Convert the background to YUV colour space (the overlay is already luma)
     vec3 bg_yuv = bg_color.rgb * rgb2yuv;
 
     // Blend luminance of overlay with chrominance of background
-    // and apply level corrections
-    float Y = fg_yuv[0];
-    Y = Y / (lumaCorrect[1] - lumaCorrect[0]) + lumaCorrect[0];
-    vec3 blend_yuv = vec3(Y, bg_yuv.yz);
+    // and apply level corrections, all premultiplied by the overlay's alpha
+    float Y = fg_color.r / (lumaCorrect[1] - lumaCorrect[0]) + lumaCorrect[0] * fg_alpha;
+    vec3 blend_yuv = vec3(Y, bg_yuv.yz * fg_alpha);
 
-    // Convert back to RGBA colour space (Alpha channel from the overlay texture)
+    // Convert back to RGBA colour space (still premultiplied)
     vec3 blend_rgb = blend_yuv * yuv2rgb;
-	//gl_FragColor = vec4(blend_rgb, fg_color.a);
 
     // Work-around for an alpha-blending bug in SFML when drawing to a texture instead of the screen
-    gl_FragColor = vec4((blend_rgb * fg_color.a) + (bg_color.rgb * (1.0-fg_color.a)), 1.0);
+    gl_FragColor = vec4(blend_rgb + (bg_color.rgb * (1.0-fg_alpha)), 1.0);
 }
 
-
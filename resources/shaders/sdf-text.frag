@@ -0,0 +1,32 @@
+//
+// Text drawn from a signed distance field atlas (see SdfFont).
+// The atlas alpha is 0.5 on the glyph's edge, rising inside it and falling outside,
+// reaching 0 or 1 at the field's spread.
+//
+
+uniform sampler2D tex;
+
+uniform vec4 outlineColor;
+uniform float outlineWidth;     // As a fraction of the spread (0-0.5)
+
+uniform vec4 glowColor;
+uniform float glowWidth;        // Beyond the outline, as a fraction of the spread
+
+void main(void)
+{
+	float d = texture2D(tex, gl_TexCoord[0].st).a;
+
+	// Antialias over about a pixel on screen, whatever the scale
+	float aa = max(fwidth(d) * 0.5, 0.001);
+
+	float fill = smoothstep(0.5 - aa, 0.5 + aa, d);
+	float outlineEdge = 0.5 - outlineWidth;
+	float outline = smoothstep(outlineEdge - aa, outlineEdge + aa, d);
+	float glow = smoothstep(outlineEdge - glowWidth, outlineEdge, d);
+
+	vec4 color = vec4(glowColor.rgb, glowColor.a * glow);
+	color = mix(color, outlineColor, outline);
+	color = mix(color, gl_Color, fill);
+
+	gl_FragColor = color;
+}
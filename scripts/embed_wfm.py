@@ -0,0 +1,192 @@
+"""
+Compiles a .wfm face mesh into the application as C++ tables, for FixedFaceKernel.
+
+Usage (from the repository root):
+    python scripts/embed_wfm.py resources/faces/candide3_textured.wfm Candide3Mesh
+
+Writes include/models/<Name>.h (the sizes, as compile time constants) and
+src/models/<Name>.cpp (the tables). Rerun it whenever the mesh changes; a mesh
+that no longer matches its tables is deformed by the generic eruFace::Model path.
+
+Only the parts the kernel needs are embedded: base vertices, faces and the
+static/dynamic deformations. Each deformation list is flattened into parallel
+arrays with one entry per displacement, so it can be applied in a single loop.
+"""
+
+import os
+import sys
+
+
+class WfmReader:
+    """Reads a .wfm file's sections as eruFace::Model::parse does."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.lines = f.read().decode('latin-1').splitlines()
+        self.line = 0
+        self.tokens = []
+
+    def skip_comments(self):
+        while not self.tokens and self.line < len(self.lines):
+            text = self.lines[self.line].strip()
+            if text and not text.startswith('#'):
+                break
+            self.line += 1
+
+    def at_comment(self):
+        if self.tokens:
+            return False
+        while self.line < len(self.lines) and not self.lines[self.line].strip():
+            self.line += 1
+        return self.line < len(self.lines) and self.lines[self.line].strip().startswith('#')
+
+    def read_line(self):
+        self.tokens = []
+        text = self.lines[self.line].strip()
+        self.line += 1
+        return text
+
+    def token(self):
+        while not self.tokens:
+            self.skip_comments()
+            if self.line >= len(self.lines):
+                raise ValueError('unexpected end of file')
+            self.tokens = self.read_line().split()
+        return self.tokens.pop(0)
+
+    def read_int(self):
+        return int(self.token())
+
+    def read_float(self):
+        return float(self.token())
+
+    def read_deformations(self):
+        count = self.read_int()
+        deformations = []
+        for i in range(max(count, 0)):
+            name = ''
+            if self.at_comment():
+                name = self.read_line()[1:].strip()
+            displacements = []
+            for j in range(self.read_int()):
+                v = self.read_int()
+                displacements.append((v, self.read_float(), self.read_float(), self.read_float()))
+            deformations.append((name, displacements))
+        return deformations
+
+
+def read_wfm(path):
+    r = WfmReader(path)
+    vertices = [(r.read_float(), r.read_float(), r.read_float()) for i in range(r.read_int())]
+    faces = [(r.read_int(), r.read_int(), r.read_int()) for i in range(r.read_int())]
+    dynamic = r.read_deformations()
+    static = r.read_deformations()
+    return vertices, faces, dynamic, static
+
+
+def literal(x):
+    s = repr(float(x))
+    if 'e' not in s and '.' not in s:
+        s += '.0'
+    return ('0.0' if s == '-0.0' else s) + 'f'
+
+
+def table(values, per_line):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append('    ' + ', '.join(values[i:i + per_line]) + ',')
+    return '\n'.join(lines)
+
+
+def deformation_tables(name, deformations):
+    owner, vertex, displacement, names = [], [], [], []
+    for d, (title, displacements) in enumerate(deformations):
+        names.append('// %d: %s' % (d, title) if title else '// %d' % d)
+        for v, x, y, z in displacements:
+            owner.append(str(d))
+            vertex.append(str(v))
+            displacement += [literal(x), literal(y), literal(z)]
+
+    return '\n'.join([
+        '\n'.join(names),
+        'const int %s::%sDeformation[%sDisplacementCount] = {' % (STRUCT, name, name),
+        table(owner, 16),
+        '};',
+        '',
+        'const int %s::%sVertex[%sDisplacementCount] = {' % (STRUCT, name, name),
+        table(vertex, 16),
+        '};',
+        '',
+        'const float %s::%sDisplacement[%sDisplacementCount * 3] = {' % (STRUCT, name, name),
+        table(displacement, 3),
+        '};',
+    ])
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+
+    source, STRUCT = sys.argv[1], sys.argv[2]
+    vertices, faces, dynamic, static = read_wfm(source)
+    if not vertices or not faces or not dynamic or not static:
+        sys.exit('%s: the kernel needs vertices, faces, and dynamic and static deformations' % source)
+
+    generated = 'Generated by scripts/embed_wfm.py from %s. Do not edit.' % source.replace('\\', '/')
+    dynamic_count = sum(len(d[1]) for d in dynamic)
+    static_count = sum(len(d[1]) for d in static)
+
+    header = '\n'.join([
+        '// ' + generated,
+        '#pragma once',
+        '',
+        '// %s, compiled in for FixedFaceKernel' % os.path.basename(source),
+        'struct %s' % STRUCT,
+        '{',
+        '    static const int VertexCount = %d;' % len(vertices),
+        '    static const int FaceCount = %d;' % len(faces),
+        '    static const int DynamicCount = %d;' % len(dynamic),
+        '    static const int DynamicDisplacementCount = %d;' % dynamic_count,
+        '    static const int StaticCount = %d;' % len(static),
+        '    static const int StaticDisplacementCount = %d;' % static_count,
+        '',
+        '    static const float BaseCoords[VertexCount * 3];',
+        '    static const int Faces[FaceCount * 3];',
+        '',
+        '    // One entry per displacement: the deformation it belongs to, its vertex, and xyz',
+        '    static const int DynamicDeformation[DynamicDisplacementCount];',
+        '    static const int DynamicVertex[DynamicDisplacementCount];',
+        '    static const float DynamicDisplacement[DynamicDisplacementCount * 3];',
+        '',
+        '    static const int StaticDeformation[StaticDisplacementCount];',
+        '    static const int StaticVertex[StaticDisplacementCount];',
+        '    static const float StaticDisplacement[StaticDisplacementCount * 3];',
+        '};',
+        '',
+    ])
+
+    body = '\n'.join([
+        '// ' + generated,
+        '#include "models\\%s.h"' % STRUCT,
+        '',
+        'const float %s::BaseCoords[VertexCount * 3] = {' % STRUCT,
+        table([literal(c) for v in vertices for c in v], 3),
+        '};',
+        '',
+        'const int %s::Faces[FaceCount * 3] = {' % STRUCT,
+        table([str(i) for f in faces for i in f], 3),
+        '};',
+        '',
+        deformation_tables('Dynamic', dynamic),
+        '',
+        deformation_tables('Static', static),
+        '',
+    ])
+
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+    for path, text in ((os.path.join(root, 'include', 'models', STRUCT + '.h'), header),
+                       (os.path.join(root, 'src', 'models', STRUCT + '.cpp'), body)):
+        with open(path, 'w', newline='\n') as f:
+            f.write(text)
+        print('Wrote ' + os.path.normpath(path))
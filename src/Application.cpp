@@ -6,10 +6,16 @@
 
 #include "stdafx.h"
 #include "Application.h"
+#include "utils\AllocationCounter.h"
+#include "utils\Profiler.h"
+#include "utils\Timestamp.h"
 
 #include <boost\format.hpp>
+#include <cfloat>
+#include <fstream>
 
 #include <NuiApi.h>
+#include <Psapi.h>
 
 using namespace std;
 using namespace sf;
@@ -28,7 +34,37 @@ Application::Application(int argc, _TCHAR* argv[]) :
 fpsCounter(8),
 trackReliability(128),
 window(nullptr),
-levelCorrection(0.0, 1.0)
+levelCorrection(0.0, 1.0),
+frameHeapAllocations(0),
+lastTrackedFrameIndex(0),
+captureToTrackLatency(256, 0.0, 200.0, 200),
+trackToPresentLatency(256, 0.0, 200.0, 200),
+captureToPresentLatency(256, 0.0, 200.0, 200),
+trackingAge(256, 0.0, 200.0, 200),
+metricsServer(metrics_port),
+pipeline("frame", pipeline_pool_size),
+current(nullptr),
+compositor(NUI_CAMERA_COLOR_NOMINAL_VERTICAL_FOV),
+recorder(record_queue_size, record_fps),
+readback(record_readback_latency + 1),
+snapshotWriter(snapshot_backlog),
+snapshotReadback(1),
+snapshotInFlight(nullptr),
+snapshotRequested(false),
+sharedReadback(record_readback_latency + 1),
+faceCache("faces", face_cache_cpu_budget, face_cache_gpu_budget),
+facePlaylistIndex(-1),
+framesPresented(nullptr),
+framesDropped(nullptr),
+framesRepeated(nullptr),
+frameTimeHistogram(nullptr),
+captureToTrackHistogram(nullptr),
+trackToPresentHistogram(nullptr),
+captureToPresentHistogram(nullptr),
+arenaUsedGauge(nullptr),
+frameHeapAllocationsGauge(nullptr),
+recordTimeHistogram(nullptr),
+useBlendshapes(false)
 {
     // Convert command-line arguments to std::vector
     for (int i = 0; i < argc; i++)
@@ -39,13 +75,31 @@ levelCorrection(0.0, 1.0)
 
 Application::~Application()
 {
+    // Stop everything that might be using the tracker/camera first
+    metricsServer.Stop();
+    pipeline.Stop();
+
+    // Needs the GL context, so before the window goes
+    readback.Release();
+    for (auto frame : recordInFlight)
+        recorder.Discard(frame);
+    recordInFlight.clear();
+
+    snapshotReadback.Release();
+    if (snapshotInFlight != nullptr)
+        snapshotWriter.Submit(snapshotInFlight);    // Without its screenshot
+    snapshotInFlight = nullptr;
+
+    sharedReadback.Release();
+    sharedInFlight.clear();
+    sharedOutput.Close();
+
+    faceTracker.model.blendshapes.Release();
 
     if (this->window != nullptr)
         delete this->window;
 
     faceTracker.Uninitialize();
-
-    capture.Stop();
 }
 
 void Application::InitializeResources() {
@@ -55,6 +109,33 @@ void Application::InitializeResources() {
     if (!font.loadFromFile(resources_dir + this->default_font_file))
         throw runtime_error("Could not load font \"" + default_font_file + "\"");
 
+    // Status display, right-aligned text is against the right edge of the color video
+    if (sdf_text) {
+        if (!sdfFont.Generate(font))
+            throw runtime_error("Could not generate the distance field atlas for \"" + default_font_file + "\"");
+        hud.SetFont(sdfFont, status_text_size);
+    }
+    else {
+        hud.SetFont(font, status_text_size);
+    }
+    hudFps = hud.AddLabel(Vector2f(640, 0), HudLayer::AlignRight);
+    hudLatency = hud.AddLabel(Vector2f(640, 20), HudLayer::AlignRight);
+    hudStatus = hud.AddLabel(Vector2f(8, 20));
+    hudDistance = hud.AddLabel(Vector2f(8, 0));
+    hudMemory = hud.AddLabel(Vector2f(8, 40));
+    hud.SetVisible(hudMemory, advanced_view);
+
+    // Describe the face tracker's errors up front (any others are added when first seen)
+    const HRESULT trackErrors[] = {
+        FT_ERROR_INVALID_MODELS, FT_ERROR_INVALID_INPUT_IMAGE, FT_ERROR_FACE_DETECTOR_FAILED,
+        FT_ERROR_AAM_FAILED, FT_ERROR_NN_FAILED, FT_ERROR_UNINITIALIZED, FT_ERROR_INVALID_MODEL_PATH,
+        FT_ERROR_EVAL_FAILED, FT_ERROR_INVALID_CAMERA_CONFIG, FT_ERROR_INVALID_3DHINT,
+        FT_ERROR_HEAD_SEARCH_FAILED, FT_ERROR_USER_LOST, FT_ERROR_KINECT_DLL_FAILED,
+        FT_ERROR_KINECT_NOT_CONNECTED,
+    };
+    for (HRESULT hr : trackErrors)
+        trackStatusText[hr] = ft_error("", hr).what();
+
 
     // Load shaders
     if (!outlineShader.loadFromFile(resources_dir + "shaders\\outline-shader.frag", Shader::Type::Fragment))
@@ -63,13 +144,73 @@ void Application::InitializeResources() {
     outlineShader.setParameter("outlineColor", Color::Black);
     outlineShader.setParameter("outlineWidth", 0.008f);
 
+    if (!sdfTextShader.loadFromFile(resources_dir + "shaders\\sdf-text.frag", Shader::Type::Fragment))
+        throw runtime_error("Could not load shader \"sdf-text.frag\"");
+
+    // Widths are in field units, where 0.5 is the atlas' whole spread (8px at 64px, so 2px at 16px)
+    sdfTextShader.setParameter("outlineColor", Color::Black);
+    sdfTextShader.setParameter("outlineWidth", 0.25f);
+    sdfTextShader.setParameter("glowColor", Color(0, 0, 0, 96));
+    sdfTextShader.setParameter("glowWidth", 0.2f);
+
     if (!blendShader.loadFromFile(resources_dir + "shaders\\face-blend.frag", Shader::Type::Fragment))
         throw runtime_error("Could not laod shader \"face-blend.frag\"");
 
+    // Load camera calibration, used to register depth to color
+    if (!calibration.Load(resources_dir + calibration_file))
+        throw runtime_error("Could not load camera calibration \"" + calibration_file + "\"");
+    depthRegistration.Initialize(calibration);
+
     
     cout << "Loading face model" << endl;
-    if (!faceTracker.model.LoadMesh(resources_dir + "faces\\candide3_textured.wfm"))
+    const string faceFile = resources_dir + "faces\\candide3_textured.wfm";
+    faceTracker.model.SetTextureCache(texture_cache_dir);
+
+    // Loaded once, through the cache like the playlist's faces, so every frame carries the mesh
+    // and texture it was deformed with. Frames are never drawn from the tracker's model, which
+    // the deform stage switches to another face when one is chosen.
+    faceCache.SetTextureCache(texture_cache_dir);
+    deformFace = faceCache.Acquire(faceFile);
+    if (!deformFace || !faceTracker.model.LoadMesh(deformFace))
         throw runtime_error("Error loading mesh 'candide3_textured.wfm'");
+    nextFace = deformFace;
+
+    if (!detail_mesh_file.empty()) {
+        if (!faceTracker.model.LoadDetailMesh(resources_dir + "faces\\" + detail_mesh_file))
+            throw runtime_error("Error loading detail mesh '" + detail_mesh_file + "'");
+        cout << "Drawing detail mesh '" << detail_mesh_file << "' (" << faceTracker.model.detailMesh.nVertices() << " vertices)" << endl;
+    }
+    else if (face_subdivision_levels > 0) {
+        if (!faceTracker.model.SubdivideMesh(face_subdivision_levels))
+            throw runtime_error("Could not subdivide the face mesh " + to_string(face_subdivision_levels) + " times");
+    }
+
+    if (!face_playlist.empty()) {
+        if (software_compositing || faceTracker.model.HasDetailMesh())
+            throw runtime_error("A face playlist can't be used with software compositing, or a detail or subdivided mesh");
+
+        ifstream playlist(resources_dir + "faces\\" + face_playlist);
+        if (!playlist.is_open())
+            throw runtime_error("Could not load face playlist '" + face_playlist + "'");
+
+        string line;
+        while (getline(playlist, line)) {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (!line.empty() && line[0] != '#')
+                facePlaylist.push_back(resources_dir + "faces\\" + line);
+        }
+        cout << "Face playlist '" << face_playlist << "': " << facePlaylist.size() << " faces (F8 for the next)" << endl;
+
+        // Have the first ones ready for F8
+        int count = (face_prefetch_count < static_cast<int>(facePlaylist.size())) ? face_prefetch_count : static_cast<int>(facePlaylist.size());
+        faceCache.Prefetch(vector<string>(facePlaylist.begin(), facePlaylist.begin() + count));
+    }
+
+    if (software_compositing) {
+        compositor.SetMesh(faceTracker.model.mesh);
+        compositor.SetTexture(faceTracker.model.GetFaceTexture());
+        compositor.SetTileParallel(true);
+    }
     
     // You can use this to save the candide model as a VRML mesh file
     //if (!faceMesh.write("candide3.wrl"))
@@ -105,6 +246,29 @@ void Application::InitializeWindow() {
 
     initialSize = window->getSize();
 
+    if (!readback.Initialize())
+        cout << "Pixel buffer objects not available, recordings will not include the face overlay" << endl;
+    snapshotReadback.Initialize();
+
+    if (shared_output_enabled) {
+        cv::Size colorSize = capture.GetColorSize();
+        if (sharedOutput.Create(shared_output_name, shared_output_slots, colorSize.width, colorSize.height,
+                shared_output_max_width, shared_output_max_height))
+            cout << "Publishing frames to " << shared_output_name << endl;
+        sharedReadback.Initialize();
+    }
+
+    // Deform the face in the vertex shader if it can be (not when compositing on the CPU, or driving
+    // a detail or subdivided mesh, which need the vertices, or switching between playlist faces)
+    if (gpu_blendshapes && !software_compositing && !faceTracker.model.HasDetailMesh() && facePlaylist.empty()) {
+        useBlendshapes =
+            blendshapeShader.loadFromFile(resources_dir + "shaders\\blendshapes.vert", resources_dir + "shaders\\face-blend.frag") &&
+            blendshapeWireShader.loadFromFile(resources_dir + "shaders\\blendshapes.vert", Shader::Type::Vertex) &&
+            faceTracker.model.blendshapes.Initialize(faceTracker.model.mesh);
+        if (!useBlendshapes)
+            cout << "Vertex shader blendshapes not available, deforming the face mesh on the CPU" << endl;
+    }
+
     cout << "Started" << endl;
 }
 
@@ -142,8 +306,28 @@ int Application::Main()
 {
     InitializeResources();
 
-    capture.Initialize();
-    faceTracker.Initialize();
+    // Command line: [--replay <file.oni>] [user]
+    //  --replay plays back a recording instead of using the camera
+    //  user is used to persist their face shape between sessions
+    string replayFile, user;
+    for (size_t i = 1; i < args.size(); i++) {
+        string arg(args[i].begin(), args[i].end()); // wstring to string (don't care about unicode)
+        if (arg == "--replay" && i + 1 < args.size()) {
+            i++;
+            replayFile = string(args[i].begin(), args[i].end());
+        }
+        else
+            user = arg;
+    }
+
+    capture.Initialize(replayFile);
+    faceTracker.Initialize(calibration);
+
+    InitializeMetrics();
+    InitializePipeline();
+
+    if (!user.empty())
+        faceTracker.model.SetUserProfile(profiles_dir + user + ".su");
     
     InitializeWindow();
     
@@ -153,10 +337,24 @@ int Application::Main()
     depthImage = cv::Mat(480, 640, CV_32F);
     depthRaw = cv::Mat(480, 640, CV_16U);
 
-    capture.Start();
+    Profiler::SetThreadName("Render");
+
+    // By default only use the cores the pipeline stages and this thread leave free
+    int workers = worker_threads;
+    if (workers < 0)
+        workers = TaskScheduler::SpareThreadCount(static_cast<int>(pipeline.GetStageCount()) + 1);
+    TaskScheduler::Default().SetThreadCount(workers);
+
+    pipeline.Start(pin_pipeline_threads);
+
+    if (metricsServer.IsListening())
+        metricsServer.Start();
 
     while (this->window->isOpen()) {
 
+        // Rethrow anything that went wrong on the pipeline threads
+        pipeline.CheckError();
+
         // Handle screen events
         Event event;
         while (window->pollEvent(event)) {
@@ -179,9 +377,13 @@ int Application::Main()
         fpsCounter.BeginPeriod();
 
         // Drawing loop
-        Draw();
+        {
+            PROFILE_SCOPE("Frame");
+            Draw();
+        }
 
         fpsCounter.EndPeriod();
+        frameTimeHistogram->Observe(fpsCounter.GetCurrentInterval() * 1000.0);
     }
 
     return 0;
@@ -193,22 +395,65 @@ void Application::OnKeyPress(sf::Event e) {
         window->close();
         break;
 
+    case Keyboard::F8:
+        // Switch to the next face in the playlist
+        if (!facePlaylist.empty())
+            SelectFace((facePlaylistIndex + 1) % static_cast<int>(facePlaylist.size()));
+        break;
+
     case Keyboard::F11:
-        // Save current color/depth streams to disk
-        cv::Mat colorTemp;
-        cv::cvtColor(colorImage, colorTemp, cv::COLOR_BGR2RGB);
-        cv::imwrite(capture_dir + "color.png", colorTemp);
+        // Save the current color/depth streams and a screenshot to disk (see TakeSnapshot)
+        snapshotRequested = true;
+        break;
+
+    case Keyboard::F9:
+        // Start/stop recording video
+        if (recorder.IsRecording()) {
+            recorder.StopRecording();
+            cout << "Stopping recording" << endl;
+        }
+        else {
+            recorder.StartRecording(capture_dir + "recording", record_raw_streams);
+        }
+        break;
+
+    case Keyboard::F10:
+        // Dump latency statistics
+        if (WriteMetrics(capture_dir + "metrics.txt"))
+            cout << "Wrote " << capture_dir << "metrics.txt" << endl;
+        else
+            cout << "Could not write " << capture_dir << "metrics.txt" << endl;
+        break;
+
+    case Keyboard::F12:
+        // Save the recent profiler events, viewable in chrome://tracing
+        if (Profiler::WriteChromeTrace(capture_dir + "trace.json"))
+            cout << "Wrote " << capture_dir << "trace.json" << endl;
+        else
+            cout << "Could not write " << capture_dir << "trace.json" << endl;
+        break;
+    }
+}
 
-        cv::Mat depthTemp;
-        cv::normalize(depthImage, depthTemp, 0.0, 255.0, cv::NORM_MINMAX, CV_8U);
-        cv::applyColorMap(depthTemp, depthTemp, cv::COLORMAP_JET);
-        cv::imwrite(capture_dir + "depthraw.png", depthRaw);
-        cv::imwrite(capture_dir + "depth.png", depthTemp);
+void Application::SelectFace(int index) {
+    const string& filename = facePlaylist[index];
+    facePlaylistIndex = index;
 
-        // Capture screenshot of window
-        sf::Image screenshot = window->capture();
-        screenshot.saveToFile(capture_dir + "screenshot.png");
+    // Usually prefetched already, otherwise this loads it
+    shared_ptr<const FaceAsset> face = faceCache.Acquire(filename);
+    if (face && CustomFaceModel::CanDrive(face->mesh)) {
+        lock_guard<mutex> lock(faceMutex);
+        nextFace = face;
+    }
+    else {
+        cout << "Could not use face '" << filename << "'" << endl;
     }
+
+    // Load the faces after it meanwhile
+    vector<string> upcoming;
+    for (int i = 1; i <= face_prefetch_count && i < static_cast<int>(facePlaylist.size()); i++)
+        upcoming.push_back(facePlaylist[(index + i) % facePlaylist.size()]);
+    faceCache.Prefetch(upcoming);
 }
 
 void cvApplyAlpha(cv::Mat rgb_in, cv::Mat alpha_in, cv::Mat &rgba_out) {
@@ -221,24 +466,54 @@ void cvApplyAlpha(cv::Mat rgb_in, cv::Mat alpha_in, cv::Mat &rgba_out) {
 }
 
 void Application::Draw() {
+    // Release last frame's temporaries
+    frameArena.Reset();
+    unsigned long long allocationsStart = AllocationCounter::GetAllocationCount();
+
     //glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     window->clear(Color::White);
 
-    // Retrieve captured video color/depth frames
-    capture.GetFrame(&colorImage, &depthRaw);
-    depthRaw.convertTo(depthImage, CV_32F);  // Most OpenCV functions only support 8U or 32F
+    // Take the newest frame out of the pipeline (any older ones are skipped)
+    {
+        PROFILE_SCOPE("Receive");
+        FramePacket* packet;
+        while (pipeline.TryReceive(packet)) {
+            pipeline.Release(current);
+            current = packet;
+            newFrame = true;
+        }
+    }
 
-    // Try track the face in the current frame
-    faceTracker.Track(colorImage, depthRaw);
+    // Upload a prefetched face, and keep the face cache within its budgets
+    if (!facePlaylist.empty())
+        faceCache.Update();
+
+    if (current == nullptr) {
+        // Nothing captured yet
+        window->display();
+        return;
+    }
 
-    // Custom processing on frame
-    Process();
+    bool newPacket = newFrame;
+    if (newFrame) {
+        colorImage = current->color;
+        depthImage = current->depth;
+        depthRaw = current->depthRaw;
+        frameInfo = current->info;
+        if (current->isTracked)
+            trackedFrameInfo = frameInfo;
+
+        // Custom processing on frame
+        PROFILE_SCOPE("Process");
+        Process();
+        newFrame = false;
+    }
 
-    // If screen-space shaders are enabled, create a render texture target to draw to.
-    RenderTexture tex;
+    // If screen-space shaders are enabled, draw to a render texture instead
+    RenderTexture& tex = ssfxTexture;
     if (ssfx_enabled) {
-        //TODO: Instead of creating a texture every frame, only create when initialized & resized
-        tex.create(window->getSize().x, window->getSize().y, true);
+        if (tex.getSize() != window->getSize())
+            tex.create(window->getSize().x, window->getSize().y, true);
         tex.clear(Color::White);
         tex.setView(window->getView());
 
@@ -249,11 +524,17 @@ void Application::Draw() {
 
     // Draw video stream
     target->pushGLStates();
-    DrawVideo(target);
+    {
+        PROFILE_SCOPE("DrawVideo");
+        DrawVideo(target);
+    }
 
     // Draw 3D geometry
     target->popGLStates();
-    Draw3D(target);
+    {
+        PROFILE_SCOPE("Draw3D");
+        Draw3D(target);
+    }
     target->pushGLStates();
 
 
@@ -269,31 +550,281 @@ void Application::Draw() {
         window->draw(sf::Sprite(tex.getTexture()));
     }
 
+    // Record what's been drawn so far (without the status text)
+    if (recorder.IsRecording() || !recordInFlight.empty()) {
+        PROFILE_SCOPE("Record");
+        RecordFrame();
+    }
+
+    if (sharedOutput.IsOpen()) {
+        PROFILE_SCOPE("Publish");
+        PublishFrame(newPacket);
+    }
+
     // Draw status information on top (not affected by the shader)
     if (show_status) {
+        PROFILE_SCOPE("DrawStatus");
         DrawStatus(window);
     }
 
     target->popGLStates();
 
+    if (snapshotRequested || snapshotInFlight != nullptr) {
+        PROFILE_SCOPE("Snapshot");
+        TakeSnapshot();
+    }
+
     // Finally update the screen
-    window->display();
+    {
+        PROFILE_SCOPE("display");
+        window->display();
+    }
+
+    frameInfo.presentTime = Profiler::Now();
+    UpdateLatency();
+
+    frameHeapAllocations = AllocationCounter::GetAllocationCount() - allocationsStart;
+
+    framesPresented->Increment();
+    arenaUsedGauge->Set(static_cast<double>(frameArena.GetUsed()));
+    frameHeapAllocationsGauge->Set(static_cast<double>(frameHeapAllocations));
 }
 
-void Application::Process() {
+void Application::RecordFrame() {
+    long long start = Profiler::Now();
+
+    // Collect the readback started record_readback_latency frames ago: by now the GPU has
+    // finished copying it, so mapping it doesn't wait. After recording stops the ones still
+    // in flight are collected the same way.
+    if (!recordInFlight.empty() &&
+        (readback.GetPending() >= record_readback_latency || !recorder.IsRecording())) {
+        VideoRecorder::Frame* frame = recordInFlight.front();
+        recordInFlight.pop_front();
+
+        if (readback.Collect(&frame->output))
+            recorder.Submit(frame);
+        else
+            recorder.Discard(frame);
+    }
+
+    if (recorder.IsRecording()) {
+        // Null if the recorder is behind, in which case this frame is dropped
+        VideoRecorder::Frame* frame = recorder.Acquire();
+        if (frame != nullptr) {
+            frame->frameIndex = frameInfo.frameIndex;
+            if (recorder.IsRecordingRawStreams()) {
+                current->color.copyTo(frame->color);
+                current->depthRaw.copyTo(frame->depthRaw);
+            }
+
+            if (readback.IsAvailable()) {
+                Vector2u size = window->getSize();
+                if (readback.Begin(size.x, size.y)) {
+                    frame->outputConversion = cv::COLOR_BGRA2BGR;
+                    frame->flipOutput = true;
+                    recordInFlight.push_back(frame);
+                }
+                else {
+                    recorder.Discard(frame);
+                }
+            }
+            else {
+                // No readback, so record the video frame as composited on the CPU (which
+                // only includes the face with software_compositing)
+                current->colorBGRA.copyTo(frame->output);
+                frame->outputConversion = cv::COLOR_RGBA2BGR;
+                frame->flipOutput = false;
+                recorder.Submit(frame);
+            }
+        }
+    }
+
+    recordTimeHistogram->Observe(Profiler::TicksToSeconds(Profiler::Now() - start) * 1000.0);
+}
+
+void Application::TakeSnapshot() {
+    // The screenshot started last frame has been copied by now
+    if (snapshotInFlight != nullptr) {
+        if (!snapshotReadback.Collect(&snapshotInFlight->screenshot))
+            snapshotInFlight->screenshot.release();
+        snapshotWriter.Submit(snapshotInFlight);
+        snapshotInFlight = nullptr;
+    }
+
+    if (!snapshotRequested)
+        return;
+    snapshotRequested = false;
+
+    SnapshotWriter::Snapshot* snapshot = snapshotWriter.Acquire();
+    if (snapshot == nullptr) {
+        cout << "Still writing earlier snapshots, skipped" << endl;
+        return;
+    }
+
+    snapshot->prefix = capture_dir + "snapshot-" + FormatTimestamp();
+    colorImage.copyTo(snapshot->color);
+    depthImage.copyTo(snapshot->depth);
+    depthRaw.copyTo(snapshot->depthRaw);
+
+    Vector2u size = window->getSize();
+    if (snapshotReadback.Begin(size.x, size.y)) {
+        snapshot->screenshotConversion = cv::COLOR_BGRA2BGR;
+        snapshot->flipScreenshot = true;
+        snapshotInFlight = snapshot;
+    }
+    else {
+        // No pixel buffer objects, so read the window straight away (which waits for the GPU,
+        // but is still much quicker than encoding it here)
+        snapshot->screenshot.create(size.y, size.x, CV_8UC4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, snapshot->screenshot.data);
+        snapshot->screenshotConversion = cv::COLOR_RGBA2BGR;
+        snapshot->flipScreenshot = true;
+        snapshotWriter.Submit(snapshot);
+    }
+}
+
+void Application::PublishFrame(bool newPacket) {
+    // As with recording, collect the window a few frames after it was drawn (straight into the
+    // shared slot), then publish it. Between packets nothing new is begun, so the oldest is
+    // collected anyway rather than held until the next packet arrives.
+    if (!sharedInFlight.empty() && (sharedReadback.GetPending() >= record_readback_latency || !newPacket)) {
+        int slot = sharedInFlight.front().first;
+        cv::Size size = sharedInFlight.front().second;
+        sharedInFlight.pop_front();
+
+        cv::Mat output = sharedOutput.GetOutput(slot, size.width, size.height);
+        if (sharedReadback.Collect(&output))
+            sharedOutput.Publish(slot, size.width, size.height, SharedFrame::OutputBGRA, true);
+        else
+            sharedOutput.Publish(slot, 0, 0, SharedFrame::OutputNone, false);
+    }
+
+    // Each packet is published once, not again on every window refresh until the next one
+    if (!newPacket)
+        return;
+
+    // (published straight away below if there's no readback to wait for: SharedFrameOutput
+    // holds it back until the slots still in flight before it are published)
+    int slot = sharedOutput.Begin(*current);
+    if (slot < 0)
+        return;
+
+    Vector2u windowSize = window->getSize();
+    cv::Size size(windowSize.x, windowSize.y);
+
+    if (sharedReadback.IsAvailable()) {
+        if (!sharedOutput.GetOutput(slot, size.width, size.height).empty() && sharedReadback.Begin(size.width, size.height))
+            sharedInFlight.push_back(std::make_pair(slot, size));
+        else
+            sharedOutput.Publish(slot, 0, 0, SharedFrame::OutputNone, false);     // Window too big
+    }
+    else {
+        // No readback, so publish the video frame as composited on the CPU (which only includes
+        // the face with software_compositing)
+        const cv::Mat& composited = current->colorBGRA;
+        cv::Mat output = sharedOutput.GetOutput(slot, composited.cols, composited.rows);
+        if (!output.empty()) {
+            composited.copyTo(output);
+            sharedOutput.Publish(slot, composited.cols, composited.rows, SharedFrame::OutputRGBA, false);
+        }
+        else {
+            sharedOutput.Publish(slot, 0, 0, SharedFrame::OutputNone, false);
+        }
+    }
+}
+
+bool Application::ConvertFrame(FramePacket& packet, FrameArena& arena) {
+    // Warp depth into the color camera, so depth can be sampled at color pixel coordinates
+    depthRegistration.Apply(packet.depthRaw, packet.depthRegistered);
+
+    // Most OpenCV functions only support 8U or 32F
+    packet.depth.create(packet.depthRegistered.size(), CV_32F);
+    TaskScheduler::Default().ParallelFor(0, packet.depth.rows, parallel_band_rows, [&](int y0, int y1) {
+        cv::Mat band = packet.depth.rowRange(y0, y1);
+        packet.depthRegistered.rowRange(y0, y1).convertTo(band, CV_32F);
+    });
+    return true;
+}
+
+bool Application::TrackFrame(FramePacket& packet, FrameArena& arena) {
+    // Try track the face in the current frame
+    faceTracker.Track(packet.color, packet.depthRaw, packet.depthRegistered);
+    packet.info.trackTime = Profiler::Now();
+
+    // Copy the results, since the tracker moves on to the next frame
+    packet.isTracked = faceTracker.isTracked;
+    packet.trackStatus = faceTracker.GetTrackStatus();
+
+    // NOTE: rect is guaranteed to be within image bounds
+    RECT rect = faceTracker.faceRect;
+    packet.faceRect = cv::Rect(rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top);
+    packet.faceDepth = faceTracker.faceDepth;
+    packet.scale = faceTracker.scale;
+    packet.rotation = faceTracker.rotation;
+    packet.translation = faceTracker.translation;
+
+    if (packet.isTracked) {
+        packet.actionUnits = faceTracker.model.actionUnits;
+        packet.shapeUnits = faceTracker.model.shapeUnits;
+        packet.shapeUnitsVersion = faceTracker.model.GetShapeUnitsVersion();
+    }
+    return true;
+}
+
+bool Application::DeformFrame(FramePacket& packet, FrameArena& arena) {
+    packet.face = nullptr;
+    if (!packet.isTracked)
+        return true;
+
+    // Switch to the face chosen on the render thread (F8), between frames
+    shared_ptr<const FaceAsset> face;
+    {
+        lock_guard<mutex> lock(faceMutex);
+        face = nextFace;
+    }
+    if (face && face != deformFace) {
+        faceTracker.model.SetFace(face->mesh);
+        deformFace = face;
+    }
+    packet.face = deformFace;
+
+    if (useBlendshapes)
+        faceTracker.model.GetCoefficients(packet.actionUnits, packet.shapeUnits, &packet.coefficients);
+    else
+        faceTracker.model.Deform(packet.actionUnits, packet.shapeUnits, packet.shapeUnitsVersion, &packet.vertices);
+
+    if (faceTracker.model.HasDetailMesh()) {
+        PROFILE_SCOPE("Transfer");
+        faceTracker.model.TransferToDetail(packet.vertices, &packet.detailVertices);
+    }
+    return true;
+}
+
+bool Application::PrepareComposite(FramePacket& packet, FrameArena& arena) {
 
     bool removeBackground = false;
 
+    TaskScheduler& scheduler = TaskScheduler::Default();
 
-    // Segment background
-    cv::Mat mask_segment;
-    cv::Mat mask_valid;
-    cv::threshold(depthImage, mask_segment, this->depth_threshold, 255.0, cv::THRESH_BINARY_INV);
-    cv::threshold(depthImage, mask_valid, 1, 255.0, cv::THRESH_BINARY);
 
-    cv::Mat depth_mask;
-    cv::bitwise_and(mask_segment, mask_valid, depth_mask);
-    depth_mask.convertTo(depth_mask, CV_8U);
+    // Segment background
+    cv::Mat depth_mask = arena.NewMat();
+    {
+        PROFILE_SCOPE("Segment");
+
+        // Pixels with a valid depth, nearer than the threshold
+        const float threshold = static_cast<float>(this->depth_threshold);
+        depth_mask.create(packet.depth.size(), CV_8U);
+        scheduler.ParallelFor(0, packet.depth.rows, parallel_band_rows, [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++) {
+                const float* d = packet.depth.ptr<float>(y);
+                unsigned char* m = depth_mask.ptr<unsigned char>(y);
+                for (int x = 0; x < packet.depth.cols; x++)
+                    m[x] = (d[x] > 1.0f && d[x] <= threshold) ? 255 : 0;
+            }
+        });
+    }
 
     //cv::Mat kernel(3, 3, CV_8U, cv::Scalar(1));
     //cv::morphologyEx(depth_mask, depth_mask, cv::MORPH_OPEN, kernel);
@@ -308,61 +839,100 @@ void Application::Process() {
 
     // Display
 
-    cv::Mat depthImageDisplay = depthImage;
+    cv::Mat depthImageDisplay = arena.NewMat();
+    {
+        PROFILE_SCOPE("Depth colormap");
+        depthImageDisplay.create(packet.depth.size(), CV_8UC3);
+        ColorizeDepth(packet.depth, depthImageDisplay, arena);
 
-    cv::normalize(depthImageDisplay, depthImageDisplay, 0.0, 255.0, cv::NORM_MINMAX, CV_8U);
+        //if (removeBackground)
+            //cv::bitwise_and(depthImageDisplay, depthImageDisplay, depthImageDisplay);
+            //cv::threshold(depthImageDisplay, depthImageDisplay, this->depth_threshold, 0.0, cv::THRESH_TOZERO_INV);
 
-    //if (removeBackground)
-        //cv::bitwise_and(depthImageDisplay, depthImageDisplay, depthImageDisplay);
-        //cv::threshold(depthImageDisplay, depthImageDisplay, this->depth_threshold, 0.0, cv::THRESH_TOZERO_INV);
+        //cv::normalize(depthImageDisplay, depthImageDisplay, 0.0, 255.0, cv::NORM_MINMAX, CV_8U);
 
-    //cv::normalize(depthImageDisplay, depthImageDisplay, 0.0, 255.0, cv::NORM_MINMAX, CV_8U);
+        //depthImageDisplay = 255 - depthImageDisplay;
 
-    //depthImageDisplay = 255 - depthImageDisplay;
+        // Create a mask for depth pixels with an invalid value
+        //cv::Mat depthErrorMask;
+        //cv::threshold(depthImageDisplay, depthErrorMask, 254, 0, cv::THRESH_TOZERO);
 
-    // Create a mask for depth pixels with an invalid value
-    //cv::Mat depthErrorMask;
-    //cv::threshold(depthImageDisplay, depthErrorMask, 254, 0, cv::THRESH_TOZERO);
+        //cv::medianBlur(depthImage, depthImage, 13);
 
-    //cv::medianBlur(depthImage, depthImage, 13);
+        //cv::cvtColor(depthErrorMask, depthErrorMask, cv::COLOR_GRAY2RGB);
+        //cv::bitwise_and(depthImageDisplay, ~depthErrorMask, depthImageDisplay);
+    }
 
-    // Map depth to JET color ma6p, and mask any invalid pixels to 0
-    cv::applyColorMap(depthImageDisplay, depthImageDisplay, cv::COLORMAP_JET);
-    //cv::cvtColor(depthErrorMask, depthErrorMask, cv::COLOR_GRAY2RGB);
-    //cv::bitwise_and(depthImageDisplay, ~depthErrorMask, depthImageDisplay);
+    // Convert images to OpenGL texture format (uploaded on the render thread)
+    {
+        PROFILE_SCOPE("Texture convert");
 
-    // Convert images to OpenGL textures
-    cv::Mat image1;
-    cv::cvtColor(colorImage, image1, cv::COLOR_BGR2BGRA); // OpenGL texture must be in BGRA format
+        // OpenGL texture must be in BGRA format
+        packet.colorBGRA.create(packet.color.size(), CV_8UC4);
+        packet.depthBGRA.create(depthImageDisplay.size(), CV_8UC4);
+        scheduler.ParallelFor(0, packet.color.rows, parallel_band_rows, [&](int y0, int y1) {
+            cv::Mat colorBand = packet.colorBGRA.rowRange(y0, y1);
+            cv::cvtColor(packet.color.rowRange(y0, y1), colorBand, cv::COLOR_BGR2BGRA);
 
-    if (removeBackground)
-        cvApplyAlpha(colorImage, depth_mask, image1);
+            //cv::cvtColor(depthImageDisplay, depthImageDisplay, cv::COLOR_GRAY2BGRA);
+            cv::Mat depthBand = packet.depthBGRA.rowRange(y0, y1);
+            cv::cvtColor(depthImageDisplay.rowRange(y0, y1), depthBand, cv::COLOR_RGB2BGRA);
+        });
 
-    colorTexture.create(image1.cols, image1.rows);
-    colorTexture.update(image1.data, image1.cols, image1.rows, 0, 0);
+        if (removeBackground)
+            cvApplyAlpha(packet.color, depth_mask, packet.colorBGRA);
 
-    cv::Mat image2;
-    //cv::cvtColor(depthImageDisplay, depthImageDisplay, cv::COLOR_GRAY2BGRA);
-    cv::cvtColor(depthImageDisplay, image2, cv::COLOR_RGB2BGRA);
-    
-    if (removeBackground)
-        cvApplyAlpha(depthImageDisplay, depth_mask, image2);
+        if (removeBackground)
+            cvApplyAlpha(depthImageDisplay, depth_mask, packet.depthBGRA);
+    }
 
-    depthTexture.create(image2.cols, image2.rows);
-    depthTexture.update(image2.data, image2.cols, image2.rows, 0, 0);
+    // Capture face texture and analyze luminance levels
+    if (packet.isTracked && packet.faceRect.area() > 0) {
+        PROFILE_SCOPE("AnalyzeLevels");
+        cv::Mat faceImage = arena.NewMat();
+        packet.color(packet.faceRect).copyTo(faceImage);
+
+        packet.levelCorrection = AnalyzeLevels(faceImage, arena);
+
+        //TODO: Limit histogram analysis to face-coloured pixels
+    }
+
+    // Draw the face straight into the video frame, instead of with OpenGL in Draw3D
+    if (software_compositing && packet.isTracked) {
+        PROFILE_SCOPE("Composite");
+        compositor.Draw(packet.colorBGRA, packet.vertices, packet.rotation, packet.translation, packet.levelCorrection);
+    }
+
+    return true;
+}
+
+void Application::Process() {
+    // Upload the prepared images to OpenGL textures
+    {
+        PROFILE_SCOPE("Texture upload");
+        // (only recreated if the size changes, otherwise just updated in place)
+        const cv::Mat& image1 = current->colorBGRA;
+        if (colorTexture.getSize() != Vector2u(image1.cols, image1.rows))
+            colorTexture.create(image1.cols, image1.rows);
+        colorTexture.update(image1.data, image1.cols, image1.rows, 0, 0);
+
+        const cv::Mat& image2 = current->depthBGRA;
+        if (depthTexture.getSize() != Vector2u(image2.cols, image2.rows))
+            depthTexture.create(image2.cols, image2.rows);
+        depthTexture.update(image2.data, image2.cols, image2.rows, 0, 0);
+    }
 
 
     // Get face bounds
-    // NOTE: rect is guaranteed to be within image bounds
-    RECT rect = faceTracker.faceRect;
-    face_size = cv::Size(rect.right - rect.left, rect.bottom - rect.top);
-    face_offset = cv::Point(rect.left, rect.top);
+    face_size = current->faceRect.size();
+    face_offset = current->faceRect.tl();
     face_center = cv::Point(face_offset.x + face_size.width / 2, face_offset.y + face_size.height / 2);
 
-    if (faceTracker.isTracked) {
+    if (current->isTracked) {
 
-        // Calculate distance at face center
-        raw_depth = depthImage.at<float>(face_center.y, face_center.x);
+        // Robust distance to the face, estimated by the tracker
+        raw_depth = current->faceDepth;
+        levelCorrection = current->levelCorrection;
     }
     else {
         raw_depth = NAN;
@@ -393,6 +963,8 @@ void Application::Draw3D(RenderTarget* target) {
     glDisable(GL_DEPTH_TEST);
 
     blendShader.setParameter("iResolution", sf::Vector2f(window->getSize()));
+    if (useBlendshapes)
+        blendshapeShader.setParameter("iResolution", sf::Vector2f(window->getSize()));
 
     //// Draw XYZ marker ////
 
@@ -424,7 +996,9 @@ void Application::Draw3D(RenderTarget* target) {
 
     //// Draw face mesh ////
 
-    if (faceTracker.isTracked) {
+    if (current->isTracked && current->face) {
+        const FaceAsset& face = *current->face;
+
         glClear(GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
 
@@ -443,110 +1017,337 @@ void Application::Draw3D(RenderTarget* target) {
             0.f, 1.f, 0.f);
         glScalef(-1.f, 1.f, 1.f);
 
-        glTranslatef(faceTracker.translation.x, faceTracker.translation.y, faceTracker.translation.z);
-
-        glRotatef(faceTracker.rotation.x, 1.f, 0.f, 0.f);
-        glRotatef(faceTracker.rotation.y, 0.f, 1.f, 0.f);
-        glRotatef(faceTracker.rotation.z, 0.f, 0.f, 1.f);
-
-        // Draw textured face
-        glEnable(GL_TEXTURE_2D);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glColor3f(1.f, 1.f, 1.f);
+        glTranslatef(current->translation.x, current->translation.y, current->translation.z);
 
-        // Capture face texture and analyze luminance levels
-        if (face_size.width > 0 && face_size.height > 0) {
-            faceImage = colorImage(cv::Rect(face_offset, face_size)).clone();
-            levelCorrection = AnalyzeLevels(faceImage);
+        glRotatef(current->rotation.x, 1.f, 0.f, 0.f);
+        glRotatef(current->rotation.y, 0.f, 1.f, 0.f);
+        glRotatef(current->rotation.z, 0.f, 0.f, 1.f);
 
-            //TODO: Limit histogram analysis to face-coloured pixels
-        }
+        // Draw textured face (unless it's already been composited into the video)
+        if (!software_compositing) {
+            glEnable(GL_TEXTURE_2D);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glColor3f(1.f, 1.f, 1.f);
 
-        blendShader.setParameter("overlayTexture", faceTracker.model.texture);
-        blendShader.setParameter("backgroundTexture", colorTexture);
-        blendShader.setParameter("lumaCorrect", levelCorrection);
+            // (luminance levels were analyzed in PrepareComposite)
+            bool detail = faceTracker.model.HasDetailMesh();
+            sf::Shader& shader = useBlendshapes ? blendshapeShader : blendShader;
+            // (names too long for std::string's small buffer are made once, not every frame)
+            static const string backgroundTextureName = "backgroundTexture";
+            shader.setParameter("overlayTexture", detail ? faceTracker.model.detailTexture : face.texture);
+            shader.setParameter(backgroundTextureName, colorTexture);
+            shader.setParameter("lumaCorrect", levelCorrection);
        
-        //sf::Texture::bind(&faceTracker.model.texture);
-        sf::Shader::bind(&blendShader);
-
-        faceTracker.model.DrawGL();
-
-        sf::Texture::bind(NULL);
-        sf::Shader::bind(NULL);
+            //sf::Texture::bind(&faceTracker.model.texture);
+            sf::Shader::bind(&shader);
+
+            // (blendshapes and the detail mesh are only used without a playlist, so the model never changes under them)
+            if (useBlendshapes)
+                faceTracker.model.DrawBlendshapes(current->coefficients);
+            else if (detail)
+                faceTracker.model.DrawDetailGL(current->detailVertices);
+            else
+                CustomFaceModel::DrawGL(current->vertices, face.mesh);
+
+            sf::Texture::bind(NULL);
+            sf::Shader::bind(NULL);
+        }
 
         // Draw wireframe face mesh
         if (draw_face_wireframe) {
             glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
             glDisable(GL_TEXTURE_2D);
             glColor3f(1.f, 1.f, 1.f);
-            faceTracker.model.DrawGL();
+            if (useBlendshapes) {
+                sf::Shader::bind(&blendshapeWireShader);
+                faceTracker.model.DrawBlendshapes(current->coefficients);
+                sf::Shader::bind(NULL);
+            }
+            else if (faceTracker.model.HasDetailMesh()) {
+                faceTracker.model.DrawDetailGL(current->detailVertices);
+            }
+            else {
+                CustomFaceModel::DrawGL(current->vertices, face.mesh);
+            }
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         }
     }
 }
 
 void Application::DrawStatus(RenderTarget* target) {
-    // Draw status text
-    boost::format fps_fmt("%.1f (%.1f) FPS");
-    fps_fmt % fpsCounter.GetAverageFps();
-    fps_fmt % capture.fpsCounter.GetAverageFps();
-    //Text text_fps((boost::format("%.1f FPS") % fpsCounter.GetAverageFps()).str(), font, 16);
-    Text text_fps(fps_fmt.str(), font, 16);
-    text_fps.move(colorImage.cols - text_fps.getLocalBounds().width, 0);
-    text_fps.setColor(Color::White);
-    target->draw(text_fps, &outlineShader);
-
-    Text text_status(GetTrackingStatus(), font, 16);
-    text_status.move(8, 20);
-    text_status.setColor(Color::White);
-    target->draw(text_status, &outlineShader);
-
-    /*Text text_track((boost::format("Reliability %.2f%%") % (trackReliability.GetAverage() * 100.0f)).str(), font, 16);
-    text_track.move(8, 0);
-    text_track.setColor(Color::White);
-    window->draw(text_track, &outlineShader);*/
-
-    Text text_dist(
-        (!isnan(raw_depth)) ? (boost::format("Distance %.1fmm") % raw_depth).str() : "Distance --", 
-        font, 16);
-    text_dist.move(8, 0);
-    text_dist.setColor(Color::White);
-    target->draw(text_dist, &outlineShader);
+    // Format the status text (into fixed buffers rather than with boost::format to keep the
+    // heap out of the frame). The HUD only lays out the text again if it has changed, and
+    // draws it all at once.
+    char fps_str[64];
+    sprintf_s(fps_str, "%.1f (%.1f) FPS", fpsCounter.GetAverageFps(), capture.GetAverageFps());
+    hud.SetText(hudFps, fps_str);
+
+    // Age of the displayed frame when it hit the screen
+    char latency_str[64];
+    sprintf_s(latency_str, "Latency %.0fms (p95 %.0fms)",
+        captureToPresentLatency.GetMean(), captureToPresentLatency.GetPercentile(0.95));
+    hud.SetText(hudLatency, latency_str);
+
+    hud.SetText(hudStatus, GetTrackingStatus().c_str());
+
+    //sprintf_s(track_str, "Reliability %.2f%%", trackReliability.GetAverage() * 100.0f);
+
+    char dist_str[64];
+    if (!isnan(raw_depth))
+        sprintf_s(dist_str, "Distance %.1fmm", raw_depth);
+    else
+        sprintf_s(dist_str, "Distance --");
+    hud.SetText(hudDistance, dist_str);
+
+    if (advanced_view) {
+        char mem_str[128];
+        sprintf_s(mem_str, "Heap allocs %llu/frame, arena %u/%u KB (%u overflows)",
+            frameHeapAllocations,
+            static_cast<unsigned int>(frameArena.GetPeak() / 1024),
+            static_cast<unsigned int>(frameArena.GetCapacity() / 1024),
+            frameArena.GetOverflowCount());
+        hud.SetText(hudMemory, mem_str);
+    }
+
+    hud.Draw(*target, sdf_text ? &sdfTextShader : &outlineShader);
 }
 
-string Application::GetTrackingStatus() {
-    if (faceTracker.isTracked) {
-        HRESULT hr = faceTracker.GetTrackStatus();
+static double GetWorkingSetBytes() {
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0.0;
+    return static_cast<double>(pmc.WorkingSetSize);
+}
+
+static double GetPagefileBytes() {
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0.0;
+    return static_cast<double>(pmc.PagefileUsage);
+}
+
+void Application::InitializePipeline() {
+    typedef Pipeline<FramePacket> FramePipeline;
+
+    // Camera frames are dropped rather than queued if the tracker can't keep up, so
+    // what's displayed stays current. Once tracked, a frame goes through to display.
+    pipeline.AddStage("Capture", [this](FramePacket& p, FrameArena& a) { return capture.Read(p); }, 2, FramePipeline::DropOldest);
+    pipeline.AddStage("Convert", [this](FramePacket& p, FrameArena& a) { return ConvertFrame(p, a); }, 2, FramePipeline::DropOldest);
+    pipeline.AddStage("Track", [this](FramePacket& p, FrameArena& a) { return TrackFrame(p, a); }, 2, FramePipeline::Block);
+    pipeline.AddStage("Deform", [this](FramePacket& p, FrameArena& a) { return DeformFrame(p, a); }, 2, FramePipeline::Block);
+    pipeline.AddStage("CompositePrep", [this](FramePacket& p, FrameArena& a) { return PrepareComposite(p, a); }, 2, FramePipeline::DropOldest);
+}
+
+void Application::InitializeMetrics() {
+    auto& registry = Metrics::GetRegistry();
+
+    framesPresented = &registry.AddCounter("render_frames_presented_total", "Frames displayed");
+    framesDropped = &registry.AddCounter("render_frames_dropped_total", "Captured frames that were never displayed");
+    framesRepeated = &registry.AddCounter("render_frames_repeated_total", "Frames displayed again because no new frame had been captured");
+
+    frameTimeHistogram = &registry.AddHistogram("render_frame_time_ms", "Time between displayed frames", Metrics::LatencyBuckets());
+    captureToTrackHistogram = &registry.AddHistogram("pipeline_latency_ms", "Latency between pipeline stages", Metrics::LatencyBuckets(), "stage=\"capture_to_track\"");
+    trackToPresentHistogram = &registry.AddHistogram("pipeline_latency_ms", "Latency between pipeline stages", Metrics::LatencyBuckets(), "stage=\"track_to_present\"");
+    captureToPresentHistogram = &registry.AddHistogram("pipeline_latency_ms", "Latency between pipeline stages", Metrics::LatencyBuckets(), "stage=\"capture_to_present\"");
+    recordTimeHistogram = &registry.AddHistogram("recorder_render_time_ms", "Render thread time spent handing frames to the recorder", Metrics::LatencyBuckets());
+
+    arenaUsedGauge = &registry.AddGauge("memory_frame_arena_used_bytes", "Frame arena bytes used by the last frame");
+    frameHeapAllocationsGauge = &registry.AddGauge("memory_frame_heap_allocations", "Heap allocations made by the last frame");
+
+    // Evaluated on the metrics server thread when scraped
+    registry.AddCallbackCounter("memory_heap_allocations", "Heap allocations since startup", AllocationCounter::GetAllocationCount);
+    registry.AddCallbackCounter("memory_heap_allocated_bytes", "Heap bytes allocated since startup", AllocationCounter::GetAllocatedBytes);
+    registry.AddCallbackGauge("memory_working_set_bytes", "Process working set size", GetWorkingSetBytes);
+    registry.AddCallbackGauge("memory_pagefile_bytes", "Process committed (private) memory", GetPagefileBytes);
+
+    // Without metrics if the server can't listen (it says why)
+    if (metrics_enabled)
+        metricsServer.Initialize();
+}
+
+void Application::UpdateLatency() {
+    if (frameInfo.frameIndex == 0)
+        return; // No frames captured yet
+
+    // Only count capture->track once per captured frame, since the
+    // render loop may display the same frame more than once.
+    if (frameInfo.frameIndex != lastTrackedFrameIndex) {
+        // Any frames between this and the last one were never displayed
+        if (lastTrackedFrameIndex != 0 && frameInfo.frameIndex > lastTrackedFrameIndex + 1)
+            framesDropped->Increment(frameInfo.frameIndex - lastTrackedFrameIndex - 1);
+
+        double captureToTrack = Profiler::TicksToSeconds(frameInfo.trackTime - frameInfo.captureTime) * 1000.0;
+        captureToTrackLatency.AddSample(static_cast<float>(captureToTrack));
+        captureToTrackHistogram->Observe(captureToTrack);
+        lastTrackedFrameIndex = frameInfo.frameIndex;
+    }
+    else {
+        framesRepeated->Increment();
+    }
+
+    double trackToPresent = Profiler::TicksToSeconds(frameInfo.presentTime - frameInfo.trackTime) * 1000.0;
+    double captureToPresent = Profiler::TicksToSeconds(frameInfo.presentTime - frameInfo.captureTime) * 1000.0;
+    trackToPresentLatency.AddSample(static_cast<float>(trackToPresent));
+    captureToPresentLatency.AddSample(static_cast<float>(captureToPresent));
+    trackToPresentHistogram->Observe(trackToPresent);
+    captureToPresentHistogram->Observe(captureToPresent);
+
+    // How old the frame the overlay was fitted to is
+    if (current->isTracked) {
+        trackingAge.AddSample(static_cast<float>(
+            Profiler::TicksToSeconds(frameInfo.presentTime - trackedFrameInfo.captureTime) * 1000.0));
+    }
+}
+
+static void WriteLatency(std::ostream& os, const char* name, const RollingStatistics<float>& stats) {
+    os << name << "\t"
+        << stats.GetSampleCount() << "\t"
+        << stats.GetMean() << "\t"
+        << stats.GetMinimum() << "\t"
+        << stats.GetPercentile(0.5) << "\t"
+        << stats.GetPercentile(0.95) << "\t"
+        << stats.GetPercentile(0.99) << "\t"
+        << stats.GetMaximum() << endl;
+}
+
+bool Application::WriteMetrics(const std::string& filename) {
+    ofstream os(filename);
+    if (!os.is_open())
+        return false;
+
+    os << "# LATENCY (ms):" << endl;
+    os << "# stage\tsamples\tmean\tmin\tp50\tp95\tp99\tmax" << endl;
+    WriteLatency(os, "capture_to_track", captureToTrackLatency);
+    WriteLatency(os, "track_to_present", trackToPresentLatency);
+    WriteLatency(os, "capture_to_present", captureToPresentLatency);
+    WriteLatency(os, "tracking_age", trackingAge);
+
+    os << endl << "# LAST FRAME:" << endl;
+    os << "frame_index\t" << frameInfo.frameIndex << endl;
+    os << "color_timestamp_us\t" << frameInfo.colorTimestamp << endl;
+    os << "depth_timestamp_us\t" << frameInfo.depthTimestamp << endl;
+
+    vector<Pipeline<FramePacket>::StageStatistics> stages;
+    pipeline.GetStatistics(stages);
+    os << endl << "# PIPELINE:" << endl;
+    os << "# stage\tcore\tprocessed\tdiscarded\tdropped\tqueue\tcapacity\tbusy_s\tblocked_s" << endl;
+    for (auto& st : stages) {
+        os << st.name << "\t" << st.core << "\t" << st.processed << "\t" << st.discarded << "\t" << st.dropped << "\t"
+            << st.queueDepth << "\t" << st.queueCapacity << "\t" << st.busySeconds << "\t" << st.blockedSeconds << endl;
+    }
+
+    FrameSynchronizer::Statistics sync;
+    capture.GetSyncStatistics(&sync);
+    os << endl << "# SYNC:" << endl;
+    os << "matched_pairs\t" << sync.matched << endl;
+    os << "unmatched_color\t" << sync.droppedColor << endl;
+    os << "unmatched_depth\t" << sync.droppedDepth << endl;
+    os << "skew_mean_ms\t" << sync.skewMean << endl;
+    os << "skew_p50_ms\t" << sync.skewMedian << endl;
+    os << "skew_p95_ms\t" << sync.skew95 << endl;
+    os << "skew_max_ms\t" << sync.skewMax << endl;
+
+    return os.good();
+}
+
+void Application::ColorizeDepth(const cv::Mat& depth, cv::Mat& colored, FrameArena& arena) {
+    if (depth.empty())
+        return;
+
+    TaskScheduler& scheduler = TaskScheduler::Default();
+    int bands = TaskScheduler::ChunkCount(0, depth.rows, parallel_band_rows);
+
+    // Depth range, per band then overall
+    cv::Mat bandRange = arena.NewMat();
+    bandRange.create(bands, 2, CV_64F);
+    scheduler.ParallelFor(0, depth.rows, parallel_band_rows, [&](int y0, int y1) {
+        double* range = bandRange.ptr<double>(y0 / parallel_band_rows);
+        cv::minMaxLoc(depth.rowRange(y0, y1), &range[0], &range[1]);
+    });
+
+    double minDepth = bandRange.at<double>(0, 0);
+    double maxDepth = bandRange.at<double>(0, 1);
+    for (int b = 1; b < bands; b++) {
+        if (bandRange.at<double>(b, 0) < minDepth) minDepth = bandRange.at<double>(b, 0);
+        if (bandRange.at<double>(b, 1) > maxDepth) maxDepth = bandRange.at<double>(b, 1);
+    }
+
+    // Same scaling as cv::normalize(NORM_MINMAX) to 0-255
+    double scale = 255.0 * ((maxDepth - minDepth > DBL_EPSILON) ? 1.0 / (maxDepth - minDepth) : 0.0);
+    double shift = -minDepth * scale;
+
+    cv::Mat normalized = arena.NewMat();
+    normalized.create(depth.size(), CV_8U);
+    scheduler.ParallelFor(0, depth.rows, parallel_band_rows, [&](int y0, int y1) {
+        cv::Mat gray = normalized.rowRange(y0, y1);
+        depth.rowRange(y0, y1).convertTo(gray, CV_8U, scale, shift);
+
+        // Map depth to JET color map
+        cv::Mat band = colored.rowRange(y0, y1);
+        cv::applyColorMap(gray, band, cv::COLORMAP_JET);
+    });
+}
+
+const string& Application::GetTrackingStatus() {
+    static const string tracking = "Tracking";
+    static const string noFace = "No Face Detected";
+
+    if (current != nullptr && current->isTracked) {
+        HRESULT hr = current->trackStatus;
 
         if (FAILED(hr)) {
-            return ft_error("", hr).what();
+            auto it = trackStatusText.find(hr);
+            if (it == trackStatusText.end())
+                it = trackStatusText.insert(make_pair(hr, string(ft_error("", hr).what()))).first;
+            return it->second;
         }
         else {
-            return "Tracking";
+            return tracking;
         }
     }
     else {
-        return "No Face Detected";
+        return noFace;
     }
 }
 
-Vector2f Application::AnalyzeLevels(cv::Mat image) {
-    // Convert to luminance. Do not use HSB/HSV, as B/V doesn't correspond to actual luminance!
-    // Y' = 0.299*R + 0.587*G + 0.144*B
-    cv::cvtColor(faceImage, faceImage, cv::COLOR_BGR2GRAY);
+Vector2f Application::AnalyzeLevels(cv::Mat image, FrameArena& arena) {
+    const int histSize = 256;
+
+    // Luminance histogram of each band of rows, summed in order afterwards
+    cv::Mat lumaImage = arena.NewMat();
+    cv::Mat bandHist = arena.NewMat();
+    lumaImage.create(image.size(), CV_8U);
+    bandHist.create(TaskScheduler::ChunkCount(0, image.rows, parallel_band_rows), histSize, CV_32S);
+
+    TaskScheduler::Default().ParallelFor(0, image.rows, parallel_band_rows, [&](int y0, int y1) {
+        // Convert to luminance. Do not use HSB/HSV, as B/V doesn't correspond to actual luminance!
+        // Y' = 0.299*R + 0.587*G + 0.114*B
+        cv::Mat luma = lumaImage.rowRange(y0, y1);
+        cv::cvtColor(image.rowRange(y0, y1), luma, cv::COLOR_BGR2GRAY);
+
+        int* counts = bandHist.ptr<int>(y0 / parallel_band_rows);
+        std::fill(counts, counts + histSize, 0);
+        for (int y = 0; y < luma.rows; y++) {
+            const unsigned char* p = luma.ptr<unsigned char>(y);
+            for (int x = 0; x < luma.cols; x++)
+                counts[p[x]]++;
+        }
+    });
 
-    // Calculate luminance histogram
-    cv::MatND hist;
-    int histSize = 256;
-    float range[] = { 0, 255 };
-    const float* ranges = { range };
-    cv::calcHist(&faceImage, 1, 0, cv::Mat(), hist, 1, &histSize, &ranges, true, false);
+    float hist[histSize];
+    for (int i = 0; i < histSize; i++) {
+        int count = 0;
+        for (int b = 0; b < bandHist.rows; b++)
+            count += bandHist.at<int>(b, i);
+        hist[i] = static_cast<float>(count);
+    }
+    hist[histSize - 1] = 0.0f;  // Pure white was never counted (the histogram used to cover [0, 255))
 
     // Calculate total sum of pixel counts
     float sum = 0.0f;
     for (int i = 0; i < histSize; i++) {
-        sum += hist.at<float>(i);
+        sum += hist[i];
     }
 
     // Find the maximum and minimum luminance of the video
@@ -556,7 +1357,7 @@ Vector2f Application::AnalyzeLevels(cv::Mat image) {
     int p_a = 0;
     int p_b = histSize - 1;
     for (int i = 0; i < histSize; i++) {
-        csum += hist.at<float>(i);
+        csum += hist[i];
         if (csum < sum_a)
             p_a = i;
         else if (csum < sum_b)
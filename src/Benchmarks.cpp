@@ -0,0 +1,1248 @@
+#include "stdafx.h"
+#include "Benchmarks.h"
+
+#include "Application.h"
+#include "FaceDepthEstimator.h"
+#include "FrameSynchronizer.h"
+#include "SharedFrameOutput.h"
+#include "SharedFrameReader.h"
+#include "SoftwareCompositor.h"
+#include "eru\Model.h"
+#include "models\Candide3Mesh.h"
+#include "models\CustomFaceModel.h"
+#include "models\FaceAssetCache.h"
+#include "models\FaceTexture.h"
+#include "models\FixedFaceKernel.h"
+#include "models\LoopSubdivision.h"
+#include "models\MeshTransfer.h"
+#include "utils\FrameArena.h"
+#include "utils\Profiler.h"
+#include "utils\TaskScheduler.h"
+
+#include <opencv2\opencv.hpp>
+
+#include <NuiApi.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    // Average time per call of f, in microseconds
+    template<class F>
+    double Time(F f, int iterations) {
+        for (int i = 0; i < iterations / 10 + 1; i++)
+            f();    // Warm up
+
+        long long start = Profiler::Now();
+        for (int i = 0; i < iterations; i++)
+            f();
+        long long end = Profiler::Now();
+
+        return Profiler::TicksToSeconds(end - start) * 1e6 / iterations;
+    }
+
+    void Report(const char* name, double us, const char* result) {
+        printf("  %-32s %10.2f us   %s\n", name, us, result);
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // Synthetic 640x480 depth frame: a face ~800mm away in front of a wall at 2500mm,
+    // with holes (including one at the face center) like a real Kinect frame.
+    cv::Mat MakeFaceDepthFrame(cv::Rect face) {
+        cv::Mat depth(480, 640, CV_16U, cv::Scalar(2500));
+        cv::RNG rng(1234);
+
+        cv::Point2f center(face.x + face.width * 0.5f, face.y + face.height * 0.5f);
+        for (int y = face.y; y < face.y + face.height; y++) {
+            for (int x = face.x; x < face.x + face.width; x++) {
+                float dx = (x - center.x) / (face.width * 0.4f);
+                float dy = (y - center.y) / (face.height * 0.5f);
+                float r2 = dx * dx + dy * dy;
+                if (r2 <= 1.0f)
+                    depth.at<unsigned short>(y, x) = static_cast<unsigned short>(800.0f + 40.0f * r2);  // Nose is nearest
+            }
+        }
+
+        for (int i = 0; i < static_cast<int>(depth.total() / 5); i++)
+            depth.at<unsigned short>(rng.uniform(0, depth.rows), rng.uniform(0, depth.cols)) = 0;
+
+        cv::circle(depth, cv::Point(cvRound(center.x), cvRound(center.y)), 6, cv::Scalar(0), -1);
+        return depth;
+    }
+
+    bool FaceDepth() {
+        cout << "Face depth (true ~800-840mm)" << endl;
+
+        cv::Rect face(240, 140, 160, 200);
+        cv::Mat depth = MakeFaceDepthFrame(face);
+        cv::Point center(face.x + face.width / 2, face.y + face.height / 2);
+        const int iterations = 2000;
+        char result[64];
+
+        volatile float value = 0;
+
+        // What Application::Process used to do
+        double us = Time([&] { value = depth.at<unsigned short>(center); }, iterations);
+        sprintf_s(result, "%.1f mm", static_cast<float>(value));
+        Report("center pixel", us, result);
+
+        cv::Mat filtered;
+        us = Time([&] {
+            cv::medianBlur(depth(face), filtered, 5);
+            value = filtered.at<unsigned short>(face.height / 2, face.width / 2);
+        }, iterations);
+        sprintf_s(result, "%.1f mm", static_cast<float>(value));
+        Report("medianBlur(5) roi, center", us, result);
+
+        us = Time([&] {
+            cv::medianBlur(depth, filtered, 5);
+            value = filtered.at<unsigned short>(center);
+        }, iterations / 10);
+        sprintf_s(result, "%.1f mm", static_cast<float>(value));
+        Report("medianBlur(5) frame, center", us, result);
+
+        vector<unsigned short> samples;
+        samples.reserve(face.area());
+        us = Time([&] {
+            samples.clear();
+            for (int y = face.y; y < face.y + face.height; y++) {
+                const unsigned short* row = depth.ptr<unsigned short>(y);
+                for (int x = face.x; x < face.x + face.width; x++)
+                    if (row[x] != 0) samples.push_back(row[x]);
+            }
+            nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+            value = samples[samples.size() / 2];
+        }, iterations);
+        sprintf_s(result, "%.1f mm", static_cast<float>(value));
+        Report("nth_element median roi", us, result);
+
+        FaceDepthEstimator estimator;
+        us = Time([&] { value = estimator.Estimate(depth, face); }, iterations);
+        bool inRange = (value >= 800.0f && value <= 840.0f);
+        sprintf_s(result, "%.1f mm   %s", static_cast<float>(value), inRange ? "in range" : "OUT OF RANGE");
+        Report("FaceDepthEstimator", us, result);
+        return inRange;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // Stands in for openni::VideoFrameRef, to pair frames offline
+    struct SyntheticFrame {
+        SyntheticFrame() : timestamp(0), index(-1) {}
+        SyntheticFrame(uint64_t timestamp, int index) : timestamp(timestamp), index(index) {}
+
+        uint64_t getTimestamp() const { return timestamp; }
+
+        uint64_t timestamp;     // Microseconds
+        int index;              // Frames captured at the same instant have the same index
+    };
+
+    struct SyntheticArrival {
+        uint64_t        time;   // When the frame is read, not when it was captured
+        bool            color;
+        SyntheticFrame  frame;
+
+        bool operator <(const SyntheticArrival& other) const { return time < other.time; }
+    };
+
+    bool Sync() {
+        const int frameCount = 100000;
+        const int loopLength = 10000;
+        cout << "Color/depth pairing (" << frameCount << " synthetic frames per stream at 30fps)" << endl;
+
+        // Like a replay: depth ~5ms behind color, both timestamps jittering a little, each stream
+        // missing the odd frame, either frame of a pair read up to 25ms late, and the recording
+        // looping back to timestamp 0 every loopLength frames.
+        const uint64_t period = 33333;
+        cv::RNG rng(1234);
+        vector<SyntheticArrival> arrivals;
+        int expected = 0;
+        for (int i = 0; i < frameCount; i++) {
+            uint64_t loopStart = static_cast<uint64_t>(i / loopLength) * (loopLength + 2) * period;
+            uint64_t t = (i % loopLength + 1) * period;
+
+            bool haveColor = rng.uniform(0.0, 1.0) > 0.02;
+            bool haveDepth = rng.uniform(0.0, 1.0) > 0.02;
+            if (haveColor && haveDepth)
+                expected++;
+
+            if (haveColor) {
+                SyntheticArrival a;
+                a.frame = SyntheticFrame(t + rng.uniform(-2000, 2000), i);
+                a.time = loopStart + a.frame.timestamp + rng.uniform(0, 25000);
+                a.color = true;
+                arrivals.push_back(a);
+            }
+            if (haveDepth) {
+                SyntheticArrival a;
+                a.frame = SyntheticFrame(t + 5000 + rng.uniform(-2000, 2000), i);
+                a.time = loopStart + a.frame.timestamp + rng.uniform(0, 25000);
+                a.color = false;
+                arrivals.push_back(a);
+            }
+        }
+        stable_sort(arrivals.begin(), arrivals.end());
+
+        BasicFrameSynchronizer<SyntheticFrame> synchronizer;
+        int matched = 0, wrong = 0;
+        long long start = Profiler::Now();
+        for (const SyntheticArrival& a : arrivals) {
+            if (a.color)
+                synchronizer.PushColor(a.frame);
+            else
+                synchronizer.PushDepth(a.frame);
+
+            SyntheticFrame color, depth;
+            while (synchronizer.Pop(&color, &depth)) {
+                matched++;
+                if (color.index != depth.index)
+                    wrong++;
+            }
+        }
+        double us = Profiler::TicksToSeconds(Profiler::Now() - start) * 1e6 / arrivals.size();
+
+        // Every pair that exists must be found, and nothing else. Only the first pair after a
+        // loop may be lost: a leftover frame from the end of the recording can take it down
+        // with it before the synchronizer notices the timestamps went backwards.
+        const int loops = frameCount / loopLength - 1;
+        bool ok = (wrong == 0 && matched <= expected && matched >= expected - loops);
+
+        BasicFrameSynchronizer<SyntheticFrame>::Statistics stats;
+        synchronizer.GetStatistics(&stats);
+        char result[160];
+        sprintf_s(result, "%d/%d pairs, %d wrong, skew p95 %.1f ms   %s",
+            matched, expected, wrong, stats.skew95, ok ? "correct" : "MISMATCH");
+        Report("PushColor/PushDepth + Pop", us, result);
+        return ok;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    bool SameMat(const cv::Mat& a, const cv::Mat& b) {
+        return a.size() == b.size() && a.type() == b.type() && cv::norm(a, b, cv::NORM_INF) == 0.0;
+    }
+
+    bool Parallel() {
+        cout << "Intra-frame parallelism (640x480 frame)" << endl;
+
+        TaskScheduler& scheduler = TaskScheduler::Default();
+        int defaultThreads = scheduler.GetThreadCount();
+
+        cv::Mat depth;
+        MakeFaceDepthFrame(cv::Rect(240, 140, 160, 200)).convertTo(depth, CV_32F);
+
+        cv::Mat color(480, 640, CV_8UC3);
+        cv::RNG rng(1234);
+        rng.fill(color, cv::RNG::UNIFORM, 0, 256);
+
+        // Results with one thread, which the others must match exactly
+        cv::Mat colorizedRef;
+        sf::Vector2f levelsRef;
+        bool ok = true;
+
+        FrameArena arena;
+        const int iterations = 200;
+        const int threadCounts[] = { 1, 2, 4, 8 };
+
+        for (int threads : threadCounts) {
+            scheduler.SetThreadCount(threads - 1);  // The calling thread works too
+            cout << "  " << threads << " thread(s)" << endl;
+
+            cv::Mat colorized(depth.size(), CV_8UC3);
+            double us = Time([&] {
+                arena.Reset();
+                Application::ColorizeDepth(depth, colorized, arena);
+            }, iterations);
+            if (colorizedRef.empty())
+                colorized.copyTo(colorizedRef);
+            bool same = SameMat(colorized, colorizedRef);
+            Report("ColorizeDepth", us, same ? "identical" : "MISMATCH");
+            ok = ok && same;
+
+            sf::Vector2f levels;
+            us = Time([&] {
+                arena.Reset();
+                levels = Application::AnalyzeLevels(color, arena);
+            }, iterations);
+            if (threads == 1)
+                levelsRef = levels;
+            same = (levels == levelsRef);
+            Report("AnalyzeLevels", us, same ? "identical" : "MISMATCH");
+            ok = ok && same;
+        }
+
+        scheduler.SetThreadCount(defaultThreads);
+        return ok;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    bool Composite() {
+        cout << "Software face compositing (640x480, Candide-3)" << endl;
+
+        eruFace::Model mesh;
+        FaceTexture texture;
+        if (!mesh.read("resources\\faces\\candide3_textured.wfm") || !texture.Load(mesh._texFilename)) {
+            cout << "  Could not load resources\\faces\\candide3_textured.wfm" << endl;
+            return false;
+        }
+
+        mesh.updateGlobal();
+        vector<float> vertices(mesh.nVertices() * 3);
+        float minY = 0.0f, maxY = 0.0f;
+        for (int i = 0; i < mesh.nVertices(); i++) {
+            auto vertex = mesh.vertex(i);
+            for (int j = 0; j < 3; j++)
+                vertices[i * 3 + j] = static_cast<float>(vertex[j]);
+            minY = (i == 0 || vertices[i * 3 + 1] < minY) ? vertices[i * 3 + 1] : minY;
+            maxY = (i == 0 || vertices[i * 3 + 1] > maxY) ? vertices[i * 3 + 1] : maxY;
+        }
+
+        // Far enough away that the face is ~40% of the frame height, turned a little
+        const float fov = NUI_CAMERA_COLOR_NOMINAL_VERTICAL_FOV;
+        float distance = (maxY - minY) / (0.8f * tan(fov * 0.5f * 3.14159265f / 180.0f));
+        sf::Vector3f rotation(10.0f, -15.0f, 5.0f);
+        sf::Vector3f translation(0.0f, 0.0f, distance);
+        sf::Vector2f lumaCorrect(0.05f, 1.2f);
+
+        cv::Mat background(480, 640, CV_8UC3);
+        cv::RNG rng(1234);
+        rng.fill(background, cv::RNG::UNIFORM, 0, 256);
+
+        SoftwareCompositor compositor(fov);
+        compositor.SetMesh(mesh);
+        compositor.SetTexture(texture);
+
+        const int iterations = 500;
+        cv::Mat frame, reference;
+
+        double us = Time([&] {
+            background.copyTo(frame);
+            compositor.Draw(frame, vertices, rotation, translation, lumaCorrect);
+        }, iterations);
+        frame.copyTo(reference);
+        Report("serial", us, "(includes frame copy)");
+
+        TaskScheduler& scheduler = TaskScheduler::Default();
+        int defaultThreads = scheduler.GetThreadCount();
+        compositor.SetTileParallel(true);
+
+        bool ok = true;
+        const int threadCounts[] = { 1, 2, 4, 8 };
+        for (int threads : threadCounts) {
+            scheduler.SetThreadCount(threads - 1);
+            us = Time([&] {
+                background.copyTo(frame);
+                compositor.Draw(frame, vertices, rotation, translation, lumaCorrect);
+            }, iterations);
+
+            char name[64];
+            bool same = SameMat(frame, reference);
+            sprintf_s(name, "tiles, %d thread(s)", threads);
+            Report(name, us, same ? "identical" : "MISMATCH");
+            ok = ok && same;
+        }
+
+        scheduler.SetThreadCount(defaultThreads);
+
+        // Against the GL path it stands in for: the video drawn as a sprite, then the face drawn
+        // with face-blend.frag as Draw3D does. GL samples the face texture's top level nearest
+        // here, like the compositor, so only rasterization and rounding can make them differ.
+        sf::RenderTexture target;
+        sf::Shader shader;
+        if (!target.create(640, 480, true) ||
+            !shader.loadFromFile("resources\\shaders\\face-blend.frag", sf::Shader::Fragment)) {
+            cout << "  Could not create a GL target or load face-blend.frag" << endl;
+            return false;
+        }
+        target.setActive(true);
+
+        cv::Mat backgroundRGBA;
+        cv::cvtColor(background, backgroundRGBA, cv::COLOR_RGB2RGBA);
+        sf::Texture backgroundTexture, faceTexture;
+        backgroundTexture.create(640, 480);
+        backgroundTexture.update(backgroundRGBA.data);
+        texture.Upload(faceTexture);
+        sf::Texture::bind(&faceTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        sf::Texture::bind(NULL);
+
+        target.clear();
+        target.draw(sf::Sprite(backgroundTexture));
+
+        target.pushGLStates();
+        glViewport(0, 0, 640, 480);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_DEPTH_TEST);
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        gluPerspective(fov, 4.f / 3.f, 0.1f, 10.0f);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        gluLookAt(0.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 1.f, 0.f);
+        glScalef(-1.f, 1.f, 1.f);
+        glTranslatef(translation.x, translation.y, translation.z);
+        glRotatef(rotation.x, 1.f, 0.f, 0.f);
+        glRotatef(rotation.y, 0.f, 1.f, 0.f);
+        glRotatef(rotation.z, 0.f, 0.f, 1.f);
+
+        glEnable(GL_TEXTURE_2D);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glColor3f(1.f, 1.f, 1.f);
+        shader.setParameter("iResolution", sf::Vector2f(640.0f, 480.0f));
+        shader.setParameter("overlayTexture", faceTexture);
+        shader.setParameter("backgroundTexture", backgroundTexture);
+        shader.setParameter("lumaCorrect", lumaCorrect);
+        sf::Shader::bind(&shader);
+        CustomFaceModel::DrawGL(vertices, mesh);
+        sf::Shader::bind(NULL);
+        target.popGLStates();
+        target.display();
+
+        // Compare the face's pixels; a few along its edges may be covered by only one of them
+        sf::Image gl = target.getTexture().copyToImage();
+        const sf::Uint8* glPixels = gl.getPixelsPtr();
+        int covered = 0, differ = 0;
+        for (int y = 0; y < 480; y++) {
+            const unsigned char* cpu = reference.ptr<unsigned char>(y);
+            const unsigned char* bg = background.ptr<unsigned char>(y);
+            for (int x = 0; x < 640; x++) {
+                const sf::Uint8* p = glPixels + (y * 640 + x) * 4;
+                bool face = false, different = false;
+                for (int c = 0; c < 3; c++) {
+                    face = face || cpu[x * 3 + c] != bg[x * 3 + c] || p[c] != bg[x * 3 + c];
+                    different = different || abs(cpu[x * 3 + c] - p[c]) > 4;
+                }
+                covered += face ? 1 : 0;
+                differ += different ? 1 : 0;
+            }
+        }
+        bool match = (covered > 0 && differ <= covered / 100);
+        printf("  vs GL: %d of %d face pixels differ   %s\n", differ, covered, match ? "match" : "MISMATCH");
+
+        return ok && match;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // True if all n bytes are value
+    bool AllBytes(const unsigned char* data, size_t n, unsigned char value) {
+        for (size_t i = 0; i < n; i++) {
+            if (data[i] != value)
+                return false;
+        }
+        return true;
+    }
+
+    struct SharedReaderStats {
+        SharedReaderStats() : frames(0), discarded(0), corrupt(0), outOfOrder(0), torn(0) {}
+
+        unsigned long long frames;      // Read consistently
+        unsigned long long discarded;   // Overwritten while in use, and thrown away
+        unsigned long long corrupt;     // Read "consistently", but wrong (must be 0)
+        unsigned long long outOfOrder;  // Not the latest frame, or older than one read before (must be 0)
+        unsigned long long torn;        // SharedFrameReader::GetTornCount
+    };
+
+    bool SharedOutput() {
+        const int outputWidth = 1280, outputHeight = 720;
+        const int readerCount = 4;
+        const double seconds = 2.0;
+
+        cout << "Shared frame output (640x480 color/depth, " << outputWidth << "x" << outputHeight << " output, "
+            << readerCount << " readers)" << endl;
+
+        const string name = "Local\\VirtualMirrorBenchmark";
+        SharedFrameOutput output;
+        if (!output.Create(name, 4, 640, 480, outputWidth, outputHeight)) {
+            cout << "  Could not create " << name << endl;
+            return false;
+        }
+
+        // Every byte of a frame's images is set to its frame index, so readers can tell a torn frame
+        FramePacket packet;
+        packet.depthRegistered.create(480, 640, CV_16U);
+        packet.actionUnits.assign(6, 0.0f);
+        packet.shapeUnits.assign(11, 0.0f);
+
+        const size_t colorBytes = 640 * 480 * 3;
+        const size_t depthBytes = 640 * 480 * 2;
+        const size_t outputBytes = static_cast<size_t>(outputWidth) * outputHeight * 4;
+
+        // Half the readers use frames in place, the other half copy them
+        atomic<bool> stop(false);
+        vector<SharedReaderStats> stats(readerCount);
+        vector<thread> readers;
+        for (int r = 0; r < readerCount; r++) {
+            readers.push_back(thread([&, r] {
+                SharedFrameReader reader;
+                if (!reader.Open(name))
+                    return;
+
+                SharedReaderStats& s = stats[r];
+                SharedFrameReader::Frame frame;
+                uint64_t lastIndex = 0;
+                while (!stop) {
+                    if (r % 2 == 0) {
+                        SharedFrameReader::View view;
+                        if (!reader.Latest(view)) {
+                            this_thread::yield();
+                            continue;
+                        }
+
+                        unsigned char value = static_cast<unsigned char>(view.slot->frameIndex);
+                        bool correct =
+                            AllBytes(view.color, colorBytes, value) &&
+                            AllBytes(reinterpret_cast<const unsigned char*>(view.depth), depthBytes, value) &&
+                            AllBytes(view.output, outputBytes, value);
+
+                        // The n-th frame published has frame index n
+                        uint64_t index = view.slot->frameIndex;
+                        bool inOrder = (index == static_cast<uint64_t>(view.frame) && index > lastIndex);
+
+                        if (!reader.Validate(view)) {
+                            s.discarded++;
+                            continue;
+                        }
+
+                        if (!correct)
+                            s.corrupt++;
+                        else if (!inOrder)
+                            s.outOfOrder++;
+                        else
+                            s.frames++;
+                        lastIndex = index;
+                    }
+                    else {
+                        if (!reader.Read(frame)) {
+                            this_thread::yield();
+                            continue;
+                        }
+
+                        unsigned char value = static_cast<unsigned char>(frame.info.frameIndex);
+                        bool correct =
+                            AllBytes(frame.color.data(), frame.color.size(), value) &&
+                            AllBytes(reinterpret_cast<const unsigned char*>(frame.depth.data()), depthBytes, value) &&
+                            frame.output.size() == outputBytes && AllBytes(frame.output.data(), outputBytes, value);
+
+                        uint64_t index = frame.info.frameIndex;
+                        bool inOrder = (index == static_cast<uint64_t>(frame.frame) && index > lastIndex);
+                        lastIndex = index;
+
+                        if (!correct)
+                            s.corrupt++;
+                        else if (!inOrder)
+                            s.outOfOrder++;
+                        else
+                            s.frames++;
+                    }
+                }
+                s.torn = reader.GetTornCount();
+            }));
+        }
+
+        // Publish as fast as possible, like Application::PublishFrame: most frames wait a frame
+        // for their readback, but every third is published straight away (as when the window is
+        // too big to read back), ahead of the one still in flight
+        long long publishTicks = 0;
+        int frames = 0;
+        deque<int> inFlight;
+        long long start = Profiler::Now();
+        while (Profiler::TicksToSeconds(Profiler::Now() - start) < seconds) {
+            frames++;
+            unsigned char value = static_cast<unsigned char>(frames);
+            packet.info.frameIndex = frames;
+            packet.color.setTo(cv::Scalar::all(value));
+            packet.depthRegistered.setTo(cv::Scalar::all(value * 257));
+
+            long long t0 = Profiler::Now();
+            int slot = output.Begin(packet);
+            output.GetOutput(slot, outputWidth, outputHeight).setTo(cv::Scalar::all(value));
+            if (frames % 3 == 0)
+                output.Publish(slot, outputWidth, outputHeight, SharedFrame::OutputBGRA, false);
+            else
+                inFlight.push_back(slot);
+            while (inFlight.size() > 1) {
+                output.Publish(inFlight.front(), outputWidth, outputHeight, SharedFrame::OutputBGRA, false);
+                inFlight.pop_front();
+            }
+            publishTicks += Profiler::Now() - t0;
+        }
+        double elapsed = Profiler::TicksToSeconds(Profiler::Now() - start);
+
+        stop = true;
+        for (auto& t : readers)
+            t.join();
+
+        // Well above the camera's 30 frames/s, for the writer and for every reader
+        const double minimumRate = 60.0;
+        bool ok = (frames / elapsed >= minimumRate);
+
+        char result[128];
+        sprintf_s(result, "%d frames, %.0f frames/s   %s", frames, frames / elapsed, (frames / elapsed >= minimumRate) ? "ok" : "TOO SLOW");
+        Report("publish (Begin+output+Publish)", Profiler::TicksToSeconds(publishTicks) * 1e6 / frames, result);
+
+        for (int r = 0; r < readerCount; r++) {
+            const SharedReaderStats& s = stats[r];
+            bool consistent = (s.corrupt == 0 && s.outOfOrder == 0);
+            bool fast = (s.frames / elapsed >= minimumRate);
+            printf("  reader %d (%s): %llu frames (%.0f/s), %llu discarded, %llu torn   %s\n",
+                r, (r % 2 == 0) ? "in place" : "copy",
+                s.frames, s.frames / elapsed, s.discarded, s.torn,
+                !consistent ? (s.corrupt > 0 ? "CORRUPT" : "OUT OF ORDER") : (fast ? "consistent" : "TOO SLOW"));
+            ok = ok && consistent && fast;
+        }
+
+        return ok;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // Synthetic .wfm text, in the same layout as candide3_textured.wfm
+    string MakeWfm(int vertexCount, int faceCount, int auCount, int suCount, int displacements) {
+        cv::RNG rng(1234);
+        ostringstream os;
+        os.setf(ios::fixed);
+        os.precision(6);
+
+        os << "# Synthetic wireframe" << endl << "# VERTEX LIST:" << endl << vertexCount << endl;
+        for (int i = 0; i < vertexCount; i++)
+            os << rng.uniform(-1.0, 1.0) << "\t" << rng.uniform(-1.0, 1.0) << "\t" << rng.uniform(-1.0, 1.0) << endl;
+
+        os << endl << "# FACES LIST:" << endl << faceCount << endl;
+        for (int i = 0; i < faceCount; i++)
+            os << rng.uniform(0, vertexCount) << "\t" << rng.uniform(0, vertexCount) << "\t" << rng.uniform(0, vertexCount) << endl;
+
+        const int counts[] = { auCount, suCount };
+        const char* names[] = { "AUV", "SU" };
+        for (int d = 0; d < 2; d++) {
+            os << endl << "# DEFORMATIONS:" << endl << counts[d] << endl;
+            for (int i = 0; i < counts[d]; i++) {
+                os << endl << "# " << names[d] << i << " Synthetic deformation" << endl << displacements << endl;
+                for (int j = 0; j < displacements; j++)
+                    os << rng.uniform(0, vertexCount) << "\t" << rng.uniform(-0.1, 0.1) << "\t" << rng.uniform(-0.1, 0.1) << "\t" << rng.uniform(-0.1, 0.1) << endl;
+            }
+        }
+
+        for (int d = 0; d < 2; d++) {
+            os << endl << "# PARAMETERS:" << endl << 2 << endl;
+            os << "0\t" << rng.uniform(-1.0, 1.0) << endl << "1\t" << rng.uniform(-1.0, 1.0) << endl;
+        }
+
+        os << endl << "# TEXTURE:" << endl << vertexCount << endl;
+        for (int i = 0; i < vertexCount; i++)
+            os << i << "\t" << rng.uniform(0.0, 1.0) << "    " << rng.uniform(0.0, 1.0) << endl;
+        os << "resources\\faces\\synthetic.png" << endl;
+
+        os << endl << "# GLOBAL MOTION:" << endl
+            << "0.00000  0.00000  0.00000" << endl
+            << "0.12500  0.12500 -0.12500" << endl
+            << "0.00000  0.03000 -0.1250" << endl
+            << endl << "# END OF FILE" << endl;
+        return os.str();
+    }
+
+    bool SameDeformation(const eruFace::Deformation& a, const eruFace::Deformation& b) {
+        if (a.getName() != b.getName() || a.nDisplacements() != b.nDisplacements())
+            return false;
+        for (int i = 0; i < a.nDisplacements(); i++) {
+            if (a.vertexNo(i) != b.vertexNo(i))
+                return false;
+            for (int j = 0; j < 3; j++)
+                if (a[i][j] != b[i][j]) return false;
+        }
+        return true;
+    }
+
+    bool SameModel(const eruFace::Model& a, const eruFace::Model& b) {
+        if (a.nVertices() != b.nVertices() || a.nFaces() != b.nFaces() ||
+            a.nDynamicDeformations() != b.nDynamicDeformations() || a.nStaticDeformations() != b.nStaticDeformations() ||
+            a._texFilename != b._texFilename)
+            return false;
+
+        for (int i = 0; i < a.nVertices(); i++) {
+            eruFace::Vertex va = a.vertex(i), vb = b.vertex(i);
+            eruFace::TexCoord ta = a.texCoord(i), tb = b.texCoord(i);
+            for (int j = 0; j < 3; j++)
+                if (va[j] != vb[j]) return false;
+            if (ta[0] != tb[0] || ta[1] != tb[1])
+                return false;
+        }
+        for (int i = 0; i < a.nFaces(); i++) {
+            eruFace::Face fa = a.face(i), fb = b.face(i);
+            if (fa[0] != fb[0] || fa[1] != fb[1] || fa[2] != fb[2])
+                return false;
+        }
+        for (int i = 0; i < a.nDynamicDeformations(); i++) {
+            if (!SameDeformation(a.dynamicDeformation(i), b.dynamicDeformation(i)) || a.getDynamicParam(i) != b.getDynamicParam(i))
+                return false;
+        }
+        for (int i = 0; i < a.nStaticDeformations(); i++) {
+            if (!SameDeformation(a.staticDeformation(i), b.staticDeformation(i)) || a.getStaticParam(i) != b.getStaticParam(i))
+                return false;
+        }
+        return true;
+    }
+
+    bool Wfm() {
+        const int vertexCount = 12000, faceCount = 24000, auCount = 300, suCount = 100, displacements = 200;
+        cout << "Wireframe (.wfm) loading (" << vertexCount << " vertices, " << faceCount << " faces, "
+            << auCount + suCount << " deformations)" << endl;
+
+        string text = MakeWfm(vertexCount, faceCount, auCount, suCount, displacements);
+        const int iterations = 10;
+        char result[64];
+        sprintf_s(result, "%.1f MB", text.size() / (1024.0 * 1024.0));
+
+        // What Model::read(filename) used to do, minus the disk
+        eruFace::Model streamed;
+        double us = Time([&] {
+            istringstream is(text);
+            streamed.read(is);
+        }, iterations);
+        Report("istream", us, result);
+
+        eruFace::Model parsed;
+        us = Time([&] { parsed.parse(text); }, iterations);
+        bool same = SameModel(parsed, streamed);
+        Report("single pass parse", us, same ? "identical" : "MISMATCH");
+        return same;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    bool Blendshapes() {
+        cout << "Face mesh deformation, CPU vs vertex shader (Candide-3, 640x480 offscreen)" << endl;
+
+        CustomFaceModel model;
+        sf::RenderTexture target;
+        sf::Shader shader;
+        if (!model.LoadMesh("resources\\faces\\candide3_textured.wfm") || !target.create(640, 480) ||
+            !shader.loadFromFile("resources\\shaders\\blendshapes.vert", sf::Shader::Vertex)) {
+            cout << "  Could not load the mesh or blendshapes.vert" << endl;
+            return false;
+        }
+
+        target.setActive(true);
+        if (!model.blendshapes.Initialize(model.mesh)) {
+            cout << "  Vertex shader blendshapes not available" << endl;
+            return false;
+        }
+
+        // Looking straight at the mesh, textured but otherwise fixed function
+        glViewport(0, 0, 640, 480);
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrtho(-0.2, 0.2, -0.15, 0.15, -1.0, 1.0);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glEnable(GL_TEXTURE_2D);
+        glColor3f(1.f, 1.f, 1.f);
+        sf::Texture::bind(&model.GetTexture());
+
+        cv::RNG rng(1234);
+        vector<float> shapeUnits(11), actionUnits(6);
+        for (float& su : shapeUnits)
+            su = static_cast<float>(rng.uniform(-0.5, 0.5));
+
+        // A new expression every frame, as when tracking
+        int frame = 0;
+        auto animate = [&] {
+            frame++;
+            for (size_t i = 0; i < actionUnits.size(); i++)
+                actionUnits[i] = 0.5f * sinf(frame * 0.1f + i);
+        };
+
+        vector<float> vertices, coefficients;
+        const int iterations = 500;
+        char result[64];
+
+        double us = Time([&] {
+            animate();
+            model.Deform(actionUnits, shapeUnits, 1, &vertices);
+            glClear(GL_COLOR_BUFFER_BIT);
+            model.DrawGL(vertices);
+            glFinish();
+        }, iterations);
+        sf::Image cpu = target.getTexture().copyToImage();
+
+        // Immediate mode sends a position and texture coordinate per face corner
+        sprintf_s(result, "%d bytes/frame", model.mesh.nFaces() * 3 * static_cast<int>(3 * sizeof(float) + 2 * sizeof(double)));
+        Report("Deform + DrawGL", us, result);
+
+        frame = 0;
+        us = Time([&] {
+            animate();
+            model.GetCoefficients(actionUnits, shapeUnits, &coefficients);
+            glClear(GL_COLOR_BUFFER_BIT);
+            sf::Shader::bind(&shader);
+            model.DrawBlendshapes(coefficients);
+            sf::Shader::bind(NULL);
+            glFinish();
+        }, iterations);
+        sf::Image gpu = target.getTexture().copyToImage();
+
+        sprintf_s(result, "%d bytes/frame", static_cast<int>((BlendshapeMesh::MaxDeformations + 16) * sizeof(float)));
+        Report("GetCoefficients + vertex shader", us, result);
+
+        // Both drew the same last frame; allow for edge pixels rasterized differently (float vs double)
+        int differ = 0;
+        const sf::Uint8* a = cpu.getPixelsPtr();
+        const sf::Uint8* b = gpu.getPixelsPtr();
+        for (size_t i = 0; i < 640 * 480 * 4; i++) {
+            if (abs(a[i] - b[i]) > 8) {
+                differ++;
+                i += 3 - i % 4;     // Count each pixel once
+            }
+        }
+        bool match = (differ <= 640 * 480 / 200);
+        printf("  %d pixels differ (%.2f%%)   %s\n", differ, differ * 100.0 / (640 * 480), match ? "match" : "MISMATCH");
+
+        sf::Texture::bind(NULL);
+        model.blendshapes.Release();
+        return match;
+    }
+
+    bool Transfer() {
+        const int detailCount = 50000;
+        cout << "Detail mesh transfer (Candide-3 driving " << detailCount << " vertices)" << endl;
+
+        CustomFaceModel model;
+        if (!model.LoadMesh("resources\\faces\\candide3_textured.wfm")) {
+            cout << "  Could not load resources\\faces\\candide3_textured.wfm" << endl;
+            return false;
+        }
+
+        vector<float> rest(model.mesh.nVertices() * 3);
+        for (int i = 0; i < model.mesh.nVertices(); i++) {
+            auto vertex = model.mesh.vertex(i);
+            for (int j = 0; j < 3; j++)
+                rest[i * 3 + j] = static_cast<float>(vertex[j]);
+        }
+
+        // A denser surface over the face: random points on its triangles, lifted off them a little
+        // (as a sculpted mesh would be), remembering where on each triangle they came from
+        cv::RNG rng(1234);
+        vector<int> faces(detailCount);
+        vector<cv::Vec3f> barycentric(detailCount);
+        vector<float> lift(detailCount);
+        vector<float> detail(detailCount * 3);
+
+        auto sample = [&](const vector<float>& vertices, int i) {
+            auto face = model.mesh.face(faces[i]);
+            cv::Vec3f p[3];
+            for (int v = 0; v < 3; v++)
+                p[v] = cv::Vec3f(&vertices[face[v] * 3]);
+            cv::Vec3f n = (p[1] - p[0]).cross(p[2] - p[0]);
+            float length = static_cast<float>(cv::norm(n));
+            if (length > 0.0f)
+                n *= 1.0f / length;
+            const cv::Vec3f& w = barycentric[i];
+            return p[0] * w[0] + p[1] * w[1] + p[2] * w[2] + n * lift[i];
+        };
+
+        for (int i = 0; i < detailCount; i++) {
+            faces[i] = rng.uniform(0, model.mesh.nFaces());
+            float a = rng.uniform(0.0f, 1.0f), b = rng.uniform(0.0f, 1.0f);
+            if (a + b > 1.0f) {
+                a = 1.0f - a;
+                b = 1.0f - b;
+            }
+            barycentric[i] = cv::Vec3f(1.0f - a - b, a, b);
+            lift[i] = rng.uniform(-0.002f, 0.002f);
+
+            cv::Vec3f p = sample(rest, i);
+            for (int j = 0; j < 3; j++)
+                detail[i * 3 + j] = p[j];
+        }
+
+        MeshTransfer transfer;
+        long long start = Profiler::Now();
+        transfer.Bind(rest, detail);
+        Report("Bind", Profiler::TicksToSeconds(Profiler::Now() - start) * 1e6, transfer.IsBound() ? "" : "FAILED");
+
+        // The error, relative to the face's height, against the points on the same triangles
+        float minY = 0.0f, maxY = 0.0f;
+        for (int i = 0; i < model.mesh.nVertices(); i++) {
+            minY = (i == 0 || rest[i * 3 + 1] < minY) ? rest[i * 3 + 1] : minY;
+            maxY = (i == 0 || rest[i * 3 + 1] > maxY) ? rest[i * 3 + 1] : maxY;
+        }
+        auto maxError = [&](const vector<float>& vertices, const vector<float>& transferred) {
+            double error = 0.0;
+            for (int i = 0; i < detailCount; i++) {
+                double d = cv::norm(sample(vertices, i) - cv::Vec3f(&transferred[i * 3]));
+                error = (d > error) ? d : error;
+            }
+            return error / (maxY - minY);
+        };
+
+        vector<float> transferred;
+        char result[64];
+        transfer.Apply(rest, &transferred);
+        double restError = maxError(rest, transferred);
+        bool ok = transfer.IsBound() && restError < 1e-4;
+        printf("  At rest: max error %.2g   %s\n", restError, (restError < 1e-4) ? "match" : "MISMATCH");
+
+        vector<float> vertices, reference;
+        vector<float> shapeUnits(11), actionUnits(6);
+        for (float& su : shapeUnits)
+            su = static_cast<float>(rng.uniform(-0.5, 0.5));
+        for (size_t i = 0; i < actionUnits.size(); i++)
+            actionUnits[i] = 0.5f * sinf(1.0f + i);
+        model.Deform(actionUnits, shapeUnits, 1, &vertices);
+
+        TaskScheduler& scheduler = TaskScheduler::Default();
+        int defaultThreads = scheduler.GetThreadCount();
+        const int iterations = 500;
+
+        const int threadCounts[] = { 1, 2, 4, 8 };
+        for (int threads : threadCounts) {
+            scheduler.SetThreadCount(threads - 1);
+            double us = Time([&] {
+                transfer.Apply(vertices, &transferred);
+            }, iterations);
+
+            if (threads == 1)
+                reference = transferred;
+
+            ok = ok && (transferred == reference);
+
+            char name[64];
+            sprintf_s(name, "Apply, %d thread(s)", threads);
+            sprintf_s(result, "%s, max error %.2g", (transferred == reference) ? "identical" : "MISMATCH", maxError(vertices, transferred));
+            Report(name, us, result);
+        }
+
+        scheduler.SetThreadCount(defaultThreads);
+        return ok;
+    }
+
+    bool Subdivision() {
+        cout << "Loop subdivision of Candide-3 (one thread)" << endl;
+
+        CustomFaceModel model;
+        if (!model.LoadMesh("resources\\faces\\candide3_textured.wfm")) {
+            cout << "  Could not load resources\\faces\\candide3_textured.wfm" << endl;
+            return false;
+        }
+
+        cv::RNG rng(1234);
+        vector<float> shapeUnits(11), actionUnits(6);
+        for (float& su : shapeUnits)
+            su = static_cast<float>(rng.uniform(-0.5, 0.5));
+        for (size_t i = 0; i < actionUnits.size(); i++)
+            actionUnits[i] = 0.5f * sinf(1.0f + i);
+
+        vector<float> vertices, subdivided;
+        model.Deform(actionUnits, shapeUnits, 1, &vertices);
+
+        TaskScheduler& scheduler = TaskScheduler::Default();
+        int defaultThreads = scheduler.GetThreadCount();
+        scheduler.SetThreadCount(0);
+
+        bool ok = true;
+        for (int levels = 1; levels <= LoopSubdivision::MaxLevels; levels++) {
+            LoopSubdivision subdivision;
+            long long start = Profiler::Now();
+            subdivision.Build(model.mesh, levels);
+            double buildUs = Profiler::TicksToSeconds(Profiler::Now() - start) * 1e6;
+
+            double us = Time([&] {
+                subdivision.Apply(vertices, &subdivided);
+            }, 2000);
+
+            ok = ok && (subdivided.size() == static_cast<size_t>(subdivision.GetVertexCount()) * 3);
+
+            char name[64], result[128];
+            sprintf_s(name, "level %d", levels);
+            sprintf_s(result, "%d vertices, %d faces, %.1f weights/vertex, built in %.0f us",
+                subdivision.GetVertexCount(), static_cast<int>(subdivision.GetFaces().size() / 3),
+                static_cast<double>(subdivision.GetStencilSize()) / subdivision.GetVertexCount(), buildUs);
+            Report(name, us, result);
+        }
+
+        scheduler.SetThreadCount(defaultThreads);
+        return ok;
+    }
+
+    bool Candide3() {
+        cout << "Candide-3 deformation, generic eruFace::Model vs compiled in tables" << endl;
+
+        eruFace::Model mesh;
+        if (!mesh.read("resources\\faces\\candide3_textured.wfm")) {
+            cout << "  Could not load resources\\faces\\candide3_textured.wfm" << endl;
+            return false;
+        }
+        if (!FixedFaceKernel<Candide3Mesh>::Matches(mesh)) {
+            cout << "  The mesh doesn't match Candide3Mesh (rerun scripts\\embed_wfm.py)" << endl;
+            return false;
+        }
+
+        cv::RNG rng(1234);
+        for (int i = 0; i < mesh.nStaticDeformations(); i++)
+            mesh.setStaticParam(i, rng.uniform(-0.5, 0.5));
+        mesh.setGlobal(eruMath::Vector3d(0.2, -0.3, 0.1), 0.1, eruMath::Vector3d(0.0, 0.0, 0.6));
+        mesh.updateGlobal();
+
+        FixedFaceKernel<Candide3Mesh> kernel;
+        kernel.UpdateStatic(mesh);
+
+        // A new expression every frame, as when tracking (the 6 Kinect AUs)
+        int frame = 0;
+        auto animate = [&] {
+            frame++;
+            for (int i = 0; i < 6; i++)
+                mesh.setDynamicParam(i, 0.5 * sin(frame * 0.1 + i));
+        };
+
+        const int iterations = 20000;
+        vector<float> generic(mesh.nVertices() * 3), fixed(mesh.nVertices() * 3);
+
+        double us = Time([&] {
+            animate();
+            mesh.updateGlobal();
+            for (int i = 0; i < mesh.nVertices(); i++) {
+                auto vertex = mesh.vertex(i);
+                for (int j = 0; j < 3; j++)
+                    generic[i * 3 + j] = static_cast<float>(vertex[j]);
+            }
+        }, iterations);
+        Report("eruFace::Model", us, "");
+
+        frame = 0;
+        us = Time([&] {
+            animate();
+            kernel.Deform(mesh, fixed.data());
+        }, iterations);
+
+        // Floats rather than doubles, so not bit identical
+        float maxDiff = 0.0f;
+        for (size_t i = 0; i < fixed.size(); i++)
+            maxDiff = (fabs(fixed[i] - generic[i]) > maxDiff) ? fabs(fixed[i] - generic[i]) : maxDiff;
+
+        bool match = (maxDiff < 1e-5f);
+        char result[64];
+        sprintf_s(result, "max difference %.2g   %s", maxDiff, match ? "match" : "MISMATCH");
+        Report("FixedFaceKernel<Candide3Mesh>", us, result);
+        return match;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    bool SameLevels(const FaceTexture& a, const FaceTexture& b) {
+        if (a.GetLevelCount() != b.GetLevelCount() || a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight())
+            return false;
+        for (int level = 0; level < a.GetLevelCount(); level++) {
+            size_t size = static_cast<size_t>(a.GetLevelWidth(level)) * a.GetLevelHeight(level) * 2;
+            if (memcmp(a.GetLevel(level), b.GetLevel(level), size) != 0)
+                return false;
+        }
+        return memcmp(a.GetHistogram(), b.GetHistogram(), FaceTexture::HistogramSize * sizeof(uint32_t)) == 0 &&
+            a.GetLumaRange() == b.GetLumaRange();
+    }
+
+    bool FaceTextures() {
+        cout << "Face texture loading, preprocessed vs cached (Candide-3 texture)" << endl;
+
+        const string cacheDirectory = "cache\\benchmark\\";
+        eruFace::Model mesh;
+        FaceTexture preprocessed;
+        if (!mesh.read("resources\\faces\\candide3_textured.wfm") || !preprocessed.Load(mesh._texFilename)) {
+            cout << "  Could not load resources\\faces\\candide3_textured.wfm" << endl;
+            return false;
+        }
+
+        char result[64];
+        sprintf_s(result, "%dx%d, %d levels", preprocessed.GetWidth(), preprocessed.GetHeight(), preprocessed.GetLevelCount());
+
+        // Cache misses: decode and preprocess the image every time
+        const int iterations = 20;
+        FaceTexture texture;
+        double us = Time([&] {
+            texture.Load(mesh._texFilename);
+        }, iterations);
+        Report("preprocess", us, result);
+
+        // Cache hits: map what the first load wrote (if it wasn't there already)
+        texture.Load(mesh._texFilename, cacheDirectory);
+        us = Time([&] {
+            texture.Load(mesh._texFilename, cacheDirectory);
+        }, iterations);
+        bool cached = texture.WasCached();
+        bool same = SameLevels(texture, preprocessed);
+        Report("mapped from cache", us, !cached ? "NOT CACHED" : (same ? "identical" : "MISMATCH"));
+
+        // Getting it to GL, against decoding the image into an RGBA texture as it used to be
+        sf::Context context;
+        sf::Texture glTexture;
+        us = Time([&] {
+            glTexture.loadFromFile(mesh._texFilename);
+            glFinish();
+        }, iterations);
+        Report("sf::Texture::loadFromFile", us, "RGBA, no mips");
+
+        us = Time([&] {
+            texture.Load(mesh._texFilename, cacheDirectory);
+            texture.Upload(glTexture);
+            glFinish();
+        }, iterations);
+        Report("mapped + Upload", us, "luma/alpha, mip chain");
+        return cached && same;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    bool FaceCache() {
+        const int faceCount = 24;
+        const int framesPerFace = 3;
+        cout << "Face cache, stepping through " << faceCount << " faces (" << framesPerFace << " frames each)" << endl;
+
+        // A library of copies of the Candide-3 face (they share its texture, but each is its own face)
+        const string directory = "cache\\benchmark\\faces\\";
+        CreateDirectoryA("cache\\", nullptr);
+        CreateDirectoryA("cache\\benchmark\\", nullptr);
+        CreateDirectoryA(directory.c_str(), nullptr);
+
+        vector<string> playlist;
+        for (int i = 0; i < faceCount; i++) {
+            char name[32];
+            sprintf_s(name, "face%02d.wfm", i);
+            playlist.push_back(directory + name);
+            if (!CopyFileA("resources\\faces\\candide3_textured.wfm", playlist.back().c_str(), FALSE)) {
+                cout << "  Could not copy resources\\faces\\candide3_textured.wfm" << endl;
+                return false;
+            }
+        }
+
+        sf::Context context;
+
+        // Budgets for a few faces, so most of the library is evicted as it goes
+        eruFace::Model mesh;
+        FaceTexture texture;
+        if (!mesh.read(playlist[0]) || !texture.Load(mesh._texFilename, "cache\\benchmark\\")) {
+            cout << "  Could not load " << playlist[0] << endl;
+            return false;
+        }
+        size_t textureBytes = 0;
+        for (int level = 0; level < texture.GetLevelCount(); level++)
+            textureBytes += static_cast<size_t>(texture.GetLevelWidth(level)) * texture.GetLevelHeight(level) * 2;
+        const size_t cpuBudget = textureBytes * 4;
+        const size_t gpuBudget = textureBytes * 2;
+
+        bool ok = true;
+        for (int prefetchCount = 0; prefetchCount <= 2; prefetchCount += 2) {
+            FaceAssetCache cache("benchmark", cpuBudget, gpuBudget);
+            cache.SetTextureCache("cache\\benchmark\\");
+
+            long long acquireTicks = 0;
+            size_t peakCpu = 0, peakGpu = 0;
+            bool failed = false;
+            for (int i = 0; i < faceCount && !failed; i++) {
+                long long start = Profiler::Now();
+                shared_ptr<const FaceAsset> face = cache.Acquire(playlist[i]);
+                acquireTicks += Profiler::Now() - start;
+                failed = !face;
+
+                vector<string> next;
+                for (int j = 1; j <= prefetchCount && i + j < faceCount; j++)
+                    next.push_back(playlist[i + j]);
+                if (!next.empty())
+                    cache.Prefetch(next);
+
+                // Frames drawn with the face, as the render thread would
+                for (int frame = 0; frame < framesPerFace; frame++) {
+                    this_thread::sleep_for(chrono::milliseconds(16));
+                    cache.Update();
+                    FaceAssetCache::Statistics s = cache.GetStatistics();
+                    peakCpu = (s.cpuBytes > peakCpu) ? s.cpuBytes : peakCpu;
+                    peakGpu = (s.gpuBytes > peakGpu) ? s.gpuBytes : peakGpu;
+                }
+            }
+
+            FaceAssetCache::Statistics s = cache.GetStatistics();
+            char result[160];
+            ok = ok && !failed;
+            if (failed)
+                sprintf_s(result, "FAILED");
+            else
+                sprintf_s(result, "%llu hits, %llu misses, %llu/%llu evicted, peak %.1f/%.1f MB (budget %.1f/%.1f)",
+                    s.hits, s.misses, s.evictions, s.textureEvictions,
+                    peakCpu / 1048576.0, peakGpu / 1048576.0, cpuBudget / 1048576.0, gpuBudget / 1048576.0);
+            Report((prefetchCount > 0) ? "Acquire, prefetching 2 ahead" : "Acquire, no prefetch",
+                Profiler::TicksToSeconds(acquireTicks) * 1e6 / faceCount, result);
+        }
+
+        return ok;
+    }
+
+    //////////////////////////////////////////////////////////////////////
+
+    // Each returns false if its results are wrong (eg. a MISMATCH)
+    struct Benchmark {
+        const char* name;
+        bool (*fn)();
+    };
+
+    const Benchmark benchmarks[] = {
+        { "facedepth", FaceDepth },
+        { "sync", Sync },
+        { "parallel", Parallel },
+        { "composite", Composite },
+        { "sharedoutput", SharedOutput },
+        { "wfm", Wfm },
+        { "blendshapes", Blendshapes },
+        { "transfer", Transfer },
+        { "subdivision", Subdivision },
+        { "candide3", Candide3 },
+        { "facetexture", FaceTextures },
+        { "facecache", FaceCache },
+    };
+}
+
+int Benchmarks::Run(const std::vector<std::string>& names) {
+    int run = 0;
+    vector<string> failed;
+    for (const Benchmark& b : benchmarks) {
+        if (!names.empty() && find(names.begin(), names.end(), string(b.name)) == names.end())
+            continue;
+
+        if (!b.fn())
+            failed.push_back(b.name);
+        cout << endl;
+        run++;
+    }
+
+    if (run == 0) {
+        cout << "No matching benchmarks. Available:" << endl;
+        for (const Benchmark& b : benchmarks)
+            cout << "  " << b.name << endl;
+        return 1;
+    }
+
+    if (!failed.empty()) {
+        cout << "FAILED:";
+        for (const string& name : failed)
+            cout << " " << name;
+        cout << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "CameraCalibration.h"
+
+#include <iostream>
+
+using namespace std;
+
+CameraCalibration::CameraCalibration() :
+rotation(cv::Matx33f::eye()),
+translation(0.0f, 0.0f, 0.0f)
+{
+}
+
+static bool ReadIntrinsics(const cv::FileStorage& fs, const string& prefix, CameraIntrinsics* intrinsics) {
+    cv::Mat k;
+    fs[prefix + "_intrinsics"] >> k;
+    if (k.rows != 3 || k.cols != 3)
+        return false;
+    k.convertTo(k, CV_32F);
+
+    intrinsics->width = static_cast<int>(fs[prefix + "_width"]);
+    intrinsics->height = static_cast<int>(fs[prefix + "_height"]);
+    intrinsics->fx = k.at<float>(0, 0);
+    intrinsics->fy = k.at<float>(1, 1);
+    intrinsics->cx = k.at<float>(0, 2);
+    intrinsics->cy = k.at<float>(1, 2);
+
+    return intrinsics->width > 0 && intrinsics->height > 0 && intrinsics->fx > 0 && intrinsics->fy > 0;
+}
+
+bool CameraCalibration::Load(const std::string& filename) {
+    cv::FileStorage fs(filename, cv::FileStorage::READ);
+    if (!fs.isOpened())
+        return false;
+
+    if (!ReadIntrinsics(fs, "color", &color) || !ReadIntrinsics(fs, "depth", &depth)) {
+        cout << "Invalid camera intrinsics in " << filename << endl;
+        return false;
+    }
+
+    cv::Mat r, t;
+    fs["rotation"] >> r;
+    fs["translation"] >> t;
+    if (r.total() != 9 || t.total() != 3) {
+        cout << "Invalid camera extrinsics in " << filename << endl;
+        return false;
+    }
+    r.convertTo(r, CV_32F);
+    t.convertTo(t, CV_32F);
+
+    rotation = cv::Matx33f(r.ptr<float>());
+    translation = cv::Vec3f(t.ptr<float>());
+
+    return true;
+}
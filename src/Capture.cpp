@@ -2,11 +2,19 @@
 
 #include <iostream>
 
+#include "utils\Profiler.h"
+
 using namespace std;
 using namespace openni;
 
 Capture::Capture():
-fpsCounter(8)
+frameIndex(0),
+fpsCounter(8),
+averageFps(0.0f),
+framesCaptured(nullptr),
+timestampSkew(nullptr),
+droppedColorFrames(nullptr),
+droppedDepthFrames(nullptr)
 {
 
 }
@@ -21,19 +29,30 @@ Capture::~Capture()
     colorStream.destroy();
 }
 
-void Capture::Initialize() {
+void Capture::Initialize(const std::string& replayFile) {
     // Initialize the Kinect camera
-    cout << "Initializing Kinect Camera" << endl;
+    if (replayFile.empty())
+        cout << "Initializing Kinect Camera" << endl;
+    else
+        cout << "Replaying " << replayFile << endl;
     openni::Status rc = openni::STATUS_OK;
 
     rc = OpenNI::initialize();
     if (rc != openni::STATUS_OK)
         throw runtime_error(string("Could not initialize OpenNI library: ") + string(OpenNI::getExtendedError()));
 
-    rc = device.open(openni::ANY_DEVICE);
+    // OpenNI can open a recorded .oni file in place of a device
+    rc = device.open(replayFile.empty() ? openni::ANY_DEVICE : replayFile.c_str());
     if (rc != openni::STATUS_OK)
         throw runtime_error(string("Device open failed: ") + string(OpenNI::getExtendedError()));
 
+    if (device.isFile()) {
+        // Loop the recording. The synchronizer resets itself when the timestamps jump back.
+        PlaybackControl* playback = device.getPlaybackControl();
+        if (playback != nullptr)
+            playback->setRepeatEnabled(true);
+    }
+
     rc = depthStream.create(device, openni::SENSOR_DEPTH);
     if (rc != openni::STATUS_OK)
         throw runtime_error(string("Couldn't find depth stream: ") + string(OpenNI::getExtendedError()));
@@ -53,85 +72,108 @@ void Capture::Initialize() {
     if (!depthStream.isValid() || !colorStream.isValid())
         throw runtime_error("No valid streams");
 
+    openni::VideoMode colorMode = colorStream.getVideoMode();
+    colorSize = cv::Size(colorMode.getResolutionX(), colorMode.getResolutionY());
+
+    // Depth is registered to color in software (see DepthRegistration) rather than by the driver
     //device.setImageRegistrationMode(openni::IMAGE_REGISTRATION_DEPTH_TO_COLOR);
+
+    auto& registry = Metrics::GetRegistry();
+    framesCaptured = &registry.AddCounter("capture_frames_total", "Color/depth frame pairs read from the camera");
+    timestampSkew = &registry.AddGauge("capture_timestamp_skew_ms", "Difference between the color and depth device timestamps of the latest pair");
+    droppedColorFrames = &registry.AddCounter("capture_unmatched_frames_total", "Frames dropped by the synchronizer without a partner", "stream=\"color\"");
+    droppedDepthFrames = &registry.AddCounter("capture_unmatched_frames_total", "Frames dropped by the synchronizer without a partner", "stream=\"depth\"");
 }
 
-void Capture::Process() {
+bool Capture::Read(FramePacket& packet) {
     //if (!depthStream.isValid() || !colorStream.isValid())
     //    throw runtime_error("Error reading depth/color stream");
 
     fpsCounter.BeginPeriod();
 
-    int changedIndex;
-    auto streams = new VideoStream*[2] {&colorStream, &depthStream};
-    //auto frames = new VideoFrameRef[2];
-
-    openni::Status rc = OpenNI::waitForAnyStream(streams, 2, &changedIndex);
-    if (rc != openni::STATUS_OK)
-        throw runtime_error("Could not read depth sensor");
-
-
-    /*mutex.lock();
-    switch (changedIndex) {
-    case 0: {
-                rc = colorStream.readFrame(&colorFrame);
-                if (rc != openni::STATUS_OK || !colorFrame.isValid())
+    VideoStream* streams[] = { &colorStream, &depthStream };
+    VideoFrameRef color, depth;
+
+    // Read whichever stream has a frame ready (reading the other would block), and let
+    // the synchronizer decide which color/depth frames belong together.
+    // Keep going until it has a matched pair, using the newest if there are several.
+    bool havePair = false;
+    while (!havePair) {
+        int changedIndex;
+        openni::Status rc;
+        {
+            PROFILE_SCOPE("Capture wait");
+            rc = OpenNI::waitForAnyStream(streams, 2, &changedIndex, wait_timeout);
+            if (rc == openni::STATUS_TIME_OUT)
+                return false;   // Give the caller a chance to stop
+            if (rc != openni::STATUS_OK)
+                throw runtime_error("Could not read depth sensor");
+        }
+
+        {
+            PROFILE_SCOPE("readFrame");
+
+            VideoFrameRef frame;
+            switch (changedIndex) {
+            case 0:
+                rc = colorStream.readFrame(&frame);
+                if (rc != openni::STATUS_OK || !frame.isValid())
                     throw runtime_error("Error reading color stream");
+                synchronizer.PushColor(frame);
                 break;
-    }
-    case 1: {
-                rc = depthStream.readFrame(&depthFrame);
-                if (rc != openni::STATUS_OK || !depthFrame.isValid())
+
+            case 1:
+                rc = depthStream.readFrame(&frame);
+                if (rc != openni::STATUS_OK || !frame.isValid())
                     throw runtime_error("Error reading depth stream");
+                synchronizer.PushDepth(frame);
                 break;
-    }
-    default:
-        throw runtime_error("Invalid stream index");
-    }
-    mutex.unlock();*/
-    
-    mutex.lock();
 
-    rc = colorStream.readFrame(&colorFrame);
-    if (rc != openni::STATUS_OK || !colorFrame.isValid())
-        throw runtime_error("Error reading color stream");
+            default:
+                throw runtime_error("Invalid stream index");
+            }
+        }
 
-    rc = depthStream.readFrame(&depthFrame);
-    if (rc != openni::STATUS_OK || !depthFrame.isValid())
-        throw runtime_error("Error reading depth stream");
+        while (synchronizer.Pop(&color, &depth))
+            havePair = true;
 
-    mutex.unlock();
-
-    fpsCounter.EndPeriod();
-
-    
-}
-
-//void Capture::GetFrame(cv::OutputArray color, cv::OutputArray depth) {
-void Capture::GetFrame(cv::Mat *color, cv::Mat *depth) {
-
-    // Wait for capture
-    //TODO: Are mutexes a good way to do this? Are there other ways?
-    mutex.lock();
-
-    if (colorFrame.isValid()) {
-        *color = cv::Mat(colorFrame.getHeight(), colorFrame.getWidth(), CV_8UC3, (void*)colorFrame.getData());
+        UpdateSyncMetrics();
     }
 
-    if (depthFrame.isValid()) {
-        *depth = cv::Mat(depthFrame.getHeight(), depthFrame.getWidth(), CV_16U, (void*)depthFrame.getData());
-
+    // Copy out of the driver's buffers, which are recycled once the frame refs are released
+    {
+        PROFILE_SCOPE("Copy frame");
+        cv::Mat(color.getHeight(), color.getWidth(), CV_8UC3, const_cast<void*>(color.getData()), color.getStrideInBytes()).copyTo(packet.color);
+        cv::Mat(depth.getHeight(), depth.getWidth(), CV_16U, const_cast<void*>(depth.getData()), depth.getStrideInBytes()).copyTo(packet.depthRaw);
     }
 
-    mutex.unlock();
+    packet.info = FrameInfo();
+    packet.info.frameIndex = ++frameIndex;
+    packet.info.colorTimestamp = color.getTimestamp();
+    packet.info.depthTimestamp = depth.getTimestamp();
+    packet.info.captureTime = Profiler::Now();
+
+    framesCaptured->Increment();
+    timestampSkew->Set((static_cast<double>(packet.info.colorTimestamp) - static_cast<double>(packet.info.depthTimestamp)) / 1000.0);
 
+    fpsCounter.EndPeriod();
+    averageFps = fpsCounter.GetAverageFps();
+    return true;
 }
 
-void Capture::Run() {
-    cout << "Thread started" << endl;
+void Capture::UpdateSyncMetrics() {
+    FrameSynchronizer::Statistics stats;
+    synchronizer.GetStatistics(&stats);
+
+    // The synchronizer keeps running totals, the metrics counters only go up by the difference
+    droppedColorFrames->Increment(stats.droppedColor - syncStatistics.droppedColor);
+    droppedDepthFrames->Increment(stats.droppedDepth - syncStatistics.droppedDepth);
 
-    while (!m_stop)
-        Process();
+    lock_guard<std::mutex> lock(mutex);
+    syncStatistics = stats;
+}
 
-    cout << "Thread stopped" << endl;
+void Capture::GetSyncStatistics(FrameSynchronizer::Statistics* stats) {
+    lock_guard<std::mutex> lock(mutex);
+    *stats = syncStatistics;
 }
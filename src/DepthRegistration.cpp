@@ -0,0 +1,132 @@
+#include "DepthRegistration.h"
+
+#include <stdexcept>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DEPTH_REGISTRATION_SSE2
+#endif
+
+using namespace std;
+
+DepthRegistration::DepthRegistration()
+{
+}
+
+DepthRegistration::~DepthRegistration()
+{
+}
+
+void DepthRegistration::Initialize(const CameraCalibration& calibration) {
+    color = calibration.color;
+    depth = calibration.depth;
+    translation = calibration.translation;
+
+    rayX.create(depth.height, depth.width, CV_32F);
+    rayY.create(depth.height, depth.width, CV_32F);
+    rayZ.create(depth.height, depth.width, CV_32F);
+
+    // A depth pixel (u,v) with depth z is the point z * ((u-cx)/fx, (v-cy)/fy, 1) in the
+    // depth camera frame, which is z * R * ray + T in the color camera frame.
+    for (int y = 0; y < depth.height; y++) {
+        for (int x = 0; x < depth.width; x++) {
+            cv::Vec3f ray(
+                (static_cast<float>(x) - depth.cx) / depth.fx,
+                (static_cast<float>(y) - depth.cy) / depth.fy,
+                1.0f);
+            cv::Vec3f r = calibration.rotation * ray;
+
+            rayX.at<float>(y, x) = r[0];
+            rayY.at<float>(y, x) = r[1];
+            rayZ.at<float>(y, x) = r[2];
+        }
+    }
+}
+
+void DepthRegistration::Apply(const cv::Mat& depthImage, cv::Mat& registered) {
+    if (!IsInitialized())
+        throw runtime_error("Depth registration has not been initialized");
+
+    if (depthImage.type() != CV_16U || depthImage.cols != depth.width || depthImage.rows != depth.height)
+        throw runtime_error("Depth image does not match the calibrated depth resolution");
+
+    registered.create(color.height, color.width, CV_16U);
+    registered.setTo(0);
+
+    for (int y = 0; y < depthImage.rows; y++)
+        ApplyRow(depthImage.ptr<unsigned short>(y), y, registered);
+}
+
+inline void DepthRegistration::Splat(cv::Mat& registered, int u, int v, float z) {
+    if (u < 0 || v < 0 || u >= color.width || v >= color.height || z <= 0.0f || z > 65535.0f)
+        return;
+
+    // Keep the nearest surface when several depth pixels land on the same color pixel
+    unsigned short zi = static_cast<unsigned short>(z + 0.5f);
+    unsigned short& out = registered.at<unsigned short>(v, u);
+    if (out == 0 || zi < out)
+        out = zi;
+}
+
+void DepthRegistration::ApplyRow(const unsigned short* src, int y, cv::Mat& registered) {
+    const float* rx = rayX.ptr<float>(y);
+    const float* ry = rayY.ptr<float>(y);
+    const float* rz = rayZ.ptr<float>(y);
+
+    const float tx = translation[0], ty = translation[1], tz = translation[2];
+    int x = 0;
+
+#ifdef DEPTH_REGISTRATION_SSE2
+    // Transform and project 4 pixels at a time. The scatter into the output can't be vectorized.
+    const __m128 vtx = _mm_set1_ps(tx), vty = _mm_set1_ps(ty), vtz = _mm_set1_ps(tz);
+    const __m128 vfx = _mm_set1_ps(color.fx), vfy = _mm_set1_ps(color.fy);
+    const __m128 vcx = _mm_set1_ps(color.cx), vcy = _mm_set1_ps(color.cy);
+    const __m128i zero = _mm_setzero_si128();
+
+    // Plain arrays with unaligned stores, so this builds the same with any compiler
+    int us[4];
+    int vs[4];
+    float zs[4];
+
+    for (; x + 4 <= depth.width; x += 4) {
+        __m128i d16 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x));
+
+        // Skip runs of invalid depth (common in the background)
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(d16, zero)) == 0xFFFF)
+            continue;
+
+        __m128 z = _mm_cvtepi32_ps(_mm_unpacklo_epi16(d16, zero));
+
+        __m128 px = _mm_add_ps(_mm_mul_ps(z, _mm_loadu_ps(rx + x)), vtx);
+        __m128 py = _mm_add_ps(_mm_mul_ps(z, _mm_loadu_ps(ry + x)), vty);
+        __m128 pz = _mm_add_ps(_mm_mul_ps(z, _mm_loadu_ps(rz + x)), vtz);
+
+        __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), pz);
+        __m128 u = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(px, inv), vfx), vcx);
+        __m128 v = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(py, inv), vfy), vcy);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(us), _mm_cvtps_epi32(u));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(vs), _mm_cvtps_epi32(v));
+        _mm_storeu_ps(zs, pz);
+
+        for (int i = 0; i < 4; i++) {
+            if (src[x + i] != 0)
+                Splat(registered, us[i], vs[i], zs[i]);
+        }
+    }
+#endif
+
+    for (; x < depth.width; x++) {
+        if (src[x] == 0)
+            continue;
+
+        float z = static_cast<float>(src[x]);
+        float px = z * rx[x] + tx;
+        float py = z * ry[x] + ty;
+        float pz = z * rz[x] + tz;
+
+        int u = cvRound(color.fx * px / pz + color.cx);
+        int v = cvRound(color.fy * py / pz + color.cy);
+        Splat(registered, u, v, pz);
+    }
+}
@@ -0,0 +1,97 @@
+#include "FaceDepthEstimator.h"
+
+#include <cmath>
+
+FaceDepthEstimator::FaceDepthEstimator() :
+nearTrim(0.05f),
+farTrim(0.25f),
+minValidPixels(32),
+alpha(0.3f),
+snapDistance(150.0f),
+holdFrames(10),
+depth(NAN),
+framesSinceValid(0)
+{
+}
+
+FaceDepthEstimator::~FaceDepthEstimator()
+{
+}
+
+void FaceDepthEstimator::SetTrim(float nearTrim, float farTrim) {
+    this->nearTrim = nearTrim;
+    this->farTrim = farTrim;
+}
+
+void FaceDepthEstimator::SetFilter(float alpha, float snapDistance, int holdFrames) {
+    this->alpha = alpha;
+    this->snapDistance = snapDistance;
+    this->holdFrames = holdFrames;
+}
+
+void FaceDepthEstimator::Reset() {
+    depth = NAN;
+    framesSinceValid = 0;
+}
+
+float FaceDepthEstimator::Estimate(const cv::Mat& image, const cv::Rect& rect) const {
+    CV_Assert(image.type() == CV_16U);
+
+    cv::Rect roi = rect & cv::Rect(0, 0, image.cols, image.rows);
+    if (roi.area() == 0)
+        return NAN;
+
+    unsigned int histogram[BinCount] = {};
+    int valid = 0;
+
+    for (int y = roi.y; y < roi.y + roi.height; y++) {
+        const unsigned short* row = image.ptr<unsigned short>(y) + roi.x;
+        for (int x = 0; x < roi.width; x++) {
+            // Unsigned wrap-around rejects both 0 (no depth) and anything out of range
+            unsigned int bin = static_cast<unsigned int>(row[x] - MinDepth) / BinSize;
+            if (bin < static_cast<unsigned int>(BinCount)) {
+                histogram[bin]++;
+                valid++;
+            }
+        }
+    }
+
+    if (valid < minValidPixels)
+        return NAN;
+
+    // Median of the samples that remain after trimming, ie. this quantile of all samples
+    float keep = 1.0f - nearTrim - farTrim;
+    float target = (nearTrim + keep * 0.5f) * static_cast<float>(valid);
+
+    unsigned int cumulative = 0;
+    for (int i = 0; i < BinCount; i++) {
+        if (cumulative + histogram[i] > target) {
+            // Interpolate within the bin
+            float t = (target - static_cast<float>(cumulative)) / static_cast<float>(histogram[i]);
+            return static_cast<float>(MinDepth) + (static_cast<float>(i) + t) * static_cast<float>(BinSize);
+        }
+        cumulative += histogram[i];
+    }
+
+    return static_cast<float>(MaxDepth);
+}
+
+float FaceDepthEstimator::Update(const cv::Mat& image, const cv::Rect& roi) {
+    float estimate = Estimate(image, roi);
+
+    if (estimate != estimate) {
+        // Hold the last value for a little while, then give up
+        if (++framesSinceValid > holdFrames)
+            depth = NAN;
+        return depth;
+    }
+
+    framesSinceValid = 0;
+
+    if (depth != depth || std::abs(estimate - depth) > snapDistance)
+        depth = estimate;
+    else
+        depth += alpha * (estimate - depth);
+
+    return depth;
+}
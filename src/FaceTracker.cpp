@@ -5,6 +5,8 @@
 
 #include <SFML\System.hpp>
 
+#include "utils\Profiler.h"
+
 using namespace std;
 
 ft_error::ft_error(string message, HRESULT hr) : runtime_error(NULL)
@@ -70,15 +72,16 @@ FaceTracker::FaceTracker()
 
 }
 
-void FaceTracker::Initialize() {
+void FaceTracker::Initialize(const CameraCalibration& calibration) {
     isTracked = false;
     hasFace = false;
 
     faceRect = { 0, 0, 0, 0 };
+    faceDepth = NAN;
 
     HRESULT hr;
-    videoConfig = { 640, 480, 531.15f };   // TODO: Don't hard-code these values
-    depthConfig = { 640, 480, 285.63f*2.0f };
+    videoConfig = { static_cast<UINT>(calibration.color.width), static_cast<UINT>(calibration.color.height), calibration.color.fx };
+    depthConfig = { static_cast<UINT>(calibration.depth.width), static_cast<UINT>(calibration.depth.height), calibration.depth.fx };
 
     pFaceTracker = FTCreateFaceTracker(NULL);
     if (pFaceTracker == nullptr)
@@ -108,20 +111,61 @@ void FaceTracker::Initialize() {
     sensorData.pDepthFrame = pDepthImage;
     sensorData.ZoomFactor = 1.0f;
     sensorData.ViewOffset = { 0, 0 };
+
+    InitializeMetrics();
+}
+
+void FaceTracker::InitializeMetrics() {
+    auto& registry = Metrics::GetRegistry();
+
+    trackAttempts = &registry.AddCounter("facetracker_attempts_total", "Frames passed to the face tracker");
+    trackSuccesses = &registry.AddCounter("facetracker_success_total", "Frames where a face was tracked");
+    trackLost = &registry.AddCounter("facetracker_lost_total", "Times tracking was lost after having a face");
+
+    static const HRESULT known_errors[] = {
+        FT_ERROR_INVALID_MODELS, FT_ERROR_INVALID_INPUT_IMAGE, FT_ERROR_FACE_DETECTOR_FAILED,
+        FT_ERROR_AAM_FAILED, FT_ERROR_NN_FAILED, FT_ERROR_UNINITIALIZED, FT_ERROR_INVALID_MODEL_PATH,
+        FT_ERROR_EVAL_FAILED, FT_ERROR_INVALID_CAMERA_CONFIG, FT_ERROR_INVALID_3DHINT,
+        FT_ERROR_HEAD_SEARCH_FAILED, FT_ERROR_USER_LOST, FT_ERROR_KINECT_DLL_FAILED,
+        FT_ERROR_KINECT_NOT_CONNECTED,
+    };
+
+    failureCounters.clear();
+    for (HRESULT hr : known_errors) {
+        char labels[32];
+        sprintf_s(labels, "hresult=\"0x%08X\"", static_cast<unsigned int>(hr));
+        failureCounters.push_back(make_pair(hr, &registry.AddCounter(
+            "facetracker_failures_total", "Tracking failures by HRESULT", labels)));
+    }
+    otherFailures = &registry.AddCounter("facetracker_failures_total", "Tracking failures by HRESULT", "hresult=\"other\"");
+}
+
+void FaceTracker::CountFailure(HRESULT hr) {
+    if (otherFailures == nullptr)
+        return;
+
+    for (auto& f : failureCounters) {
+        if (f.first == hr) {
+            f.second->Increment();
+            return;
+        }
+    }
+    otherFailures->Increment();
 }
 
-void FaceTracker::Track(cv::Mat colorImage, cv::Mat depthImage)
+void FaceTracker::Track(cv::Mat colorImage, cv::Mat depthImage, cv::Mat registeredDepth)
 {
     HRESULT hr;
 
     FT_SENSOR_DATA sd(pColorImage, pDepthImage, 1.0f);
 
-    cv::Mat colorimg = colorImage;
-    cv::Mat depthimg = depthImage;
+    // Converted into buffers kept between frames, so they're only allocated once
+    cv::Mat& colorimg = colorBuffer;
+    cv::Mat& depthimg = depthBuffer;
     cv::cvtColor(colorImage, colorimg, cv::COLOR_BGR2RGBA);
 
     // The library expects D13P3 format, ie. the last 3 bits are the player index. Therefore we need to <<3 (or multiply by 8) to get it to work.
-    depthimg = depthimg * 8;      
+    depthImage.convertTo(depthimg, CV_16U, 8.0);
     
     // Get camera frame buffer
     hr = pColorImage->Attach(colorimg.cols, colorimg.rows, colorimg.data, FTIMAGEFORMAT_UINT8_B8G8R8X8, colorimg.cols*colorimg.channels());
@@ -134,20 +178,36 @@ void FaceTracker::Track(cv::Mat colorImage, cv::Mat depthImage)
 
 
     if (!isTracked) {
+        PROFILE_SCOPE("StartTracking");
         hr = pFaceTracker->StartTracking(&sd, NULL, NULL, pFTResult);
     }
     else {
+        PROFILE_SCOPE("ContinueTracking");
         hr = pFaceTracker->ContinueTracking(&sd, NULL, pFTResult);
     }
 
     //printTrackingState(hr);
 
-    if (SUCCEEDED(hr) && SUCCEEDED(pFTResult->GetStatus())) {
+    if (trackAttempts != nullptr)
+        trackAttempts->Increment();
+
+    HRESULT status = SUCCEEDED(hr) ? pFTResult->GetStatus() : hr;
+
+    if (SUCCEEDED(status)) {
+        if (trackSuccesses != nullptr)
+            trackSuccesses->Increment();
+
         isTracked = true;
         hasFace = true;
 
         pFTResult->GetFaceRect(&this->faceRect);
 
+        if (!registeredDepth.empty()) {
+            PROFILE_SCOPE("FaceDepth");
+            cv::Rect roi(faceRect.left, faceRect.top, faceRect.right - faceRect.left, faceRect.bottom - faceRect.top);
+            faceDepth = depthEstimator.Update(registeredDepth, roi);
+        }
+
         float scale, rotation[3], translation[3];
         pFTResult->Get3DPose(&scale, rotation, translation);
 
@@ -155,14 +215,27 @@ void FaceTracker::Track(cv::Mat colorImage, cv::Mat depthImage)
         this->rotation = sf::Vector3f(rotation[0], rotation[1], rotation[2]);
         this->translation = sf::Vector3f(translation[0], translation[1], translation[2]);
 
-        // Get 3D face model
-        model.UpdateModel(pFTResult, &videoConfig);
+        // Get the face model parameters (the mesh itself is deformed later, see CustomFaceModel::Deform)
+        PROFILE_SCOPE("UpdateParameters");
+        model.UpdateParameters(pFTResult);
 
         pFTResult->GetStatus();
     }
     else {
+        CountFailure(status);
+
+        // The next face found may belong to someone else
+        if (isTracked) {
+            model.ResetShapeUnits();
+            if (trackLost != nullptr)
+                trackLost->Increment();
+        }
+
         isTracked = false;
         pFTResult->Reset();
+
+        depthEstimator.Reset();
+        faceDepth = NAN;
     }
 }
 
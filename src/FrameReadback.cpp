@@ -0,0 +1,126 @@
+#include "FrameReadback.h"
+
+#include <cstddef>
+#include <cstring>
+
+// OpenGL 2.1 pixel buffer object entry points, which Windows' opengl32 doesn't export
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#define GL_PIXEL_PACK_BUFFER    0x88EB
+#define GL_STREAM_READ          0x88E1
+#define GL_READ_ONLY            0x88B8
+#ifndef GL_BGRA
+#define GL_BGRA                 0x80E1
+#endif
+
+namespace
+{
+    typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+    typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+    typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+    typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+    typedef void* (APIENTRY *MapBufferProc)(GLenum target, GLenum access);
+    typedef GLboolean (APIENTRY *UnmapBufferProc)(GLenum target);
+
+    GenBuffersProc      glGenBuffers_ = nullptr;
+    DeleteBuffersProc   glDeleteBuffers_ = nullptr;
+    BindBufferProc      glBindBuffer_ = nullptr;
+    BufferDataProc      glBufferData_ = nullptr;
+    MapBufferProc       glMapBuffer_ = nullptr;
+    UnmapBufferProc     glUnmapBuffer_ = nullptr;
+
+    template<class T>
+    bool Load(T& proc, const char* name) {
+        proc = reinterpret_cast<T>(wglGetProcAddress(name));
+        return proc != nullptr;
+    }
+}
+
+FrameReadback::FrameReadback(int buffers) :
+    bufferCount(buffers),
+    next(0),
+    pending(0)
+{
+}
+
+FrameReadback::~FrameReadback()
+{
+    Release();
+}
+
+bool FrameReadback::Initialize() {
+    bool loaded =
+        Load(glGenBuffers_, "glGenBuffers") &&
+        Load(glDeleteBuffers_, "glDeleteBuffers") &&
+        Load(glBindBuffer_, "glBindBuffer") &&
+        Load(glBufferData_, "glBufferData") &&
+        Load(glMapBuffer_, "glMapBuffer") &&
+        Load(glUnmapBuffer_, "glUnmapBuffer");
+    if (!loaded)
+        return false;
+
+    pbos.resize(bufferCount);
+    reads.resize(bufferCount);
+    capacity.assign(bufferCount, 0);
+    glGenBuffers_(bufferCount, pbos.data());
+    next = 0;
+    pending = 0;
+    return true;
+}
+
+void FrameReadback::Release() {
+    if (!pbos.empty() && glDeleteBuffers_ != nullptr)
+        glDeleteBuffers_(static_cast<GLsizei>(pbos.size()), pbos.data());
+    pbos.clear();
+    pending = 0;
+}
+
+bool FrameReadback::Begin(int width, int height) {
+    if (!IsAvailable() || pending == bufferCount)
+        return false;
+
+    size_t size = static_cast<size_t>(width) * height * 4;
+
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, pbos[next]);
+    if (capacity[next] != size) {
+        glBufferData_(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        capacity[next] = size;
+    }
+
+    // With a pack buffer bound this returns straight away, the copy happens on the GPU
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, 0);
+
+    reads[next].width = width;
+    reads[next].height = height;
+    next = (next + 1) % bufferCount;
+    pending++;
+    return true;
+}
+
+bool FrameReadback::Collect(cv::Mat* frame) {
+    if (pending == 0)
+        return false;
+
+    int oldest = (next - pending + bufferCount) % bufferCount;
+    pending--;
+
+    if (frame == nullptr)
+        return true;
+
+    const Read& read = reads[oldest];
+    frame->create(read.height, read.width, CV_8UC4);
+
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, pbos[oldest]);
+    const void* pixels = glMapBuffer_(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (pixels != nullptr) {
+        std::memcpy(frame->data, pixels, frame->total() * frame->elemSize());
+        glUnmapBuffer_(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer_(GL_PIXEL_PACK_BUFFER, 0);
+
+    return pixels != nullptr;
+}
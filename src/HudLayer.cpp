@@ -0,0 +1,185 @@
+#include "HudLayer.h"
+
+HudLayer::HudLayer() :
+    font(nullptr),
+    sdfFont(nullptr),
+    characterSize(16),
+    batchDirty(false),
+    rebuildCount(0)
+{
+}
+
+void HudLayer::SetFont(const sf::Font& font, unsigned int characterSize) {
+    this->font = &font;
+    this->sdfFont = nullptr;
+    this->characterSize = characterSize;
+    labels.clear();
+    batch.clear();
+    batchDirty = false;
+}
+
+void HudLayer::SetFont(const SdfFont& font, unsigned int characterSize) {
+    this->font = nullptr;
+    this->sdfFont = &font;
+    this->characterSize = characterSize;
+    labels.clear();
+    batch.clear();
+    batchDirty = false;
+}
+
+int HudLayer::AddLabel(sf::Vector2f position, Alignment alignment, sf::Color color) {
+    Label label;
+    label.position = position;
+    label.alignment = alignment;
+    label.color = color;
+    label.visible = true;
+    labels.push_back(label);
+    return static_cast<int>(labels.size()) - 1;
+}
+
+void HudLayer::SetText(int label, const char* text) {
+    Label& l = labels[label];
+    if (l.text == text)
+        return;
+
+    l.text = text;
+    Layout(l);
+    batchDirty = true;
+}
+
+void HudLayer::SetVisible(int label, bool visible) {
+    Label& l = labels[label];
+    if (l.visible != visible) {
+        l.visible = visible;
+        batchDirty = true;
+    }
+}
+
+HudLayer::GlyphQuad HudLayer::GetGlyph(sf::Uint32 c) const {
+    GlyphQuad q;
+
+    if (sdfFont != nullptr) {
+        // The atlas is at the raster size, so scale it to the character size
+        const SdfFont::Glyph& glyph = sdfFont->GetGlyph(c);
+        float scale = static_cast<float>(characterSize) / sdfFont->GetRasterSize();
+
+        q.left = glyph.bounds.left * scale;
+        q.top = glyph.bounds.top * scale;
+        q.right = (glyph.bounds.left + glyph.bounds.width) * scale;
+        q.bottom = (glyph.bounds.top + glyph.bounds.height) * scale;
+        q.u1 = static_cast<float>(glyph.textureRect.left);
+        q.v1 = static_cast<float>(glyph.textureRect.top);
+        q.u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width);
+        q.v2 = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height);
+        q.advance = glyph.advance * scale;
+    }
+    else {
+        const sf::Glyph& glyph = font->getGlyph(c, characterSize, false);
+
+        q.left = static_cast<float>(glyph.bounds.left);
+        q.top = static_cast<float>(glyph.bounds.top);
+        q.right = q.left + static_cast<float>(glyph.bounds.width);
+        q.bottom = q.top + static_cast<float>(glyph.bounds.height);
+        q.u1 = static_cast<float>(glyph.textureRect.left);
+        q.v1 = static_cast<float>(glyph.textureRect.top);
+        q.u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width);
+        q.v2 = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height);
+        q.advance = static_cast<float>(glyph.advance);
+    }
+
+    return q;
+}
+
+float HudLayer::GetKerning(sf::Uint32 first, sf::Uint32 second) const {
+    if (sdfFont != nullptr)
+        return sdfFont->GetKerning(first, second) * characterSize / sdfFont->GetRasterSize();
+    else
+        return static_cast<float>(font->getKerning(first, second, characterSize));
+}
+
+const sf::Texture* HudLayer::GetTexture() const {
+    if (sdfFont != nullptr)
+        return &sdfFont->GetTexture();
+    else if (font != nullptr)
+        return &font->getTexture(characterSize);
+    else
+        return nullptr;
+}
+
+void HudLayer::Layout(Label& label) {
+    label.vertices.clear();
+    if (font == nullptr && sdfFont == nullptr)
+        return;
+
+    rebuildCount++;
+
+    // As sf::Text lays out its glyphs (single line, regular style)
+    float hspace = GetGlyph(L' ').advance;
+    float x = 0.0f;
+    float y = static_cast<float>(characterSize);
+    float minX = 0.0f, maxX = 0.0f;
+    bool first = true;
+
+    sf::Uint32 prevChar = 0;
+    for (size_t i = 0; i < label.text.size(); i++) {
+        sf::Uint32 curChar = static_cast<unsigned char>(label.text[i]);
+
+        x += GetKerning(prevChar, curChar);
+        prevChar = curChar;
+
+        if (curChar == ' ') {
+            x += hspace;
+            continue;
+        }
+        if (curChar == '\t') {
+            x += hspace * 4;
+            continue;
+        }
+
+        GlyphQuad q = GetGlyph(curChar);
+
+        label.vertices.push_back(sf::Vertex(sf::Vector2f(x + q.left, y + q.top), label.color, sf::Vector2f(q.u1, q.v1)));
+        label.vertices.push_back(sf::Vertex(sf::Vector2f(x + q.right, y + q.top), label.color, sf::Vector2f(q.u2, q.v1)));
+        label.vertices.push_back(sf::Vertex(sf::Vector2f(x + q.right, y + q.bottom), label.color, sf::Vector2f(q.u2, q.v2)));
+        label.vertices.push_back(sf::Vertex(sf::Vector2f(x + q.left, y + q.bottom), label.color, sf::Vector2f(q.u1, q.v2)));
+
+        if (first || x + q.left < minX)
+            minX = x + q.left;
+        if (first || x + q.right > maxX)
+            maxX = x + q.right;
+        first = false;
+
+        x += q.advance;
+    }
+
+    // Right aligned text is offset by its width, as with sf::Text::getLocalBounds
+    sf::Vector2f offset = label.position;
+    if (label.alignment == AlignRight)
+        offset.x -= maxX - minX;
+
+    for (auto& v : label.vertices)
+        v.position += offset;
+}
+
+void HudLayer::Draw(sf::RenderTarget& target, const sf::Shader* shader) {
+    const sf::Texture* texture = GetTexture();
+    if (texture == nullptr)
+        return;
+
+    if (batchDirty) {
+        batch.clear();
+        for (const Label& l : labels) {
+            if (l.visible)
+                batch.insert(batch.end(), l.vertices.begin(), l.vertices.end());
+        }
+        batchDirty = false;
+    }
+
+    if (batch.empty())
+        return;
+
+    sf::RenderStates states;
+    states.texture = texture;
+    states.shader = shader;
+    target.draw(batch.data(), static_cast<unsigned int>(batch.size()), sf::Quads, states);
+}
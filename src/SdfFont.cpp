@@ -0,0 +1,134 @@
+#include "SdfFont.h"
+
+#include <opencv2\core.hpp>
+#include <opencv2\imgproc.hpp>
+
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    const int atlasWidth = 1024;
+}
+
+SdfFont::SdfFont() :
+    font(nullptr),
+    rasterSize(0),
+    spread(0)
+{
+    empty.bounds = sf::FloatRect(0, 0, 0, 0);
+    empty.textureRect = sf::IntRect(0, 0, 0, 0);
+    empty.advance = 0.0f;
+}
+
+string SdfFont::DefaultCharacters() {
+    string characters;
+    for (char c = 32; c < 127; c++)
+        characters += c;
+    return characters;
+}
+
+bool SdfFont::Generate(const sf::Font& font, unsigned int rasterSize, int spread, const string& characters) {
+    this->font = &font;
+    this->rasterSize = rasterSize;
+    this->spread = spread;
+    glyphs.clear();
+
+    // Render every glyph first, then read the font's texture back once
+    vector<sf::Glyph> rendered;
+    for (size_t i = 0; i < characters.size(); i++)
+        rendered.push_back(font.getGlyph(static_cast<unsigned char>(characters[i]), rasterSize, false));
+
+    sf::Image page = font.getTexture(rasterSize).copyToImage();
+    cv::Mat pageRGBA(page.getSize().y, page.getSize().x, CV_8UC4, const_cast<sf::Uint8*>(page.getPixelsPtr()));
+
+    // Lay the glyphs out in rows, each padded by the spread so the field has room to fall off
+    vector<cv::Rect> cells(characters.size());
+    int x = 0, y = 0, rowHeight = 0;
+    for (size_t i = 0; i < characters.size(); i++) {
+        const sf::IntRect& r = rendered[i].textureRect;
+        if (r.width <= 0 || r.height <= 0)
+            continue;   // Eg. space
+
+        int w = r.width + 2 * spread;
+        int h = r.height + 2 * spread;
+        if (x + w > atlasWidth) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        cells[i] = cv::Rect(x, y, w, h);
+        x += w;
+        rowHeight = (h > rowHeight) ? h : rowHeight;
+    }
+
+    cv::Mat atlas(y + rowHeight, atlasWidth, CV_8U, cv::Scalar(0));
+    if (atlas.rows == 0)
+        return false;
+
+    int fromTo[] = { 3, 0 };
+    cv::Mat coverage, inside, outside, distInside, distOutside, field;
+
+    for (size_t i = 0; i < characters.size(); i++) {
+        const sf::Glyph& g = rendered[i];
+        sf::Uint32 c = static_cast<unsigned char>(characters[i]);
+
+        Glyph glyph;
+        glyph.advance = static_cast<float>(g.advance);
+        glyph.bounds = sf::FloatRect(0, 0, 0, 0);
+        glyph.textureRect = sf::IntRect(0, 0, 0, 0);
+
+        const cv::Rect& cell = cells[i];
+        if (cell.area() > 0) {
+            // Glyph coverage (alpha), padded
+            coverage.create(cell.height, cell.width, CV_8U);
+            coverage.setTo(cv::Scalar(0));
+            const sf::IntRect& r = g.textureRect;
+            cv::Mat src = pageRGBA(cv::Rect(r.left, r.top, r.width, r.height));
+            cv::Mat dst = coverage(cv::Rect(spread, spread, r.width, r.height));
+            cv::mixChannels(&src, 1, &dst, 1, fromTo, 1);
+
+            // Signed distance to the edge: distances to the nearest pixel on the other side
+            inside = coverage >= 128;
+            outside = coverage < 128;
+            cv::distanceTransform(inside, distInside, cv::DIST_L2, cv::DIST_MASK_PRECISE);
+            cv::distanceTransform(outside, distOutside, cv::DIST_L2, cv::DIST_MASK_PRECISE);
+
+            // 0.5 + (inside - outside) / (2 * spread), as 8 bits
+            field = distInside - distOutside;
+            cv::Mat atlasCell = atlas(cell);
+            field.convertTo(atlasCell, CV_8U, 127.5 / spread, 127.5);
+
+            glyph.bounds = sf::FloatRect(
+                static_cast<float>(g.bounds.left - spread), static_cast<float>(g.bounds.top - spread),
+                static_cast<float>(g.bounds.width + 2 * spread), static_cast<float>(g.bounds.height + 2 * spread));
+            glyph.textureRect = sf::IntRect(cell.x, cell.y, cell.width, cell.height);
+        }
+
+        glyphs[c] = glyph;
+    }
+
+    // White, with the field in alpha, so vertex colors tint it as with regular text
+    sf::Image image;
+    image.create(atlas.cols, atlas.rows, sf::Color::White);
+    for (int row = 0; row < atlas.rows; row++) {
+        const unsigned char* p = atlas.ptr<unsigned char>(row);
+        for (int col = 0; col < atlas.cols; col++)
+            image.setPixel(col, row, sf::Color(255, 255, 255, p[col]));
+    }
+
+    if (!texture.loadFromImage(image))
+        return false;
+    texture.setSmooth(true);
+    return true;
+}
+
+const SdfFont::Glyph& SdfFont::GetGlyph(sf::Uint32 c) const {
+    auto it = glyphs.find(c);
+    return (it != glyphs.end()) ? it->second : empty;
+}
+
+float SdfFont::GetKerning(sf::Uint32 first, sf::Uint32 second) const {
+    return (font != nullptr) ? static_cast<float>(font->getKerning(first, second, rasterSize)) : 0.0f;
+}
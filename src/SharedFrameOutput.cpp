@@ -0,0 +1,198 @@
+#include "SharedFrameOutput.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+    uint32_t AlignUp(size_t n) {
+        return static_cast<uint32_t>((n + SharedFrame::Alignment - 1) / SharedFrame::Alignment * SharedFrame::Alignment);
+    }
+}
+
+SharedFrameOutput::SharedFrameOutput() :
+    mapping(nullptr),
+    view(nullptr),
+    header(nullptr),
+    begun(0),
+    published(0)
+{
+}
+
+SharedFrameOutput::~SharedFrameOutput()
+{
+    Close();
+}
+
+bool SharedFrameOutput::Create(const string& name, int slotCount, int colorWidth, int colorHeight, int outputMaxWidth, int outputMaxHeight) {
+    Close();
+
+    if (slotCount < 2 || colorWidth <= 0 || colorHeight <= 0 || outputMaxWidth <= 0 || outputMaxHeight <= 0) {
+        cerr << "Invalid shared frame output size: " << slotCount << " slots of " << colorWidth << "x" << colorHeight
+            << ", output up to " << outputMaxWidth << "x" << outputMaxHeight << endl;
+        return false;
+    }
+
+    uint32_t colorOffset = AlignUp(sizeof(SharedFrame::SlotHeader));
+    uint32_t depthOffset = colorOffset + AlignUp(static_cast<size_t>(colorWidth) * colorHeight * 3);
+    uint32_t outputOffset = depthOffset + AlignUp(static_cast<size_t>(colorWidth) * colorHeight * 2);
+    uint32_t slotSize = outputOffset + AlignUp(static_cast<size_t>(outputMaxWidth) * outputMaxHeight * 4);
+    uint32_t headerSize = AlignUp(sizeof(SharedFrame::Header));
+    unsigned long long size = headerSize + static_cast<unsigned long long>(slotSize) * slotCount;
+
+    // Backed by the page file, and zero filled
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), name.c_str());
+    if (mapping == nullptr) {
+        cerr << "Could not create shared frame output " << name << " (error " << GetLastError() << ")" << endl;
+        return false;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        cerr << "Shared frame output " << name << " is already in use" << endl;
+        Close();
+        return false;
+    }
+
+    view = static_cast<unsigned char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+    if (view == nullptr) {
+        cerr << "Could not map shared frame output " << name << " (error " << GetLastError() << ")" << endl;
+        Close();
+        return false;
+    }
+
+    header = reinterpret_cast<SharedFrame::Header*>(view);
+    header->version = SharedFrame::Version;
+    header->headerSize = headerSize;
+    header->slotCount = slotCount;
+    header->slotSize = slotSize;
+    header->colorWidth = colorWidth;
+    header->colorHeight = colorHeight;
+    header->outputMaxWidth = outputMaxWidth;
+    header->outputMaxHeight = outputMaxHeight;
+    header->colorOffset = colorOffset;
+    header->depthOffset = depthOffset;
+    header->outputOffset = outputOffset;
+    header->published = 0;
+    MemoryBarrier();
+    header->magic = SharedFrame::Magic;
+
+    begun = 0;
+    published = 0;
+    slotFrame.assign(slotCount, -1);
+    slotFinished.assign(slotCount, false);
+    return true;
+}
+
+void SharedFrameOutput::Close() {
+    if (view != nullptr)
+        UnmapViewOfFile(view);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+
+    view = nullptr;
+    mapping = nullptr;
+    header = nullptr;
+}
+
+SharedFrame::SlotHeader* SharedFrameOutput::GetSlot(int slot) const {
+    return reinterpret_cast<SharedFrame::SlotHeader*>(view + header->headerSize + static_cast<size_t>(slot) * header->slotSize);
+}
+
+int SharedFrameOutput::Begin(const FramePacket& packet) {
+    if (!IsOpen())
+        return -1;
+
+    // Keep at least one published frame that isn't being rewritten
+    int slotCount = static_cast<int>(header->slotCount);
+    if (begun - published >= slotCount - 1)
+        return -1;
+
+    int slot = begun % slotCount;
+    slotFrame[slot] = begun;
+    begun++;
+
+    SharedFrame::SlotHeader* s = GetSlot(slot);
+    InterlockedIncrement(&s->sequence);     // Odd: readers leave it alone until Publish
+
+    s->frameIndex = packet.info.frameIndex;
+    s->colorTimestamp = packet.info.colorTimestamp;
+    s->depthTimestamp = packet.info.depthTimestamp;
+
+    s->isTracked = packet.isTracked ? 1 : 0;
+    s->trackStatus = packet.trackStatus;
+    s->faceRect[0] = packet.faceRect.x;
+    s->faceRect[1] = packet.faceRect.y;
+    s->faceRect[2] = packet.faceRect.width;
+    s->faceRect[3] = packet.faceRect.height;
+    s->faceDepth = packet.faceDepth;
+    s->scale = packet.scale;
+    s->rotation[0] = packet.rotation.x;
+    s->rotation[1] = packet.rotation.y;
+    s->rotation[2] = packet.rotation.z;
+    s->translation[0] = packet.translation.x;
+    s->translation[1] = packet.translation.y;
+    s->translation[2] = packet.translation.z;
+
+    s->actionUnitCount = static_cast<uint32_t>(packet.actionUnits.size() < SharedFrame::MaxActionUnits ? packet.actionUnits.size() : SharedFrame::MaxActionUnits);
+    s->shapeUnitCount = static_cast<uint32_t>(packet.shapeUnits.size() < SharedFrame::MaxShapeUnits ? packet.shapeUnits.size() : SharedFrame::MaxShapeUnits);
+    if (s->actionUnitCount > 0)
+        memcpy(s->actionUnits, packet.actionUnits.data(), s->actionUnitCount * sizeof(float));
+    if (s->shapeUnitCount > 0)
+        memcpy(s->shapeUnits, packet.shapeUnits.data(), s->shapeUnitCount * sizeof(float));
+
+    s->outputWidth = 0;
+    s->outputHeight = 0;
+    s->outputFormat = SharedFrame::OutputNone;
+    s->outputBottomUp = 0;
+
+    // Wrap the slot's images, so copyTo writes straight into them
+    unsigned char* base = reinterpret_cast<unsigned char*>(s);
+    int width = header->colorWidth;
+    int height = header->colorHeight;
+    if (packet.color.cols == width && packet.color.rows == height && packet.color.type() == CV_8UC3) {
+        cv::Mat color(height, width, CV_8UC3, base + header->colorOffset);
+        packet.color.copyTo(color);
+    }
+    if (packet.depthRegistered.cols == width && packet.depthRegistered.rows == height && packet.depthRegistered.type() == CV_16U) {
+        cv::Mat depth(height, width, CV_16U, base + header->depthOffset);
+        packet.depthRegistered.copyTo(depth);
+    }
+
+    return slot;
+}
+
+cv::Mat SharedFrameOutput::GetOutput(int slot, int width, int height) {
+    if (!IsOpen() || width > static_cast<int>(header->outputMaxWidth) || height > static_cast<int>(header->outputMaxHeight))
+        return cv::Mat();
+
+    unsigned char* base = reinterpret_cast<unsigned char*>(GetSlot(slot));
+    return cv::Mat(height, width, CV_8UC4, base + header->outputOffset);
+}
+
+void SharedFrameOutput::Publish(int slot, int outputWidth, int outputHeight, SharedFrame::OutputFormat format, bool bottomUp) {
+    if (!IsOpen())
+        return;
+
+    SharedFrame::SlotHeader* s = GetSlot(slot);
+    s->outputWidth = outputWidth;
+    s->outputHeight = outputHeight;
+    s->outputFormat = format;
+    s->outputBottomUp = bottomUp ? 1 : 0;
+    slotFinished[slot] = true;
+
+    // Release every finished slot from the oldest in flight on, so the latest frame never goes backwards
+    int slotCount = static_cast<int>(header->slotCount);
+    bool released = false;
+    while (published < begun && slotFinished[published % slotCount]) {
+        int oldest = published % slotCount;
+        slotFinished[oldest] = false;
+        InterlockedIncrement(&GetSlot(oldest)->sequence);   // Even again
+        published = slotFrame[oldest] + 1;
+        released = true;
+    }
+
+    if (released)
+        InterlockedExchange(&header->published, published);
+}
@@ -0,0 +1,135 @@
+#include "SharedFrameReader.h"
+
+#include <cstring>
+
+SharedFrameReader::SharedFrameReader() :
+    mapping(nullptr),
+    view(nullptr),
+    header(nullptr),
+    lastFrame(0),
+    tornCount(0)
+{
+}
+
+SharedFrameReader::~SharedFrameReader()
+{
+    Close();
+}
+
+bool SharedFrameReader::Open(const std::string& name) {
+    Close();
+
+    mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (mapping == nullptr)
+        return false;
+
+    view = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (view == nullptr) {
+        Close();
+        return false;
+    }
+
+    const SharedFrame::Header* h = reinterpret_cast<const SharedFrame::Header*>(view);
+    if (h->magic != SharedFrame::Magic || h->version != SharedFrame::Version || h->slotCount == 0) {
+        Close();
+        return false;
+    }
+    MemoryBarrier();    // The rest of the header was written before the magic
+
+    // Make sure the layout fits in what was mapped
+    MEMORY_BASIC_INFORMATION info;
+    unsigned long long size = h->headerSize + static_cast<unsigned long long>(h->slotSize) * h->slotCount;
+    if (VirtualQuery(view, &info, sizeof(info)) == 0 || info.RegionSize < size) {
+        Close();
+        return false;
+    }
+
+    header = h;
+    lastFrame = 0;
+    tornCount = 0;
+    return true;
+}
+
+void SharedFrameReader::Close() {
+    if (view != nullptr)
+        UnmapViewOfFile(view);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+
+    view = nullptr;
+    mapping = nullptr;
+    header = nullptr;
+}
+
+bool SharedFrameReader::Latest(View& v) {
+    if (!IsOpen())
+        return false;
+
+    for (;;) {
+        long frame = header->published;
+        if (frame == lastFrame)
+            return false;
+
+        int slot = static_cast<int>(static_cast<unsigned long>(frame - 1) % header->slotCount);
+        const unsigned char* base = view + header->headerSize + static_cast<size_t>(slot) * header->slotSize;
+        const SharedFrame::SlotHeader* s = reinterpret_cast<const SharedFrame::SlotHeader*>(base);
+
+        long sequence = s->sequence;
+        MemoryBarrier();
+
+        // Being rewritten already, so a newer frame has been (or is about to be) published
+        if (sequence & 1) {
+            tornCount++;
+            YieldProcessor();
+            continue;
+        }
+
+        v.slot = s;
+        v.color = base + header->colorOffset;
+        v.depth = reinterpret_cast<const uint16_t*>(base + header->depthOffset);
+        v.output = base + header->outputOffset;
+        v.sequence = sequence;
+        v.frame = frame;
+
+        lastFrame = frame;
+        return true;
+    }
+}
+
+bool SharedFrameReader::Validate(const View& v) const {
+    MemoryBarrier();    // Everything read from the view happens before checking the sequence
+    return v.slot->sequence == v.sequence;
+}
+
+bool SharedFrameReader::Read(Frame& frame) {
+    View v;
+    while (Latest(v)) {
+        size_t colorSize = static_cast<size_t>(header->colorWidth) * header->colorHeight;
+
+        memcpy(&frame.info, v.slot, sizeof(frame.info));
+
+        // The size may be garbage if the slot is being overwritten, so clamp it to what fits
+        uint32_t outputWidth = frame.info.outputWidth < header->outputMaxWidth ? frame.info.outputWidth : header->outputMaxWidth;
+        uint32_t outputHeight = frame.info.outputHeight < header->outputMaxHeight ? frame.info.outputHeight : header->outputMaxHeight;
+        size_t outputSize = static_cast<size_t>(outputWidth) * outputHeight * 4;
+
+        frame.color.resize(colorSize * 3);
+        frame.depth.resize(colorSize);
+        frame.output.resize(outputSize);
+        memcpy(frame.color.data(), v.color, colorSize * 3);
+        memcpy(frame.depth.data(), v.depth, colorSize * sizeof(uint16_t));
+        if (outputSize > 0)
+            memcpy(frame.output.data(), v.output, outputSize);
+
+        if (Validate(v)) {
+            frame.frame = v.frame;
+            return true;
+        }
+
+        // Overwritten while copying; try again with whatever is latest now
+        tornCount++;
+        lastFrame = 0;
+    }
+
+    return false;
+}
@@ -0,0 +1,117 @@
+#include "SnapshotWriter.h"
+
+#include <opencv2\imgcodecs.hpp>
+#include <opencv2\imgproc.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#include "utils\Profiler.h"
+
+using namespace std;
+
+SnapshotWriter::SnapshotWriter(size_t backlog) :
+    pool(backlog),
+    queue(backlog)
+{
+    for (size_t i = 0; i < backlog; i++) {
+        snapshots.push_back(unique_ptr<Snapshot>(new Snapshot()));
+        pool.TryPush(snapshots.back().get());
+    }
+
+    auto& registry = Metrics::GetRegistry();
+    writtenCounter = &registry.AddCounter("snapshots_total", "Snapshots written");
+    skippedCounter = &registry.AddCounter("snapshots_skipped_total", "Snapshots not taken because too many were still being written");
+    writeHistogram = &registry.AddHistogram("snapshot_write_time_ms", "Time to convert and encode a snapshot", Metrics::LatencyBuckets());
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    {
+        lock_guard<std::mutex> lock(wakeMutex);
+        m_stop = true;
+    }
+    wake.notify_all();
+    Stop();
+}
+
+SnapshotWriter::Snapshot* SnapshotWriter::Acquire() {
+    Snapshot* snapshot;
+    if (!pool.TryPop(snapshot)) {
+        skippedCounter->Increment();
+        return nullptr;
+    }
+
+    snapshot->screenshot.release();
+    snapshot->screenshotConversion = cv::COLOR_BGRA2BGR;
+    snapshot->flipScreenshot = false;
+    return snapshot;
+}
+
+void SnapshotWriter::Submit(Snapshot* snapshot) {
+    if (!m_started)
+        Start();
+
+    // The queue holds as many snapshots as the pool, so this can't fail
+    queue.TryPush(snapshot);
+    wake.notify_one();
+}
+
+void SnapshotWriter::Discard(Snapshot* snapshot) {
+    pool.TryPush(snapshot);
+}
+
+void SnapshotWriter::Run() {
+    Profiler::SetThreadName("Snapshot");
+
+    // Anything still queued when stopping is written before returning
+    for (;;) {
+        Snapshot* snapshot;
+        if (!queue.TryPop(snapshot)) {
+            if (m_stop)
+                break;
+
+            unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, chrono::milliseconds(100));
+            continue;
+        }
+
+        long long start = Profiler::Now();
+        try {
+            Write(*snapshot);
+        }
+        catch (cv::Exception& e) {
+            cerr << "Snapshot: " << e.what() << endl;
+        }
+        writeHistogram->Observe(Profiler::TicksToSeconds(Profiler::Now() - start) * 1000.0);
+
+        pool.TryPush(snapshot);
+    }
+}
+
+void SnapshotWriter::Write(Snapshot& snapshot) {
+    PROFILE_SCOPE("SnapshotWriter::Write");
+
+    cv::cvtColor(snapshot.color, converted, cv::COLOR_RGB2BGR);
+    cv::imwrite(snapshot.prefix + "_color.png", converted);
+
+    cv::imwrite(snapshot.prefix + "_depthraw.png", snapshot.depthRaw);
+
+    cv::normalize(snapshot.depth, converted, 0.0, 255.0, cv::NORM_MINMAX, CV_8U);
+    cv::applyColorMap(converted, converted, cv::COLORMAP_JET);
+    cv::imwrite(snapshot.prefix + "_depth.png", converted);
+
+    if (!snapshot.screenshot.empty()) {
+        cv::cvtColor(snapshot.screenshot, converted, snapshot.screenshotConversion);
+        if (snapshot.flipScreenshot) {
+            cv::flip(converted, flipped, 0);
+            cv::imwrite(snapshot.prefix + "_screenshot.png", flipped);
+        }
+        else {
+            cv::imwrite(snapshot.prefix + "_screenshot.png", converted);
+        }
+    }
+
+    writtenCounter->Increment();
+    cout << "Wrote " << snapshot.prefix << "_*.png" << endl;
+}
@@ -0,0 +1,384 @@
+#include "SoftwareCompositor.h"
+#include "utils\TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_COMPOSITOR_SSE2
+#endif
+
+using namespace std;
+
+namespace
+{
+    const float pi = 3.14159265358979f;
+    const float nearPlane = 0.1f;   // As in Draw3D
+
+    // RGB <> YCbCr, as in face-blend.frag (the overlay's luma is precomputed by FaceTexture)
+    const float kCbR = -0.1687f, kCbG = -0.3313f, kCbB = 0.5f;
+    const float kCrR = 0.5f, kCrG = -0.4187f, kCrB = -0.0813f;
+    const float kRCr = 1.402f;
+    const float kGCb = -0.34414f, kGCr = -0.71414f;
+    const float kBCb = 1.772f;
+
+    inline int ToByte(float c) {
+        c = (c < 0.0f) ? 0.0f : ((c > 1.0f) ? 1.0f : c);
+        return static_cast<int>(c * 255.0f + 0.5f);
+    }
+
+    // Luminance of the overlay (level corrected), chrominance of the background, blended
+    // over the background by the overlay's alpha. fg is a FaceTexture texel (luma * alpha,
+    // alpha), so the overlay's side is premultiplied. All channels normalized to 0-1.
+    // The SSE2 path in ShadeTile must do exactly the same operations, in the same order.
+    inline void Blend(const unsigned char* fg, unsigned char* bg, float invRange, float offset) {
+        const float inv255 = 1.0f / 255.0f;
+        float ya = fg[0] * inv255, a = fg[1] * inv255;
+        float br = bg[0] * inv255, bg_ = bg[1] * inv255, bb = bg[2] * inv255;
+
+        float y = ya * invRange + offset * a;
+        float cb = ((br * kCbR + bg_ * kCbG) + bb * kCbB) * a;
+        float cr = ((br * kCrR + bg_ * kCrG) + bb * kCrB) * a;
+
+        float r = y + cr * kRCr;
+        float g = (y + cb * kGCb) + cr * kGCr;
+        float b = y + cb * kBCb;
+
+        float ia = 1.0f - a;
+        bg[0] = static_cast<unsigned char>(ToByte(r + br * ia));
+        bg[1] = static_cast<unsigned char>(ToByte(g + bg_ * ia));
+        bg[2] = static_cast<unsigned char>(ToByte(b + bb * ia));
+    }
+}
+
+SoftwareCompositor::SoftwareCompositor(float verticalFov) :
+    verticalFov(verticalFov),
+    tileParallel(false),
+    nVertices(0)
+{
+}
+
+SoftwareCompositor::~SoftwareCompositor()
+{
+}
+
+void SoftwareCompositor::SetMesh(eruFace::Model& mesh) {
+    if (!mesh.hasTexCoords())
+        throw runtime_error("Software compositing needs a mesh with texture coordinates");
+
+    nVertices = mesh.nVertices();
+
+    indices.clear();
+    for (int f = 0; f < mesh.nFaces(); f++) {
+        auto face = mesh.face(f);
+        for (int v = 0; v < 3; v++)
+            indices.push_back(face[v]);
+    }
+
+    texCoords.resize(nVertices * 2);
+    for (int i = 0; i < nVertices; i++) {
+        auto uv = mesh.texCoord(i);
+        texCoords[i * 2 + 0] = static_cast<float>(uv[0]);
+        texCoords[i * 2 + 1] = static_cast<float>(uv[1]);
+    }
+
+    triangles.reserve(mesh.nFaces());
+    screen.resize(nVertices * 3);
+}
+
+void SoftwareCompositor::SetTexture(const FaceTexture& faceTexture) {
+    if (!faceTexture.IsLoaded())
+        throw runtime_error("Software compositor needs a loaded face texture");
+
+    cv::Mat(faceTexture.GetHeight(), faceTexture.GetWidth(), CV_8UC2, const_cast<unsigned char*>(faceTexture.GetLevel(0))).copyTo(texture);
+}
+
+void SoftwareCompositor::Draw(cv::Mat& frame, const std::vector<float>& vertices,
+    sf::Vector3f rotation, sf::Vector3f translation, sf::Vector2f lumaCorrect)
+{
+    if (indices.empty() || texture.empty())
+        throw runtime_error("Software compositor has no mesh or texture");
+
+    if (frame.type() != CV_8UC3 && frame.type() != CV_8UC4)
+        throw runtime_error("Software compositor needs an 8-bit RGB or RGBA frame");
+
+    if (vertices.size() < static_cast<size_t>(nVertices) * 3)
+        return;
+
+    const int width = frame.cols;
+    const int height = frame.rows;
+
+    // Model -> camera: glTranslate(T), then glRotate about x, y and z (in that order).
+    // Draw3D's gluLookAt along +z followed by glScalef(-1,1,1) leaves x and y as they are
+    // and makes w (the distance in front of the camera) equal to z.
+    cv::Matx33f rx, ry, rz;
+    {
+        float a = rotation.x * pi / 180.0f, b = rotation.y * pi / 180.0f, c = rotation.z * pi / 180.0f;
+        rx = cv::Matx33f(1, 0, 0, 0, cos(a), -sin(a), 0, sin(a), cos(a));
+        ry = cv::Matx33f(cos(b), 0, sin(b), 0, 1, 0, -sin(b), 0, cos(b));
+        rz = cv::Matx33f(cos(c), -sin(c), 0, sin(c), cos(c), 0, 0, 0, 1);
+    }
+    cv::Matx33f r = rx * ry * rz;
+
+    // gluPerspective
+    const float f = 1.0f / tan(verticalFov * 0.5f * pi / 180.0f);
+    const float aspect = static_cast<float>(width) / static_cast<float>(height);
+
+    // Project the vertices to window coordinates (y down, pixel centers at +0.5)
+    for (int i = 0; i < nVertices; i++) {
+        const float* v = &vertices[i * 3];
+        float px = r(0, 0) * v[0] + r(0, 1) * v[1] + r(0, 2) * v[2] + translation.x;
+        float py = r(1, 0) * v[0] + r(1, 1) * v[1] + r(1, 2) * v[2] + translation.y;
+        float pz = r(2, 0) * v[0] + r(2, 1) * v[1] + r(2, 2) * v[2] + translation.z;
+
+        float* s = &screen[i * 3];
+        if (pz <= nearPlane) {
+            s[2] = 0.0f;    // Clipped
+            continue;
+        }
+
+        float invW = 1.0f / pz;
+        s[0] = (f / aspect * px * invW + 1.0f) * 0.5f * width;
+        s[1] = height - (f * py * invW + 1.0f) * 0.5f * height;
+        s[2] = invW;
+    }
+
+    // Set up the triangles, and find the area they cover
+    triangles.clear();
+    int boundsX0 = width, boundsY0 = height, boundsX1 = -1, boundsY1 = -1;
+    for (size_t face = 0; face < indices.size() / 3; face++) {
+        Triangle t;
+        if (!SetupTriangle(static_cast<int>(face), t))
+            continue;
+
+        // Clamp to the frame
+        t.minX = max(t.minX, 0);
+        t.minY = max(t.minY, 0);
+        t.maxX = min(t.maxX, width - 1);
+        t.maxY = min(t.maxY, height - 1);
+        if (t.minX > t.maxX || t.minY > t.maxY)
+            continue;
+
+        triangles.push_back(t);
+        boundsX0 = min(boundsX0, t.minX);
+        boundsY0 = min(boundsY0, t.minY);
+        boundsX1 = max(boundsX1, t.maxX);
+        boundsY1 = max(boundsY1, t.maxY);
+    }
+
+    if (triangles.empty())
+        return;
+
+    texelIndex.create(height, width, CV_32S);
+    depthBuffer.create(height, width, CV_32F);
+
+    // Tiles covering the face, aligned to the frame
+    const int tx0 = boundsX0 / TileSize, ty0 = boundsY0 / TileSize;
+    const int tx1 = boundsX1 / TileSize, ty1 = boundsY1 / TileSize;
+    const int tilesX = tx1 - tx0 + 1;
+    const int tileCount = tilesX * (ty1 - ty0 + 1);
+
+    auto renderTiles = [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            cv::Rect tile((tx0 + i % tilesX) * TileSize, (ty0 + i / tilesX) * TileSize, TileSize, TileSize);
+            tile &= cv::Rect(0, 0, width, height);
+
+            RasterizeTile(tile);
+            ShadeTile(frame, tile, lumaCorrect);
+        }
+    };
+
+    // Tiles are independent, so the result is the same whichever way they're rendered
+    if (tileParallel)
+        TaskScheduler::Default().ParallelFor(0, tileCount, 1, renderTiles);
+    else
+        renderTiles(0, tileCount);
+}
+
+bool SoftwareCompositor::SetupTriangle(int face, Triangle& t) const {
+    for (int v = 0; v < 3; v++) {
+        int i = indices[face * 3 + v];
+        const float* s = &screen[i * 3];
+        if (s[2] <= 0.0f)
+            return false;   // Behind the near plane
+
+        t.x[v] = s[0];
+        t.y[v] = s[1];
+        t.invW[v] = s[2];
+        t.uw[v] = texCoords[i * 2 + 0] * s[2];
+        t.vw[v] = texCoords[i * 2 + 1] * s[2];
+    }
+
+    float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+    if (area == 0.0f)
+        return false;
+
+    // Pixels whose centers might be inside
+    float minX = min(t.x[0], min(t.x[1], t.x[2])), maxX = max(t.x[0], max(t.x[1], t.x[2]));
+    float minY = min(t.y[0], min(t.y[1], t.y[2])), maxY = max(t.y[0], max(t.y[1], t.y[2]));
+    t.minX = static_cast<int>(ceil(minX - 0.5f));
+    t.maxX = static_cast<int>(floor(maxX - 0.5f));
+    t.minY = static_cast<int>(ceil(minY - 0.5f));
+    t.maxY = static_cast<int>(floor(maxY - 0.5f));
+    return true;
+}
+
+void SoftwareCompositor::RasterizeTile(const cv::Rect& tile) {
+    texelIndex(tile).setTo(-1);
+    depthBuffer(tile).setTo(0.0f);
+
+    const int texWidth = texture.cols;
+    const int texHeight = texture.rows;
+
+    for (const Triangle& t : triangles) {
+        int x0 = max(t.minX, tile.x), x1 = min(t.maxX, tile.x + tile.width - 1);
+        int y0 = max(t.minY, tile.y), y1 = min(t.maxY, tile.y + tile.height - 1);
+        if (x0 > x1 || y0 > y1)
+            continue;
+
+        // Edge functions, E[k] is for the edge opposite vertex k. Oriented so the
+        // inside is positive whichever way the triangle winds (there's no culling).
+        float a[3], b[3], ex[3], ey[3];
+        bool owns[3];
+        float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+        float sign = (area > 0.0f) ? 1.0f : -1.0f;
+        for (int k = 0; k < 3; k++) {
+            int i = (k + 1) % 3, j = (k + 2) % 3;
+            a[k] = -(t.y[j] - t.y[i]) * sign;
+            b[k] = (t.x[j] - t.x[i]) * sign;
+            ex[k] = t.x[i];
+            ey[k] = t.y[i];
+
+            // Top-left rule: pixels exactly on a shared edge belong to one triangle only
+            owns[k] = (a[k] > 0.0f) || (a[k] == 0.0f && b[k] > 0.0f);
+        }
+        float invArea = 1.0f / (area * sign);
+
+        for (int y = y0; y <= y1; y++) {
+            int* index = texelIndex.ptr<int>(y);
+            float* depth = depthBuffer.ptr<float>(y);
+            float py = y + 0.5f;
+
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+
+                float e[3];
+                bool inside = true;
+                for (int k = 0; k < 3; k++) {
+                    e[k] = a[k] * (px - ex[k]) + b[k] * (py - ey[k]);
+                    if (e[k] < 0.0f || (e[k] == 0.0f && !owns[k]))
+                        inside = false;
+                }
+                if (!inside)
+                    continue;
+
+                float l0 = e[0] * invArea, l1 = e[1] * invArea, l2 = e[2] * invArea;
+                float invW = l0 * t.invW[0] + l1 * t.invW[1] + l2 * t.invW[2];
+
+                // GL_LESS: only strictly nearer fragments replace what's there
+                if (invW <= depth[x])
+                    continue;
+
+                float u = (l0 * t.uw[0] + l1 * t.uw[1] + l2 * t.uw[2]) / invW;
+                float v = (l0 * t.vw[0] + l1 * t.vw[1] + l2 * t.vw[2]) / invW;
+
+                // GL_NEAREST with GL_CLAMP_TO_EDGE
+                int tu = static_cast<int>(floor(u * texWidth));
+                int tv = static_cast<int>(floor(v * texHeight));
+                tu = (tu < 0) ? 0 : ((tu >= texWidth) ? texWidth - 1 : tu);
+                tv = (tv < 0) ? 0 : ((tv >= texHeight) ? texHeight - 1 : tv);
+
+                depth[x] = invW;
+                index[x] = tv * texWidth + tu;
+            }
+        }
+    }
+}
+
+void SoftwareCompositor::ShadeTile(cv::Mat& frame, const cv::Rect& tile, sf::Vector2f lumaCorrect) {
+    const int channels = frame.channels();
+    const unsigned char* texels = texture.ptr<unsigned char>();
+
+    float range = lumaCorrect.y - lumaCorrect.x;
+    const float invRange = (range != 0.0f) ? 1.0f / range : 1.0f;
+    const float offset = lumaCorrect.x;
+
+    for (int y = tile.y; y < tile.y + tile.height; y++) {
+        const int* index = texelIndex.ptr<int>(y);
+        unsigned char* row = frame.ptr<unsigned char>(y);
+        int x = tile.x;
+        const int end = tile.x + tile.width;
+
+#ifdef SOFTWARE_COMPOSITOR_SSE2
+        const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 vInvRange = _mm_set1_ps(invRange);
+        const __m128 vOffset = _mm_set1_ps(offset);
+
+        for (; x + 4 <= end; x += 4) {
+            if (index[x] < 0 && index[x + 1] < 0 && index[x + 2] < 0 && index[x + 3] < 0)
+                continue;   // Nothing drawn here
+
+            // Gather the 4 pixels into planes (plain arrays and unaligned loads/stores,
+            // so this builds the same with any compiler)
+            float fgPlanes[2][4];
+            float bgPlanes[3][4];
+            for (int i = 0; i < 4; i++) {
+                const unsigned char* fg = (index[x + i] >= 0) ? texels + index[x + i] * 2 : nullptr;
+                const unsigned char* bg = row + (x + i) * channels;
+                for (int c = 0; c < 2; c++)
+                    fgPlanes[c][i] = (fg != nullptr) ? fg[c] : 0.0f;
+                for (int c = 0; c < 3; c++)
+                    bgPlanes[c][i] = bg[c];
+            }
+
+            __m128 ya = _mm_mul_ps(_mm_loadu_ps(fgPlanes[0]), inv255);
+            __m128 a = _mm_mul_ps(_mm_loadu_ps(fgPlanes[1]), inv255);
+            __m128 br = _mm_mul_ps(_mm_loadu_ps(bgPlanes[0]), inv255);
+            __m128 bg = _mm_mul_ps(_mm_loadu_ps(bgPlanes[1]), inv255);
+            __m128 bb = _mm_mul_ps(_mm_loadu_ps(bgPlanes[2]), inv255);
+
+            __m128 yy = _mm_add_ps(_mm_mul_ps(ya, vInvRange), _mm_mul_ps(vOffset, a));
+            __m128 cb = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(br, _mm_set1_ps(kCbR)), _mm_mul_ps(bg, _mm_set1_ps(kCbG))), _mm_mul_ps(bb, _mm_set1_ps(kCbB))), a);
+            __m128 cr = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(br, _mm_set1_ps(kCrR)), _mm_mul_ps(bg, _mm_set1_ps(kCrG))), _mm_mul_ps(bb, _mm_set1_ps(kCrB))), a);
+
+            __m128 r = _mm_add_ps(yy, _mm_mul_ps(cr, _mm_set1_ps(kRCr)));
+            __m128 g = _mm_add_ps(_mm_add_ps(yy, _mm_mul_ps(cb, _mm_set1_ps(kGCb))), _mm_mul_ps(cr, _mm_set1_ps(kGCr)));
+            __m128 b = _mm_add_ps(yy, _mm_mul_ps(cb, _mm_set1_ps(kBCb)));
+
+            __m128 ia = _mm_sub_ps(one, a);
+            __m128 out[3] = {
+                _mm_add_ps(r, _mm_mul_ps(br, ia)),
+                _mm_add_ps(g, _mm_mul_ps(bg, ia)),
+                _mm_add_ps(b, _mm_mul_ps(bb, ia)),
+            };
+
+            int bytes[3][4];
+            for (int c = 0; c < 3; c++) {
+                __m128 v = _mm_min_ps(_mm_max_ps(out[c], zero), one);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes[c]), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+            }
+
+            // Only write the pixels that were covered
+            for (int i = 0; i < 4; i++) {
+                if (index[x + i] < 0)
+                    continue;
+                unsigned char* p = row + (x + i) * channels;
+                p[0] = static_cast<unsigned char>(bytes[0][i]);
+                p[1] = static_cast<unsigned char>(bytes[1][i]);
+                p[2] = static_cast<unsigned char>(bytes[2][i]);
+            }
+        }
+#endif
+
+        for (; x < end; x++) {
+            if (index[x] >= 0)
+                Blend(texels + index[x] * 2, row + x * channels, invRange, offset);
+        }
+    }
+}
@@ -0,0 +1,220 @@
+#include "VideoRecorder.h"
+
+#include <opencv2\imgproc.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#include "utils\Profiler.h"
+#include "utils\Timestamp.h"
+
+using namespace std;
+
+VideoRecorder::VideoRecorder(size_t queueSize, double fps) :
+    fps(fps),
+    pool(queueSize),
+    queue(queueSize),
+    recording(false),
+    rawStreams(false),
+    session(0),
+    framesWritten(0),
+    framesDropped(0),
+    openSession(0),
+    isOpen(false)
+{
+    for (size_t i = 0; i < queueSize; i++) {
+        frames.push_back(unique_ptr<Frame>(new Frame()));
+        pool.TryPush(frames.back().get());
+    }
+
+    auto& registry = Metrics::GetRegistry();
+    writtenCounter = &registry.AddCounter("recorder_frames_total", "Frames written by the video recorder");
+    droppedCounter = &registry.AddCounter("recorder_dropped_total", "Frames not recorded because the writer was behind");
+    encodeHistogram = &registry.AddHistogram("recorder_encode_time_ms", "Time to convert and encode a recorded frame", Metrics::LatencyBuckets());
+    registry.AddCallbackGauge("recorder_queue_depth", "Frames waiting to be encoded", [this]() { return static_cast<double>(queue.Size()); });
+}
+
+VideoRecorder::~VideoRecorder()
+{
+    recording = false;
+    {
+        lock_guard<std::mutex> lock(stateMutex);
+        m_stop = true;
+    }
+    wake.notify_all();
+    Stop();
+}
+
+void VideoRecorder::StartRecording(const string& prefix, bool raw) {
+    {
+        lock_guard<std::mutex> lock(stateMutex);
+        filenamePrefix = prefix + "-" + FormatTimestamp();
+    }
+    rawStreams = raw;
+    session++;
+    recording = true;
+
+    if (!m_started)
+        Start();
+}
+
+void VideoRecorder::StopRecording() {
+    recording = false;
+    wake.notify_all();
+}
+
+VideoRecorder::Frame* VideoRecorder::Acquire() {
+    Frame* frame;
+    if (!pool.TryPop(frame)) {
+        framesDropped++;
+        droppedCounter->Increment();
+        return nullptr;
+    }
+
+    frame->outputConversion = cv::COLOR_BGRA2BGR;
+    frame->flipOutput = false;
+    frame->frameIndex = 0;
+    frame->session = session;
+    return frame;
+}
+
+void VideoRecorder::Submit(Frame* frame) {
+    // The queue holds as many frames as the pool, so this can't fail
+    queue.TryPush(frame);
+    wake.notify_one();
+}
+
+void VideoRecorder::Discard(Frame* frame) {
+    pool.TryPush(frame);
+}
+
+void VideoRecorder::Run() {
+    Profiler::SetThreadName("Recorder");
+
+    while (!m_stop) {
+        Frame* frame;
+        if (!queue.TryPop(frame)) {
+            // Nothing to write: once the recording has stopped and everything it
+            // submitted has been written, close the files
+            if (isOpen && (!recording || openSession != session))
+                Close();
+
+            unique_lock<std::mutex> lock(stateMutex);
+            wake.wait_for(lock, chrono::milliseconds(100));
+            continue;
+        }
+
+        long long start = Profiler::Now();
+        try {
+            Write(*frame);
+        }
+        catch (cv::Exception& e) {
+            cerr << "Recorder: " << e.what() << endl;
+        }
+        encodeHistogram->Observe(Profiler::TicksToSeconds(Profiler::Now() - start) * 1000.0);
+
+        pool.TryPush(frame);
+    }
+
+    // Write out whatever is still queued
+    Frame* frame;
+    while (queue.TryPop(frame)) {
+        if (isOpen && frame->session == openSession)
+            Write(*frame);
+        pool.TryPush(frame);
+    }
+    Close();
+}
+
+void VideoRecorder::Write(Frame& frame) {
+    PROFILE_SCOPE("Recorder::Write");
+
+    if (frame.output.empty())
+        return;
+
+    // Left over from a recording that was stopped and replaced before it got written
+    bool openForFrame = isOpen && frame.session == openSession;
+    if (!openForFrame && frame.session != session)
+        return;
+
+    if (isOpen && frame.session != openSession)
+        Close();
+    if (!isOpen)
+        Open(frame);
+
+    // The window may have been resized since the recording started, but a video has a
+    // fixed size
+    if (frame.output.size() != outputSize)
+        return;
+
+    if (outputWriter.isOpened()) {
+        cv::cvtColor(frame.output, converted, frame.outputConversion);
+        if (frame.flipOutput) {
+            cv::flip(converted, flipped, 0);
+            outputWriter.write(flipped);
+        }
+        else {
+            outputWriter.write(converted);
+        }
+    }
+
+    if (colorWriter.isOpened() && !frame.color.empty()) {
+        cv::cvtColor(frame.color, converted, cv::COLOR_RGB2BGR);
+        colorWriter.write(converted);
+    }
+
+    if (depthFile.is_open() && !frame.depthRaw.empty() && frame.depthRaw.isContinuous()) {
+        uint64_t index = frame.frameIndex;
+        uint32_t width = frame.depthRaw.cols;
+        uint32_t height = frame.depthRaw.rows;
+        depthFile.write(reinterpret_cast<const char*>(&index), sizeof(index));
+        depthFile.write(reinterpret_cast<const char*>(&width), sizeof(width));
+        depthFile.write(reinterpret_cast<const char*>(&height), sizeof(height));
+        depthFile.write(reinterpret_cast<const char*>(frame.depthRaw.data), frame.depthRaw.total() * frame.depthRaw.elemSize());
+    }
+
+    framesWritten++;
+    writtenCounter->Increment();
+}
+
+void VideoRecorder::Open(const Frame& frame) {
+    string prefix;
+    {
+        lock_guard<std::mutex> lock(stateMutex);
+        prefix = filenamePrefix;
+    }
+
+    int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+
+    outputSize = frame.output.size();
+    if (!outputWriter.open(prefix + "_output.avi", fourcc, fps, outputSize))
+        cerr << "Recorder: could not open " << prefix << "_output.avi" << endl;
+
+    if (rawStreams) {
+        if (!frame.color.empty() && !colorWriter.open(prefix + "_color.avi", fourcc, fps, frame.color.size()))
+            cerr << "Recorder: could not open " << prefix << "_color.avi" << endl;
+
+        if (!frame.depthRaw.empty()) {
+            depthFile.open(prefix + "_depth.raw", ios::binary);
+            if (!depthFile)
+                cerr << "Recorder: could not open " << prefix << "_depth.raw" << endl;
+        }
+    }
+
+    openSession = frame.session;
+    isOpen = true;
+    cout << "Recording to " << prefix << "_*" << endl;
+}
+
+void VideoRecorder::Close() {
+    if (!isOpen)
+        return;
+
+    outputWriter.release();
+    colorWriter.release();
+    if (depthFile.is_open())
+        depthFile.close();
+    isOpen = false;
+
+    cout << "Recording stopped (" << framesWritten << " frames written, " << framesDropped << " dropped)" << endl;
+}
@@ -3,7 +3,10 @@
 //////////////////////////////////////////////////////////////////////
 
 #include <direct.h>
+#include <climits>
+#include <cstdlib>
 #include <fstream>
+#include <iostream>
 #include <exception>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
@@ -27,7 +30,11 @@ Model::Model()
     _scale                   = 1.0;
     _translation             = 0.0;
     _dynamicParamsModified   = false;
+    _dynamicParamsDirtyAny   = false;
     _staticParamsModified    = false;
+    _dynamicParamEpsilon     = 1e-4;
+    _dynamicRebuildInterval  = 256;
+    _dynamicIncrementalUpdates = 0;
     _vportWidth              = 4;
     _vportHeight             = 4;
 
@@ -52,6 +59,8 @@ Model::init(double viewPortWidth, double viewPortHeight)
     // Arrays
     _dynamicDeformations.clear();
     _dynamicParams.clear();
+    _dynamicParamsApplied.clear();
+    _dynamicParamsDirty.clear();
     _staticDeformations.clear();
     _staticParams.clear();
     _texCoords.clear();
@@ -68,6 +77,8 @@ Model::init(double viewPortWidth, double viewPortHeight)
     _scale                   = 1.0;
     _translation             = 0.0;
     _dynamicParamsModified   = false;
+    _dynamicParamsDirtyAny   = false;
+    _dynamicIncrementalUpdates = 0;
     _staticParamsModified    = false;
     _vportWidth              = viewPortWidth;
     _vportHeight             = viewPortHeight;
@@ -105,7 +116,14 @@ Model::setDynamicParam(int paramNo, double paramVal)
         throw std::runtime_error("Dynamic parameter number out of range!");
     }
     _dynamicParams[paramNo] = paramVal;
-    _dynamicParamsModified = true;
+
+    // Only flag the parameter if it has moved noticeably from the value
+    // that was last applied to the dynamic coords.
+    if (abs(paramVal - _dynamicParamsApplied[paramNo]) >= _dynamicParamEpsilon)
+    {
+        _dynamicParamsDirty[paramNo] = true;
+        _dynamicParamsDirtyAny = true;
+    }
 }
 
 double
@@ -118,6 +136,13 @@ Model::getDynamicParam(int paramNo) const
     return _dynamicParams[paramNo];
 }
 
+void
+Model::setDynamicUpdatePolicy(double epsilon, int rebuildInterval)
+{
+    _dynamicParamEpsilon = epsilon;
+    _dynamicRebuildInterval = rebuildInterval;
+}
+
 //////////////////////////////////////////////////////////////////////
 
 int Model::nStaticDeformations() const
@@ -268,13 +293,37 @@ Model::updateStatic()
 bool
 Model::updateDynamic()
 {
-	if (!updateStatic() && !_dynamicParamsModified)
+    if (updateStatic() || _dynamicParamsModified ||
+        (_dynamicParamsDirtyAny && _dynamicIncrementalUpdates >= _dynamicRebuildInterval))
     {
-		return false;
+        // Full rebuild from the static coords
+        _dynamicCoords.applyDeformations(_staticCoords, _dynamicDeformations, _dynamicParams);
+        _dynamicParamsApplied.assign(_dynamicParams.begin(), _dynamicParams.end());
+        _dynamicParamsDirty.assign(_dynamicParams.size(), false);
+        _dynamicParamsModified = false;
+        _dynamicParamsDirtyAny = false;
+        _dynamicIncrementalUpdates = 0;
+        return true;
     }
-    _dynamicCoords.applyDeformations(_staticCoords, _dynamicDeformations, _dynamicParams);
-	_dynamicParamsModified = false;
-	return true;
+
+    if (!_dynamicParamsDirtyAny)
+    {
+        return false;
+    }
+
+    // Incremental update: only apply the change in each modified parameter
+    for (int i = 0; i < nDynamicDeformations(); i++)
+    {
+        if (_dynamicParamsDirty[i])
+        {
+            _dynamicCoords.applyDeformation(_dynamicDeformations[i], _dynamicParams[i] - _dynamicParamsApplied[i]);
+            _dynamicParamsApplied[i] = _dynamicParams[i];
+            _dynamicParamsDirty[i] = false;
+        }
+    }
+    _dynamicParamsDirtyAny = false;
+    _dynamicIncrementalUpdates++;
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -325,6 +374,53 @@ Model::updateImageCoords(int viewPortSize, int imageWidth, int imageHeight, Proj
 // Copying
 //////////////////////////////////////////////////////////////////////
 
+void
+Model::copyAll(const Model& srcModel)
+{
+    if (this == &srcModel)
+        return;
+
+    _baseCoords = srcModel._baseCoords;
+    _staticCoords = srcModel._staticCoords;
+    _dynamicCoords = srcModel._dynamicCoords;
+    _transformedCoords = srcModel._transformedCoords;
+    _imageCoords = srcModel._imageCoords;
+    _faces = srcModel._faces;
+
+    _dynamicDeformations = srcModel._dynamicDeformations;
+    _dynamicParams = srcModel._dynamicParams;
+    _dynamicParamsApplied = srcModel._dynamicParamsApplied;
+    _dynamicParamsDirty = srcModel._dynamicParamsDirty;
+    _dynamicIndices = srcModel._dynamicIndices;
+    _staticDeformations = srcModel._staticDeformations;
+    _staticParams = srcModel._staticParams;
+    _staticIndices = srcModel._staticIndices;
+
+    _rotation = srcModel._rotation;
+    _scale = srcModel._scale;
+    _translation = srcModel._translation;
+    _transform = srcModel._transform;
+
+    _staticParamsModified = srcModel._staticParamsModified;
+    _dynamicParamsModified = srcModel._dynamicParamsModified;
+    _dynamicParamsDirtyAny = srcModel._dynamicParamsDirtyAny;
+    _transformModified = srcModel._transformModified;
+    _dynamicParamEpsilon = srcModel._dynamicParamEpsilon;
+    _dynamicRebuildInterval = srcModel._dynamicRebuildInterval;
+    _dynamicIncrementalUpdates = srcModel._dynamicIncrementalUpdates;
+    _newTexture = srcModel._newTexture;
+
+    _texCoords = srcModel._texCoords;
+    _texFilename = srcModel._texFilename;
+    _wfmFilename = srcModel._wfmFilename;
+    _smdFilename = srcModel._smdFilename;
+    _amdFilename = srcModel._amdFilename;
+    _vportWidth = srcModel._vportWidth;
+    _vportHeight = srcModel._vportHeight;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void
 Model::copyTexCoords(const Model& srcModel)
 {
@@ -531,7 +627,7 @@ Model::read(const std::string& fname)
 	std::string simplefilename = eru::getSimpleFileName(fname);
     std::string ext = eru::getLowerCaseFileExtension(fname);
 	//std::ifstream is(simplefilename.c_str());
-    std::ifstream is(fname);
+    std::ifstream is(fname, ext == "wfm" ? std::ios::binary : std::ios::in);
 
 	if (!is.is_open())
     {
@@ -540,22 +636,42 @@ Model::read(const std::string& fname)
 
 	if (ext == "wfm")
     {
-		if (success = read(is))
+        // Read the whole file at once and parse it in place
+        std::string text;
+        is.seekg(0, std::ios::end);
+        text.resize(static_cast<size_t>(is.tellg()));
+        is.seekg(0, std::ios::beg);
+        if (!text.empty())
+            is.read(&text[0], text.size());
+        if (!is)
+            return false;
+
+        // Malformed files fail like unreadable ones (rather than throwing), leaving
+        // an empty model rather than a half-parsed one. The error says where.
+        try
         {
-			if (fname.length() <= _MAX_PATH)
-            {
-				_wfmFilename = fname;
-				_amdFilename = fname;
-				_smdFilename = fname;
-			}
-            else
-            {
-				_wfmFilename = "";
-				_amdFilename = "";
-				_smdFilename = "";
-			}
+            parse(text, fname);
+        }
+        catch (std::runtime_error& e)
+        {
+            std::cerr << e.what() << std::endl;
+            init(_vportWidth, _vportHeight);
+            return false;
+        }
+
+		if (fname.length() <= _MAX_PATH)
+        {
+			_wfmFilename = fname;
+			_amdFilename = fname;
+			_smdFilename = fname;
 		}
-		return success;
+        else
+        {
+			_wfmFilename = "";
+			_amdFilename = "";
+			_smdFilename = "";
+		}
+		return true;
 	}
 
 	if (ext == "amd")
@@ -729,7 +845,15 @@ void
 Model::readDynamicDeformations(std::istream& is)
 {
     readDeformations(_dynamicDeformations, "Action Unit", is);
+    indexDynamicDeformations();
+}
+
+void
+Model::indexDynamicDeformations()
+{
     _dynamicParams.assign(nDynamicDeformations(), 0.0);
+    _dynamicParamsApplied.assign(nDynamicDeformations(), 0.0);
+    _dynamicParamsDirty.assign(nDynamicDeformations(), false);
 
     _dynamicIndices.clear();
     for (int i = 0; i < _dynamicDeformations.size(); i++) {
@@ -743,6 +867,12 @@ void
 Model::readStaticDeformations(std::istream& is)
 {
     readDeformations(_staticDeformations, "Shape Unit", is);
+    indexStaticDeformations();
+}
+
+void
+Model::indexStaticDeformations()
+{
     _staticParams.assign(nStaticDeformations(), 0.0);
 
     _staticIndices.clear();
@@ -821,6 +951,290 @@ Model::readGlobal(std::istream& is)
 	is >> _rotation >> _scale >> _translation;
 }
 
+//////////////////////////////////////////////////////////////////////
+// Single pass .wfm parsing
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /// Tokenizer over a whole .wfm file in memory, counting lines for error messages.
+    /// Numbers are converted in place, without going through a stream.
+    class WfmScanner
+    {
+        public:
+            WfmScanner(const std::string& text, const std::string& source)
+                : _p(text.c_str()), _end(text.c_str() + text.size()), _line(1), _source(source) {}
+
+            bool atEnd() { skipSpace(); return _p == _end; }
+            bool atComment() { skipSpace(); return _p != _end && *_p == '#'; }
+
+            /// As eru::skipComments(): lines starting with '#', and empty lines.
+            void skipComments()
+            {
+                while (atComment())
+                    skipLine();
+            }
+
+            /// The rest of the line after any leading whitespace (and empty lines).
+            std::string readLine()
+            {
+                skipSpace();
+                const char* start = _p;
+                skipLine();
+                const char* stop = _p;
+                while (stop != start && (stop[-1] == '\n' || stop[-1] == '\r'))
+                    stop--;
+                return std::string(start, stop);
+            }
+
+            int readInt(const char* what)
+            {
+                skipSpace();
+                const char* p = _p;
+                bool negative = (p != _end && *p == '-');
+                if (p != _end && (*p == '-' || *p == '+'))
+                    p++;
+                if (p == _end || *p < '0' || *p > '9')
+                    fail(what);
+
+                int value = 0;
+                while (p != _end && *p >= '0' && *p <= '9') {
+                    int digit = *p++ - '0';
+                    if (value > (INT_MAX - digit) / 10)
+                        error((boost::format("%s too large") % what).str());
+                    value = value * 10 + digit;
+                }
+                _p = p;
+                endToken(what);
+                return negative ? -value : value;
+            }
+
+            double readDouble(const char* what)
+            {
+                skipSpace();
+                if (_p == _end)
+                    fail(what);
+
+                // The text is null terminated (it's a std::string), so strtod can't run past the end
+                char* stop;
+                double value = strtod(_p, &stop);
+                if (stop == _p)
+                    fail(what);
+                _p = stop;
+                endToken(what);
+                return value;
+            }
+
+            /// A count or index in [0, limit).
+            int readIndex(const char* what, int limit)
+            {
+                int value = readInt(what);
+                if (value < 0 || value >= limit)
+                    error((boost::format("%s %d out of range (0-%d)") % what % value % (limit - 1)).str());
+                return value;
+            }
+
+            int readCount(const char* what)
+            {
+                int value = readInt(what);
+                if (value < 0)
+                    error((boost::format("negative %s %d") % what % value).str());
+                return value;
+            }
+
+            void error(const std::string& message) const
+            {
+                throw std::runtime_error((boost::format("%s(%d): %s") % _source % _line % message).str());
+            }
+
+        private:
+            void skipSpace()
+            {
+                while (_p != _end && (*_p == ' ' || *_p == '\t' || *_p == '\r' || *_p == '\n'))
+                {
+                    if (*_p == '\n')
+                        _line++;
+                    _p++;
+                }
+            }
+
+            void skipLine()
+            {
+                while (_p != _end && *_p != '\n')
+                    _p++;
+            }
+
+            /// Numbers must be followed by whitespace, eg. not "1.5" where an int is expected.
+            void endToken(const char* what)
+            {
+                if (_p != _end && *_p != ' ' && *_p != '\t' && *_p != '\r' && *_p != '\n')
+                    fail(what);
+            }
+
+            void fail(const char* what) const
+            {
+                if (_p == _end)
+                    error((boost::format("expected %s, found end of file") % what).str());
+
+                const char* stop = _p;
+                while (stop != _end && stop - _p < 16 && *stop != ' ' && *stop != '\t' && *stop != '\r' && *stop != '\n')
+                    stop++;
+                error((boost::format("expected %s, found '%s'") % what % std::string(_p, stop)).str());
+            }
+
+            const char*        _p;
+            const char*        _end;
+            int                _line;
+            const std::string& _source;
+    };
+
+    /// As Model::readDeformations()/Deformation::read(): a count, then per deformation an
+    /// optional "# name" line, the number of displaced vertices and "vertex x y z" for each.
+    void parseDeformations(WfmScanner& s, std::vector<Deformation>& dv, const char* defaultName, int nVertices)
+    {
+        s.skipComments();
+        int n = s.readInt("deformation count");
+        if (n <= 0)
+            return;
+
+        dv.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            std::string name;
+            if (s.atComment())
+            {
+                name = s.readLine();
+                size_t start = name.find_first_not_of(' ', 1);
+                name = (start != std::string::npos) ? name.substr(start) : std::string();
+                s.skipComments();
+            }
+            else
+            {
+                name = (boost::format("%s %d") % defaultName % i).str();
+            }
+
+            int FAPNo = 0;
+            if (name.compare(0, 3, "FAP") == 0)
+            {
+                FAPNo = atoi(name.substr(3, 4).c_str());
+            }
+
+            int nDisplacements = s.readCount("displacement count");
+            dv[i].init(nDisplacements, name, FAPNo);
+            for (int j = 0; j < nDisplacements; j++)
+            {
+                int v = s.readIndex("deformation vertex", nVertices);
+                double x = s.readDouble("displacement x");
+                double y = s.readDouble("displacement y");
+                double z = s.readDouble("displacement z");
+                dv[i].set(j, v, x, y, z);
+            }
+        }
+    }
+
+    void parseParams(WfmScanner& s, std::vector<double>& dv)
+    {
+        s.skipComments();
+        int nParamsInFile = s.readCount("parameter count");
+        for (int i = 0; i < nParamsInFile; i++)
+        {
+            int paramNo = s.readIndex("parameter", static_cast<int>(dv.size()));
+            dv[paramNo] = s.readDouble("parameter value");
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void
+Model::parse(const std::string& text, const std::string& source)
+{
+    WfmScanner s(text, source);
+	_texFilename = "";
+
+    // Vertices
+    s.skipComments();
+    int nVertices = s.readCount("vertex count");
+    _baseCoords.init(nVertices);
+    for (int i = 0; i < nVertices; i++)
+    {
+        double x = s.readDouble("vertex x");
+        double y = s.readDouble("vertex y");
+        double z = s.readDouble("vertex z");
+        _baseCoords[i].set(x, y, z);
+    }
+
+    // Each following section is optional, as with read(std::istream&)
+    s.skipComments();
+    if (!s.atEnd())
+    {
+        int nFaces = s.readCount("face count");
+        _faces.resize(nFaces);
+        for (int i = 0; i < nFaces; i++)
+        {
+            int a = s.readIndex("face vertex", nVertices);
+            int b = s.readIndex("face vertex", nVertices);
+            int c = s.readIndex("face vertex", nVertices);
+            _faces[i].set(a, b, c);
+        }
+    }
+
+    s.skipComments();
+    if (!s.atEnd())
+    {
+        parseDeformations(s, _dynamicDeformations, "Action Unit", nVertices);
+        indexDynamicDeformations();
+    }
+
+    s.skipComments();
+    if (!s.atEnd())
+    {
+        parseDeformations(s, _staticDeformations, "Shape Unit", nVertices);
+        indexStaticDeformations();
+    }
+
+    s.skipComments();
+    if (!s.atEnd())
+        parseParams(s, _dynamicParams);
+
+    s.skipComments();
+    if (!s.atEnd())
+        parseParams(s, _staticParams);
+
+    s.skipComments();
+    if (!s.atEnd())
+    {
+        int nCoordsInFile = s.readCount("texture coordinate count");
+        if (nCoordsInFile > 0)
+        {
+            _texCoords.resize(nCoordsInFile);
+            for (int i = 0; i < nCoordsInFile; i++)
+            {
+                int coordNo = s.readIndex("texture coordinate", nCoordsInFile);
+                double x = s.readDouble("texture u");
+                double y = s.readDouble("texture v");
+                _texCoords[coordNo].set(x, y);
+            }
+            _texFilename = s.readLine();
+        }
+    }
+
+    s.skipComments();
+    if (!s.atEnd())
+    {
+        double g[9];
+        for (int i = 0; i < 9; i++)
+            g[i] = s.readDouble("global motion");
+        _rotation.set(g[0], g[1], g[2]);
+        _scale.set(g[3], g[4], g[5]);
+        _translation.set(g[6], g[7], g[8]);
+    }
+
+	_staticParamsModified  = true;
+	_dynamicParamsModified = true;
+	updateGlobal();
+}
+
 //////////////////////////////////////////////////////////////////////
 
 bool
@@ -3,11 +3,21 @@
 
 #include "stdafx.h"
 #include "Application.h"
+#include "Benchmarks.h"
 
 
 int _tmain(int argc, _TCHAR* argv[])
 {
     try {
+        if (argc > 1 && std::wstring(argv[1]) == L"--benchmark") {
+            std::vector<std::string> names;
+            for (int i = 2; i < argc; i++) {
+                std::wstring name(argv[i]);
+                names.push_back(std::string(name.begin(), name.end()));
+            }
+            return Benchmarks::Run(names);
+        }
+
         Application app(argc, argv);
         return app.Main();
     }
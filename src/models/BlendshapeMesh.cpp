@@ -0,0 +1,312 @@
+#include "models\BlendshapeMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// OpenGL 1.3-2.0 entry points, which Windows' opengl32 doesn't export
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER                     0x8892
+#define GL_ELEMENT_ARRAY_BUFFER             0x8893
+#define GL_STATIC_DRAW                      0x88E4
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0                         0x84C0
+#define GL_TEXTURE1                         0x84C1
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE                    0x812F
+#endif
+#ifndef GL_RGBA32F
+#define GL_RGBA32F                          0x8814
+#endif
+#ifndef GL_CURRENT_PROGRAM
+#define GL_CURRENT_PROGRAM                  0x8B8D
+#define GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS   0x8B4C
+#endif
+
+namespace
+{
+    typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+    typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+    typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+    typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+    typedef void (APIENTRY *ActiveTextureProc)(GLenum texture);
+    typedef void (APIENTRY *ClientActiveTextureProc)(GLenum texture);
+    typedef GLint (APIENTRY *GetUniformLocationProc)(GLuint program, const char* name);
+    typedef void (APIENTRY *Uniform1iProc)(GLint location, GLint v0);
+    typedef void (APIENTRY *Uniform2fProc)(GLint location, GLfloat v0, GLfloat v1);
+    typedef void (APIENTRY *Uniform4fvProc)(GLint location, GLsizei count, const GLfloat* value);
+    typedef void (APIENTRY *UniformMatrix4fvProc)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+
+    GenBuffersProc          glGenBuffers_ = nullptr;
+    DeleteBuffersProc       glDeleteBuffers_ = nullptr;
+    BindBufferProc          glBindBuffer_ = nullptr;
+    BufferDataProc          glBufferData_ = nullptr;
+    ActiveTextureProc       glActiveTexture_ = nullptr;
+    ClientActiveTextureProc glClientActiveTexture_ = nullptr;
+    GetUniformLocationProc  glGetUniformLocation_ = nullptr;
+    Uniform1iProc           glUniform1i_ = nullptr;
+    Uniform2fProc           glUniform2f_ = nullptr;
+    Uniform4fvProc          glUniform4fv_ = nullptr;
+    UniformMatrix4fvProc    glUniformMatrix4fv_ = nullptr;
+
+    template<class T>
+    bool Load(T& proc, const char* name) {
+        proc = reinterpret_cast<T>(wglGetProcAddress(name));
+        return proc != nullptr;
+    }
+
+    // Vertex buffer layout: base position (3), texture coordinate (2), first displacement and count (2)
+    const int vertexFloats = 7;
+    const GLsizei vertexStride = vertexFloats * sizeof(float);
+
+    const int maxDisplacementWidth = 1024;
+
+    const void* Offset(int floats) {
+        return reinterpret_cast<const void*>(static_cast<size_t>(floats) * sizeof(float));
+    }
+}
+
+BlendshapeMesh::BlendshapeMesh() :
+    vertexBuffer(0),
+    indexBuffer(0),
+    displacementTexture(0),
+    displacementWidth(0),
+    displacementHeight(0),
+    indexCount(0),
+    coefficientCount(0)
+{
+}
+
+BlendshapeMesh::~BlendshapeMesh()
+{
+    Release();
+}
+
+bool BlendshapeMesh::Initialize(const eruFace::Model& model) {
+    Release();
+
+    bool loaded =
+        Load(glGenBuffers_, "glGenBuffers") &&
+        Load(glDeleteBuffers_, "glDeleteBuffers") &&
+        Load(glBindBuffer_, "glBindBuffer") &&
+        Load(glBufferData_, "glBufferData") &&
+        Load(glActiveTexture_, "glActiveTexture") &&
+        Load(glClientActiveTexture_, "glClientActiveTexture") &&
+        Load(glGetUniformLocation_, "glGetUniformLocation") &&
+        Load(glUniform1i_, "glUniform1i") &&
+        Load(glUniform2f_, "glUniform2f") &&
+        Load(glUniform4fv_, "glUniform4fv") &&
+        Load(glUniformMatrix4fv_, "glUniformMatrix4fv");
+    if (!loaded)
+        return false;
+
+    GLint vertexTextureUnits = 0;
+    glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &vertexTextureUnits);
+
+    int nVertices = model.nVertices();
+    int nStatic = model.nStaticDeformations();
+    int nDynamic = model.nDynamicDeformations();
+    if (vertexTextureUnits <= 0 || nVertices == 0 || nStatic + nDynamic > MaxDeformations)
+        return false;
+
+    // Sort the displacements by vertex (counting them first), so each vertex's are a single run
+    std::vector<int> first(nVertices + 1, 0);
+    for (int k = 0; k < nStatic + nDynamic; k++) {
+        const eruFace::Deformation& d = (k < nStatic) ? model.staticDeformation(k) : model.dynamicDeformation(k - nStatic);
+        for (int i = 0; i < d.nDisplacements(); i++) {
+            int v = d.vertexNo(i);
+            if (v >= 0 && v < nVertices)
+                first[v + 1]++;
+        }
+    }
+    for (int v = 0; v < nVertices; v++)
+        first[v + 1] += first[v];
+
+    int displacementCount = first[nVertices];
+    displacementWidth = (displacementCount < maxDisplacementWidth) ? ((displacementCount > 0) ? displacementCount : 1) : maxDisplacementWidth;
+    displacementHeight = (displacementCount + displacementWidth - 1) / displacementWidth;
+    displacementHeight = (displacementHeight > 0) ? displacementHeight : 1;
+
+    std::vector<float> displacements(static_cast<size_t>(displacementWidth) * displacementHeight * 4, 0.0f);
+    std::vector<int> next(first.begin(), first.end() - 1);
+    for (int k = 0; k < nStatic + nDynamic; k++) {
+        const eruFace::Deformation& d = (k < nStatic) ? model.staticDeformation(k) : model.dynamicDeformation(k - nStatic);
+        for (int i = 0; i < d.nDisplacements(); i++) {
+            int v = d.vertexNo(i);
+            if (v < 0 || v >= nVertices)
+                continue;
+
+            float* texel = &displacements[static_cast<size_t>(next[v]++) * 4];
+            texel[0] = static_cast<float>(k);
+            texel[1] = static_cast<float>(d[i][0]);
+            texel[2] = static_cast<float>(d[i][1]);
+            texel[3] = static_cast<float>(d[i][2]);
+        }
+    }
+
+    bool hasTexCoords = model.hasTexCoords();
+    std::vector<float> vertices(static_cast<size_t>(nVertices) * vertexFloats);
+    for (int v = 0; v < nVertices; v++) {
+        float* p = &vertices[static_cast<size_t>(v) * vertexFloats];
+        eruFace::Vertex base = model.baseCoord(v);
+        p[0] = static_cast<float>(base[0]);
+        p[1] = static_cast<float>(base[1]);
+        p[2] = static_cast<float>(base[2]);
+
+        eruFace::TexCoord uv = hasTexCoords ? model.texCoord(v) : eruFace::TexCoord(0.0, 0.0);
+        p[3] = static_cast<float>(uv[0]);
+        p[4] = static_cast<float>(uv[1]);
+
+        p[5] = static_cast<float>(first[v]);
+        p[6] = static_cast<float>(first[v + 1] - first[v]);
+    }
+
+    std::vector<GLuint> indices;
+    indices.reserve(model.nFaces() * 3);
+    for (int f = 0; f < model.nFaces(); f++) {
+        eruFace::Face face = model.face(f);
+        for (int i = 0; i < 3; i++)
+            indices.push_back(static_cast<GLuint>(face[i]));
+    }
+
+    // As Model::updateGlobal: scaled, rotated (as VertexSet::rotate), then translated
+    eruMath::Vector3d r, s, t;
+    model.getGlobal(r, s, t);
+    double R[3][3] = {
+        {  cos(r[2])*cos(r[1]), -sin(r[2])*cos(r[0])-cos(r[2])*sin(r[1])*sin(r[0]),  sin(r[2])*sin(r[0])-cos(r[2])*sin(r[1])*cos(r[0]) },
+        {  sin(r[2])*cos(r[1]),  cos(r[2])*cos(r[0])-sin(r[2])*sin(r[1])*sin(r[0]), -cos(r[2])*sin(r[0])-sin(r[2])*sin(r[1])*cos(r[0]) },
+        {  sin(r[1]),            cos(r[1])*sin(r[0]),                                 cos(r[1])*cos(r[0]) },
+    };
+    for (int col = 0; col < 3; col++) {
+        for (int row = 0; row < 3; row++)
+            modelTransform[col * 4 + row] = static_cast<float>(R[row][col] * s[col]);
+        modelTransform[col * 4 + 3] = 0.0f;
+    }
+    for (int row = 0; row < 3; row++)
+        modelTransform[12 + row] = static_cast<float>(t[row]);
+    modelTransform[15] = 1.0f;
+
+    // Upload everything once
+    while (glGetError() != GL_NO_ERROR) {}
+
+    glGenBuffers_(1, &vertexBuffer);
+    glBindBuffer_(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData_(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer_(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers_(1, &indexBuffer);
+    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData_(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+    indexCount = static_cast<int>(indices.size());
+
+    GLint previousTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+    glGenTextures(1, &displacementTexture);
+    glBindTexture(GL_TEXTURE_2D, displacementTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, displacementWidth, displacementHeight, 0, GL_RGBA, GL_FLOAT, displacements.data());
+    glBindTexture(GL_TEXTURE_2D, previousTexture);
+
+    // Eg. no float textures
+    if (glGetError() != GL_NO_ERROR) {
+        Release();
+        return false;
+    }
+
+    coefficientCount = nStatic + nDynamic;
+    packed.assign(MaxDeformations, 0.0f);
+    return true;
+}
+
+void BlendshapeMesh::Release() {
+    if (vertexBuffer != 0)
+        glDeleteBuffers_(1, &vertexBuffer);
+    if (indexBuffer != 0)
+        glDeleteBuffers_(1, &indexBuffer);
+    if (displacementTexture != 0)
+        glDeleteTextures(1, &displacementTexture);
+
+    vertexBuffer = 0;
+    indexBuffer = 0;
+    displacementTexture = 0;
+    indexCount = 0;
+    coefficientCount = 0;
+    programs.clear();
+}
+
+const BlendshapeMesh::ProgramUniforms& BlendshapeMesh::GetUniforms(GLint program) {
+    for (const ProgramUniforms& p : programs) {
+        if (p.program == program)
+            return p;
+    }
+
+    // First time with this program (it's current): look up the uniforms, and set the ones
+    // that don't change between frames, which the program keeps from now on
+    ProgramUniforms p;
+    p.program = program;
+    p.coefficients = glGetUniformLocation_(program, "coefficients");
+    glUniformMatrix4fv_(glGetUniformLocation_(program, "modelTransform"), 1, GL_FALSE, modelTransform);
+    glUniform2f_(glGetUniformLocation_(program, "displacementsSize"),
+        static_cast<float>(displacementWidth), static_cast<float>(displacementHeight));
+    glUniform1i_(glGetUniformLocation_(program, "displacements"), DisplacementUnit);
+
+    programs.push_back(p);
+    return programs.back();
+}
+
+void BlendshapeMesh::Draw(const std::vector<float>& coefficients) {
+    if (!IsAvailable())
+        return;
+
+    GLint program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    if (program == 0)
+        return;
+
+    // The only per frame upload (deformations without a coefficient are left out)
+    int n = (static_cast<int>(coefficients.size()) < coefficientCount) ? static_cast<int>(coefficients.size()) : coefficientCount;
+    std::fill(packed.begin(), packed.end(), 0.0f);
+    std::copy(coefficients.begin(), coefficients.begin() + n, packed.begin());
+
+    glUniform4fv_(GetUniforms(program).coefficients, MaxDeformations / 4, packed.data());
+
+    glActiveTexture_(GL_TEXTURE0 + DisplacementUnit);
+    glBindTexture(GL_TEXTURE_2D, displacementTexture);
+    glActiveTexture_(GL_TEXTURE0);
+
+    // SFML leaves its own (client memory) arrays enabled, so put them back afterwards
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+
+    glBindBuffer_(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, vertexStride, Offset(0));
+    glClientActiveTexture_(GL_TEXTURE0);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, vertexStride, Offset(3));
+    glClientActiveTexture_(GL_TEXTURE1);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, vertexStride, Offset(5));
+
+    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+
+    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer_(GL_ARRAY_BUFFER, 0);
+    glPopClientAttrib();
+
+    glActiveTexture_(GL_TEXTURE0 + DisplacementUnit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture_(GL_TEXTURE0);
+}
@@ -0,0 +1,966 @@
+// Generated by scripts/embed_wfm.py from resources/faces/candide3_textured.wfm. Do not edit.
+#include "models\Candide3Mesh.h"
+
+const float Candide3Mesh::BaseCoords[VertexCount * 3] = {
+    0.0f, 1.061f, -0.371f,
+    0.174f, 0.8f, -0.024f,
+    0.0f, 0.539f, 0.085f,
+    0.0f, 0.278f, 0.107f,
+    0.0f, 0.213f, 0.085f,
+    0.0f, -0.222f, 0.21f,
+    0.0f, -0.265f, 0.124f,
+    0.0f, -0.417f, 0.142f,
+    0.0f, -0.526f, 0.15f,
+    0.0f, -0.591f, 0.107f,
+    0.0f, -0.852f, 0.063f,
+    0.217f, 1.039f, -0.371f,
+    0.457f, 0.909f, -0.328f,
+    0.435f, 0.626f, -0.111f,
+    0.61f, 0.539f, -0.328f,
+    0.522f, 0.278f, -0.111f,
+    0.391f, 0.374f, 0.03f,
+    0.13f, 0.278f, 0.107f,
+    0.391f, 0.322f, 0.03f,
+    0.304f, 0.225f, -0.002f,
+    0.47f, 0.148f, -0.111f,
+    0.304f, 0.204f, 0.0f,
+    0.304f, 0.122f, 0.0f,
+    0.13f, 0.148f, 0.0f,
+    0.304f, 0.104f, 0.0f,
+    0.109f, -0.157f, 0.037f,
+    0.174f, -0.244f, 0.037f,
+    0.387f, -0.1f, -0.045f,
+    0.55f, -0.25f, -0.328f,
+    0.609f, 0.148f, -0.328f,
+    0.47f, -0.6f, -0.328f,
+    0.246f, -0.461f, 0.0f,
+    0.174f, -0.809f, 0.0f,
+    0.043f, -0.396f, 0.15f,
+    -0.174f, 0.8f, -0.024f,
+    0.0f, 0.539f, 0.085f,
+    0.0f, 0.278f, 0.107f,
+    0.0f, 0.213f, 0.085f,
+    0.0f, -0.222f, 0.21f,
+    0.0f, -0.265f, 0.124f,
+    0.0f, -0.461f, 0.124f,
+    0.0f, -0.526f, 0.15f,
+    0.0f, -0.591f, 0.107f,
+    0.0f, -0.852f, 0.063f,
+    -0.217f, 1.039f, -0.371f,
+    -0.457f, 0.909f, -0.328f,
+    -0.435f, 0.626f, -0.111f,
+    -0.61f, 0.539f, -0.328f,
+    -0.522f, 0.278f, -0.111f,
+    -0.391f, 0.374f, 0.03f,
+    -0.13f, 0.278f, 0.107f,
+    -0.391f, 0.322f, 0.03f,
+    -0.304f, 0.225f, -0.002f,
+    -0.47f, 0.148f, -0.111f,
+    -0.304f, 0.204f, 0.0f,
+    -0.304f, 0.122f, 0.0f,
+    -0.13f, 0.148f, 0.0f,
+    -0.304f, 0.104f, 0.0f,
+    -0.109f, -0.157f, 0.037f,
+    -0.174f, -0.244f, 0.037f,
+    -0.387f, -0.1f, -0.045f,
+    -0.55f, -0.25f, -0.328f,
+    -0.609f, 0.148f, -0.328f,
+    -0.47f, -0.6f, -0.328f,
+    -0.246f, -0.461f, 0.0f,
+    -0.174f, -0.809f, 0.0f,
+    -0.043f, -0.396f, 0.15f,
+    0.348f, 0.2f, -0.03f,
+    0.348f, 0.115f, -0.03f,
+    -0.348f, 0.2f, -0.03f,
+    -0.348f, 0.115f, -0.03f,
+    0.265f, 0.2f, -0.03f,
+    0.265f, 0.115f, -0.03f,
+    -0.265f, 0.2f, -0.03f,
+    -0.265f, 0.115f, -0.03f,
+    0.08f, -0.22f, 0.15f,
+    -0.08f, -0.22f, 0.15f,
+    0.022f, 0.213f, 0.063f,
+    -0.022f, 0.213f, 0.063f,
+    0.123f, -0.41f, 0.063f,
+    -0.123f, -0.41f, 0.063f,
+    0.1f, -0.461f, 0.05f,
+    -0.1f, -0.461f, 0.05f,
+    0.1f, -0.461f, 0.05f,
+    -0.1f, -0.461f, 0.05f,
+    0.123f, -0.508f, 0.063f,
+    -0.123f, -0.508f, 0.063f,
+    0.0f, -0.461f, 0.124f,
+    0.2f, -0.461f, -0.024f,
+    -0.2f, -0.461f, -0.024f,
+    0.357f, -0.461f, -0.05f,
+    -0.357f, -0.461f, -0.05f,
+    0.065f, 0.028f, 0.05f,
+    -0.065f, 0.028f, 0.05f,
+    0.0f, 0.068f, 0.1f,
+    0.387f, 0.201f, -0.056f,
+    -0.387f, 0.201f, -0.056f,
+    0.387f, 0.186f, -0.056f,
+    -0.387f, 0.186f, -0.056f,
+    0.387f, 0.126f, -0.056f,
+    -0.387f, 0.126f, -0.056f,
+    0.387f, 0.117f, -0.067f,
+    -0.387f, 0.117f, -0.067f,
+    0.217f, 0.201f, -0.013f,
+    -0.217f, 0.201f, -0.013f,
+    0.217f, 0.186f, -0.013f,
+    -0.217f, 0.186f, -0.013f,
+    0.217f, 0.126f, -0.013f,
+    -0.217f, 0.126f, -0.013f,
+    0.217f, 0.117f, -0.024f,
+    -0.217f, 0.117f, -0.024f,
+    0.12f, -0.265f, 0.1f,
+    -0.12f, -0.265f, 0.1f,
+};
+
+const int Candide3Mesh::Faces[FaceCount * 3] = {
+    0, 11, 1,
+    0, 1, 34,
+    0, 34, 44,
+    11, 12, 1,
+    44, 34, 45,
+    1, 12, 13,
+    1, 13, 2,
+    1, 2, 34,
+    2, 46, 34,
+    34, 46, 45,
+    12, 14, 13,
+    13, 14, 15,
+    13, 15, 16,
+    2, 13, 16,
+    2, 16, 17,
+    2, 17, 3,
+    2, 3, 50,
+    2, 50, 49,
+    2, 49, 46,
+    46, 49, 48,
+    46, 48, 47,
+    45, 46, 47,
+    14, 29, 15,
+    15, 29, 20,
+    18, 15, 19,
+    18, 16, 15,
+    16, 18, 17,
+    17, 18, 19,
+    17, 23, 77,
+    3, 17, 77,
+    3, 78, 50,
+    78, 56, 50,
+    50, 52, 51,
+    49, 50, 51,
+    48, 49, 51,
+    48, 51, 52,
+    48, 53, 62,
+    47, 48, 62,
+    29, 28, 27,
+    20, 29, 27,
+    24, 26, 25,
+    57, 58, 59,
+    53, 60, 62,
+    62, 60, 61,
+    111, 26, 33,
+    75, 26, 111,
+    75, 25, 26,
+    76, 59, 58,
+    76, 112, 59,
+    112, 66, 59,
+    6, 33, 7,
+    6, 7, 66,
+    9, 32, 10,
+    9, 10, 65,
+    6, 76, 5,
+    6, 5, 75,
+    3, 77, 78,
+    7, 33, 79,
+    7, 79, 81,
+    7, 81, 87,
+    7, 80, 66,
+    7, 82, 80,
+    7, 87, 82,
+    80, 82, 89,
+    80, 89, 64,
+    79, 88, 81,
+    79, 31, 88,
+    26, 79, 33,
+    26, 31, 79,
+    59, 66, 80,
+    59, 80, 64,
+    88, 83, 85,
+    88, 85, 31,
+    83, 8, 85,
+    83, 40, 8,
+    8, 40, 84,
+    8, 84, 86,
+    86, 89, 84,
+    86, 64, 89,
+    9, 85, 8,
+    9, 8, 86,
+    32, 85, 31,
+    32, 9, 85,
+    65, 86, 64,
+    65, 9, 86,
+    27, 26, 24,
+    90, 30, 32,
+    90, 32, 31,
+    90, 30, 28,
+    90, 26, 31,
+    90, 27, 26,
+    90, 28, 27,
+    60, 59, 57,
+    91, 65, 63,
+    91, 64, 65,
+    91, 61, 63,
+    91, 64, 59,
+    91, 59, 60,
+    91, 60, 61,
+    92, 77, 23,
+    92, 23, 25,
+    92, 25, 75,
+    93, 56, 78,
+    93, 76, 58,
+    93, 58, 56,
+    94, 77, 92,
+    94, 92, 75,
+    94, 75, 5,
+    94, 5, 76,
+    94, 76, 93,
+    94, 93, 78,
+    94, 78, 77,
+    20, 95, 15,
+    20, 97, 95,
+    20, 101, 99,
+    20, 27, 101,
+    95, 19, 15,
+    95, 21, 19,
+    95, 97, 21,
+    101, 27, 24,
+    101, 24, 22,
+    101, 22, 99,
+    23, 103, 17,
+    23, 105, 103,
+    23, 109, 107,
+    23, 25, 109,
+    103, 17, 19,
+    103, 19, 21,
+    103, 21, 105,
+    109, 107, 22,
+    109, 22, 24,
+    109, 24, 25,
+    56, 104, 50,
+    56, 106, 104,
+    56, 110, 108,
+    56, 58, 110,
+    104, 52, 50,
+    104, 54, 52,
+    104, 106, 54,
+    110, 55, 108,
+    110, 57, 55,
+    110, 58, 57,
+    53, 48, 96,
+    53, 98, 96,
+    53, 100, 102,
+    53, 102, 60,
+    96, 48, 52,
+    96, 52, 54,
+    96, 54, 98,
+    102, 100, 55,
+    102, 55, 57,
+    102, 57, 60,
+    111, 6, 75,
+    111, 33, 6,
+    112, 76, 6,
+    112, 6, 66,
+    73, 74, 70,
+    73, 70, 69,
+    67, 68, 72,
+    67, 72, 71,
+    53, 69, 70,
+    56, 74, 73,
+    23, 71, 72,
+    20, 68, 67,
+    98, 69, 53,
+    54, 69, 98,
+    54, 73, 69,
+    54, 106, 73,
+    106, 56, 73,
+    56, 108, 74,
+    55, 74, 108,
+    55, 70, 74,
+    55, 100, 70,
+    100, 53, 70,
+    20, 67, 97,
+    97, 67, 21,
+    21, 67, 71,
+    21, 71, 105,
+    105, 71, 23,
+    20, 99, 68,
+    68, 99, 22,
+    22, 72, 68,
+    22, 107, 72,
+    107, 23, 72,
+};
+
+// 0: AUV0   Upper lip raiser (AU10)
+// 1: AUV11 Jaw drop (AU26/27)
+// 2: AUV2   Lip stretcher (AU20)
+// 3: AUV3   Brow lowerer (AU4)
+// 4: AUV14 Lip corner depressor (AU13/15)
+// 5: AUV5   Outer brow raiser (AU2)
+// 6: AUV6   Eyes closed (AU42/43/44/45)
+// 7: AUV7   Lid tightener (AU7)
+// 8: AUV8   Nose wrinkler (AU9)
+// 9: AUV9   Lip presser (AU23/24)
+// 10: AUV10 Upper lid raiser (AU5)
+// 11: FAP 3 open_jaw
+// 12: FAP 4 lower_t_midlip
+// 13: FAP 5 raise_b_midlip
+// 14: FAP 6 stretch_l_cornerlip
+// 15: FAP 7 stretch_r_cornerlip
+// 16: FAP 8 lower_t_lip_lm
+// 17: FAP 9 lower_t_lip_rm
+// 18: FAP10 raise_b_lip_lm
+// 19: FAP11 raise_b_lip_rm
+// 20: FAP12 raise_l_cornerlip
+// 21: FAP13 raise_r_cornerlip
+// 22: FAP14 thrust_jaw
+// 23: FAP15 shift_jaw
+// 24: FAP16 push_b_lip
+// 25: FAP17 push_t_lip
+// 26: FAP18 depress_chin
+// 27: FAP19 close_t_l_eyelid
+// 28: FAP20 close_t_r_eyelid
+// 29: FAP21 close_b_l_eyelid
+// 30: FAP22 close_b_r_eyelid
+// 31: FAP23 yaw_l_eyeball
+// 32: FAP24 yaw_r_eyeball
+// 33: FAP25 pitch_l_eyeball
+// 34: FAP26 pitch_r_eyeball
+// 35: FAP27 thrust_l_eyeball
+// 36: FAP28 thrust_r_eyeball
+// 37: FAP29 dilate_l_pupil
+// 38: FAP30 dilate_r_pupil
+// 39: FAP31 raise_l_i_eyebrow
+// 40: FAP32 raise_r_i_eyebrow
+// 41: FAP33 raise_l_m_eyebrow
+// 42: FAP34 raise_r_m_eyebrow
+// 43: FAP35 raise_l_o_eyebrow
+// 44: FAP36 raise_r_o_eyebrow
+// 45: FAP37 squeeze_l_eyebrow
+// 46: FAP38 squeeze_r_eyebrow
+// 47: FAP39 puff_l_cheek
+// 48: FAP40 puff_r_cheek
+// 49: FAP41 lift_l_cheek
+// 50: FAP42 lift_r_cheek
+// 51: FAP51 lower_t_midlip_o
+// 52: FAP52 raise_b_midlip_o
+// 53: FAP53 stretch_l_cornerlip_o
+// 54: FAP54 stretch_r_cornerlip_o
+// 55: FAP55 lower_t_lip_lm_o
+// 56: FAP56 lower_t_lip_rm_o
+// 57: FAP57 raise_b_lip_lm_o
+// 58: FAP58 raise_b_lip_rm_o
+// 59: FAP59 raise_l_cornerlip_o
+// 60: FAP60 raise_r_cornerlip_o
+// 61: FAP61 strecth_l_nose
+// 62: FAP62 strecth_r_nose
+// 63: FAP63 raise_nose
+// 64: FAP64 bend_nose
+const int Candide3Mesh::DynamicDeformation[DynamicDisplacementCount] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9,
+    9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 22, 22, 23, 23, 23, 24, 24, 24, 24,
+    24, 24, 25, 25, 25, 25, 25, 25, 25, 25, 26, 27, 27, 27, 28, 28,
+    28, 29, 29, 29, 30, 30, 30, 31, 31, 31, 31, 32, 32, 32, 32, 33,
+    33, 33, 33, 34, 34, 34, 34, 35, 35, 35, 35, 36, 36, 36, 36, 37,
+    37, 37, 37, 38, 38, 38, 38, 39, 40, 41, 41, 42, 42, 43, 44, 45,
+    45, 45, 46, 46, 46, 47, 48, 49, 50, 51, 51, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 61, 61, 62, 62, 62, 63, 63, 63, 64, 64,
+    64,
+};
+
+const int Candide3Mesh::DynamicVertex[DynamicDisplacementCount] = {
+    7, 33, 66, 79, 80, 81, 82, 87, 88, 89, 40, 8, 9, 10, 32, 65,
+    83, 84, 85, 86, 88, 89, 31, 8, 33, 7, 64, 66, 79, 80, 81, 82,
+    83, 84, 85, 86, 88, 89, 90, 91, 17, 16, 18, 15, 50, 49, 51, 48,
+    21, 54, 67, 69, 71, 73, 31, 64, 88, 89, 79, 80, 81, 82, 83, 84,
+    85, 86, 90, 91, 15, 16, 17, 18, 48, 49, 50, 51, 21, 22, 54, 55,
+    97, 98, 99, 100, 105, 106, 107, 108, 21, 22, 54, 55, 97, 98, 99, 100,
+    105, 106, 107, 108, 2, 3, 5, 26, 25, 24, 22, 59, 58, 57, 55, 68,
+    70, 72, 74, 99, 100, 101, 102, 107, 108, 109, 110, 8, 33, 66, 7, 79,
+    80, 85, 86, 21, 54, 97, 98, 105, 106, 10, 32, 65, 87, 40, 88, 89,
+    81, 82, 83, 84, 88, 89, 10, 32, 65, 10, 32, 65, 8, 40, 83, 84,
+    85, 86, 7, 33, 87, 66, 79, 80, 81, 82, 9, 21, 97, 105, 54, 98,
+    106, 22, 99, 107, 55, 100, 108, 67, 68, 71, 72, 69, 70, 73, 74, 67,
+    68, 71, 72, 69, 70, 73, 74, 67, 68, 71, 72, 69, 70, 73, 74, 67,
+    68, 71, 72, 69, 70, 73, 74, 17, 50, 16, 18, 49, 51, 15, 48, 17,
+    16, 18, 50, 49, 51, 90, 91, 27, 60, 7, 33, 66, 8, 31, 64, 79,
+    80, 85, 86, 31, 64, 26, 111, 25, 59, 112, 58, 5, 75, 76, 5, 75,
+    76,
+};
+
+const float Candide3Mesh::DynamicDisplacement[DynamicDisplacementCount * 3] = {
+    0.0f, 0.086957f, 0.021739f,
+    0.0f, 0.065217f, 0.021739f,
+    0.0f, 0.065217f, 0.021739f,
+    0.0f, 0.05f, 0.021739f,
+    0.0f, 0.05f, 0.021739f,
+    0.0f, 0.05f, 0.021739f,
+    0.0f, 0.05f, 0.021739f,
+    0.0f, 0.065217f, 0.021739f,
+    0.0f, 0.02f, 0.0f,
+    0.0f, 0.02f, 0.0f,
+    0.0f, -0.26f, -0.05f,
+    0.0f, -0.26f, -0.05f,
+    0.0f, -0.26f, -0.1f,
+    0.0f, -0.13f, -0.15f,
+    0.0f, -0.15f, -0.13f,
+    0.0f, -0.15f, -0.13f,
+    0.0f, -0.2f, -0.05f,
+    0.0f, -0.2f, -0.05f,
+    0.0f, -0.2f, -0.05f,
+    0.0f, -0.2f, -0.05f,
+    0.0f, -0.02f, 0.0f,
+    0.0f, -0.02f, 0.0f,
+    0.09f, 0.0f, -0.09f,
+    0.0f, 0.0325f, -0.017391f,
+    0.0f, -0.022f, -0.0255f,
+    0.0f, -0.022f, -0.01f,
+    -0.09f, 0.0f, -0.09f,
+    0.0f, -0.022f, -0.0255f,
+    0.045f, -0.02f, -0.02f,
+    -0.045f, -0.02f, -0.02f,
+    0.04f, 0.0f, -0.02f,
+    -0.04f, 0.0f, -0.02f,
+    0.04f, 0.0f, -0.02f,
+    -0.04f, 0.0f, -0.02f,
+    0.045f, 0.023f, -0.02f,
+    -0.045f, 0.023f, -0.02f,
+    0.08f, 0.0f, -0.08f,
+    -0.08f, 0.0f, -0.08f,
+    0.04f, 0.0f, -0.04f,
+    -0.04f, 0.0f, -0.04f,
+    -0.130435f, -0.130435f, 0.0f,
+    -0.086957f, -0.130435f, 0.017391f,
+    -0.086957f, -0.130435f, 0.017391f,
+    0.0f, -0.065217f, 0.0f,
+    0.130435f, -0.130435f, 0.0f,
+    0.086957f, -0.130435f, 0.017391f,
+    0.086957f, -0.130435f, 0.017391f,
+    0.0f, -0.065217f, 0.0f,
+    0.0f, -0.034783f, 0.0f,
+    0.0f, -0.034783f, 0.0f,
+    0.0f, -0.026087f, 0.0f,
+    0.0f, -0.026087f, 0.0f,
+    0.0f, -0.026087f, 0.0f,
+    0.0f, -0.026087f, 0.0f,
+    0.0f, -0.14f, -0.01f,
+    0.0f, -0.14f, -0.01f,
+    0.0f, -0.1f, -0.008f,
+    0.0f, -0.1f, -0.008f,
+    0.0f, -0.03f, -0.02f,
+    0.0f, -0.03f, -0.02f,
+    0.0f, -0.03f, -0.02f,
+    0.0f, -0.03f, -0.02f,
+    0.0f, -0.03f, -0.02f,
+    0.0f, -0.03f, -0.02f,
+    0.0f, -0.04f, -0.02f,
+    0.0f, -0.04f, -0.02f,
+    0.0f, -0.04f, 0.0f,
+    0.0f, -0.04f, 0.0f,
+    0.021739f, 0.173913f, -0.021739f,
+    0.0f, 0.152174f, -0.021739f,
+    0.0f, 0.021739f, 0.0f,
+    0.0f, 0.152174f, -0.021739f,
+    -0.021739f, 0.173913f, -0.021739f,
+    0.0f, 0.152174f, -0.021739f,
+    0.0f, 0.021739f, 0.0f,
+    0.0f, 0.152174f, -0.021739f,
+    0.0f, -0.062f, 0.01f,
+    0.0f, 0.02f, 0.01f,
+    0.0f, -0.062f, 0.01f,
+    0.0f, 0.02f, 0.01f,
+    0.0f, -0.045f, 0.007f,
+    0.0f, -0.045f, 0.007f,
+    0.0f, 0.015f, 0.007f,
+    0.0f, 0.015f, 0.007f,
+    0.0f, -0.045f, 0.007f,
+    0.0f, -0.045f, 0.007f,
+    0.0f, 0.015f, 0.007f,
+    0.0f, 0.015f, 0.007f,
+    0.0f, -0.056f, 0.01f,
+    0.0f, 0.026f, 0.01f,
+    0.0f, -0.056f, 0.01f,
+    0.0f, 0.026f, 0.01f,
+    0.0f, -0.038f, 0.007f,
+    0.0f, -0.038f, 0.007f,
+    0.0f, 0.022f, 0.007f,
+    0.0f, 0.022f, 0.007f,
+    0.0f, -0.038f, 0.007f,
+    0.0f, -0.038f, 0.007f,
+    0.0f, 0.022f, 0.007f,
+    0.0f, 0.022f, 0.007f,
+    0.0f, -0.086957f, 0.013043f,
+    0.0f, -0.043478f, 0.0f,
+    0.0f, 0.086957f, 0.0f,
+    0.0f, 0.043478f, -0.017391f,
+    0.0f, 0.043478f, -0.008696f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.043478f, -0.017391f,
+    0.0f, 0.043478f, -0.008696f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.008696f, 0.0f,
+    0.0f, 0.008696f, 0.0f,
+    0.0f, 0.008696f, 0.0f,
+    0.0f, 0.008696f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.017391f, 0.0f,
+    0.0f, 0.0325f, 0.0f,
+    0.0f, -0.02f, 0.0f,
+    0.0f, -0.02f, 0.0f,
+    0.0f, -0.021f, 0.0f,
+    0.0f, -0.02f, 0.0f,
+    0.0f, -0.02f, 0.0f,
+    0.0f, 0.023f, 0.0f,
+    0.0f, 0.023f, 0.0f,
+    0.0f, 0.03f, -0.01f,
+    0.0f, 0.03f, -0.01f,
+    0.0f, 0.015f, -0.007f,
+    0.0f, 0.015f, -0.007f,
+    0.0f, 0.015f, -0.007f,
+    0.0f, 0.015f, -0.007f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    -1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, 0.0f, 0.5f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.1f,
+    0.0f, -0.75f, 0.075f,
+    0.0f, -0.75f, 0.075f,
+    0.0f, -1.0f, 0.1f,
+    0.0f, -0.75f, 0.075f,
+    0.0f, -0.75f, 0.075f,
+    0.0f, 1.0f, 0.1f,
+    0.0f, 0.75f, 0.075f,
+    0.0f, 0.75f, 0.075f,
+    0.0f, 1.0f, 0.1f,
+    0.0f, 0.75f, 0.075f,
+    0.0f, 0.75f, 0.075f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    0.0f, 0.0f, 1.0f,
+    1.0f, 1.0f, 0.0f,
+    1.0f, -1.0f, 0.0f,
+    -1.0f, 1.0f, 0.0f,
+    -1.0f, -1.0f, 0.0f,
+    -1.0f, 1.0f, 0.0f,
+    -1.0f, -1.0f, 0.0f,
+    1.0f, 1.0f, 0.0f,
+    1.0f, -1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    -0.5f, 0.0f, 0.0f,
+    -0.5f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    0.5f, 0.0f, 0.0f,
+    0.5f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, -1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    0.5f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    -0.5f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    0.0f, 1.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+    -1.0f, 0.0f, 0.0f,
+};
+
+// 0: Head height
+// 1: Eyebrows vertical position
+// 2: Eyes vertical position
+// 3: Eyes, width
+// 4: Eyes, height
+// 5: Eye separation distance
+// 6: Cheeks z
+// 7: Nose z-extension
+// 8: Nose vertical position
+// 9: Nose, pointing up
+// 10: Mouth vertical position
+// 11: Mouth width
+// 12: Eyes vertical difference
+// 13: Chin width
+const int Candide3Mesh::StaticDeformation[StaticDisplacementCount] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 7, 7,
+    7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+    8, 8, 8, 8, 8, 9, 9, 9, 10, 10, 10, 10, 10, 10, 10, 10,
+    10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11,
+    11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 13,
+    13,
+};
+
+const int Candide3Mesh::StaticVertex[StaticDisplacementCount] = {
+    0, 1, 11, 12, 13, 14, 34, 44, 45, 46, 47, 10, 30, 63, 32, 65,
+    15, 16, 17, 18, 48, 49, 50, 51, 19, 20, 21, 22, 23, 24, 52, 53,
+    54, 55, 56, 57, 67, 68, 69, 70, 71, 72, 73, 74, 95, 96, 97, 98,
+    99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 20, 95, 97, 99,
+    101, 103, 105, 107, 109, 23, 53, 96, 98, 100, 102, 104, 106, 108, 110, 56,
+    19, 21, 22, 24, 52, 54, 55, 57, 95, 96, 103, 104, 101, 102, 109, 110,
+    97, 98, 105, 106, 99, 100, 107, 108, 19, 20, 21, 22, 23, 24, 52, 53,
+    54, 55, 56, 57, 67, 68, 69, 70, 71, 72, 73, 74, 95, 96, 97, 98,
+    99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 27, 60, 5, 75,
+    76, 92, 93, 94, 3, 4, 5, 6, 25, 26, 58, 59, 75, 76, 77, 78,
+    92, 93, 94, 111, 112, 5, 75, 76, 7, 8, 9, 31, 33, 40, 64, 66,
+    79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 31, 64, 88,
+    89, 79, 80, 81, 82, 83, 84, 85, 86, 90, 91, 19, 20, 21, 22, 23,
+    24, 52, 53, 54, 55, 56, 57, 67, 68, 69, 70, 71, 72, 73, 74, 95,
+    96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 30,
+    63,
+};
+
+const float Candide3Mesh::StaticDisplacement[StaticDisplacementCount * 3] = {
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, 0.2f, 0.0f,
+    0.0f, -0.2f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.2f, 0.0f,
+    0.0f, -0.2f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.05f, 0.0f,
+    0.0f, -0.05f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.05f, 0.0f,
+    0.0f, -0.05f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.07f, 0.0f,
+    0.0f, 0.07f, 0.0f,
+    0.0f, 0.07f, 0.0f,
+    0.0f, 0.07f, 0.0f,
+    0.0f, -0.07f, 0.0f,
+    0.0f, -0.07f, 0.0f,
+    0.0f, -0.07f, 0.0f,
+    0.0f, -0.07f, 0.0f,
+    0.0f, 0.035f, 0.0f,
+    0.0f, 0.035f, 0.0f,
+    0.0f, 0.035f, 0.0f,
+    0.0f, 0.035f, 0.0f,
+    0.0f, -0.035f, 0.0f,
+    0.0f, -0.035f, 0.0f,
+    0.0f, -0.035f, 0.0f,
+    0.0f, -0.035f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.0f, 0.0f, 0.1f,
+    0.0f, 0.0f, 0.1f,
+    0.0f, 0.0f, 0.1f,
+    0.0f, 0.0f, 0.07f,
+    0.0f, 0.0f, 0.07f,
+    0.0f, 0.0f, 0.05f,
+    0.0f, 0.0f, 0.05f,
+    0.0f, 0.0f, 0.05f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.05f, 0.0f,
+    0.0f, 0.05f, 0.0f,
+    0.0f, 0.05f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    0.05f, 0.0f, 0.0f,
+    -0.05f, 0.0f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.0f, -0.1f, 0.0f,
+    0.0f, 0.1f, 0.0f,
+    0.1f, 0.0f, 0.0f,
+    -0.1f, 0.0f, 0.0f,
+};
@@ -1,5 +1,6 @@
 
 #include <vector>
+#include <iostream>
 #include <boost\format.hpp>
 #include "FaceTracker.h"
 #include "models\CustomFaceModel.h"
@@ -33,7 +34,15 @@ static const string kinect_au_map[NUM_KINECT_AU] = {
     "auv5   outer brow raiser (au2)",
 };
 
-CustomFaceModel::CustomFaceModel() : FaceModel()
+CustomFaceModel::CustomFaceModel() : FaceModel(),
+pModel(nullptr),
+pFaceTracker(nullptr),
+hasModel(false),
+shapeUnitsVersion(0),
+appliedShapeUnitsVersion(0),
+shapeUnitsApplied(true),
+useCandide3(false),
+detailVertexCount(0)
 {
 }
 
@@ -44,16 +53,59 @@ CustomFaceModel::~CustomFaceModel()
 
 bool CustomFaceModel::LoadMesh(std::string filename) {
     // Load the face mesh from a .wfm file (eg. candide3.wfm)
-    if (!mesh.read(filename))
+    shared_ptr<FaceAsset> face(new FaceAsset());
+    face->filename = filename;
+    if (!face->mesh.read(filename))
         return false;
 
     // Load the texture if defined
-    if (!mesh._texFilename.empty()) {
-        if (!texture.loadFromFile(mesh._texFilename)) {
-            throw runtime_error((boost::format("Error loading face mesh texture '%s'") % mesh._texFilename).str());
+    if (!face->mesh._texFilename.empty()) {
+        if (!face->faceTexture.Load(face->mesh._texFilename, textureCacheDirectory) || !face->faceTexture.Upload(face->texture)) {
+            throw runtime_error((boost::format("Error loading face mesh texture '%s'") % face->mesh._texFilename).str());
         }
+        face->uploaded = true;
     }
 
+    return LoadMesh(face);
+}
+
+bool CustomFaceModel::LoadMesh(std::shared_ptr<const FaceAsset> face) {
+    if (!face || !face->mesh.valid())
+        return false;
+
+    mesh.copyAll(face->mesh);
+    loadedFace = face;
+
+    MapParameters();
+    return true;
+}
+
+bool CustomFaceModel::CanDrive(const eruFace::Model& face) {
+    try {
+        for (int i = 0; i < NUM_KINECT_SU; i++) {
+            if (!kinect_su_map[i].empty())
+                face.staticDeformationIndex(kinect_su_map[i]);
+        }
+        for (int i = 0; i < NUM_KINECT_AU; i++) {
+            if (!kinect_au_map[i].empty())
+                face.dynamicDeformationIndex(kinect_au_map[i]);
+        }
+    }
+    catch (exception&) {
+        return false;
+    }
+    return true;
+}
+
+void CustomFaceModel::SetFace(const eruFace::Model& face) {
+    mesh.copyAll(face);
+    MapParameters();
+
+    // The face's own static parameters are in effect until the tracked SUs are applied to it
+    shapeUnitsApplied = false;
+}
+
+void CustomFaceModel::MapParameters() {
     // Look up kinect to wfm parameter mappings and store for later use
     su_map.clear();
     for (int i = 0; i < NUM_KINECT_SU; i++) {
@@ -78,6 +130,76 @@ bool CustomFaceModel::LoadMesh(std::string filename) {
         }
     }
 
+    // Deform with the compiled in tables if this is the mesh they were generated from
+    useCandide3 = FixedFaceKernel<Candide3Mesh>::Matches(mesh);
+    if (useCandide3)
+        candide3.UpdateStatic(mesh);
+}
+
+bool CustomFaceModel::LoadDetailMesh(std::string filename) {
+    if (!mesh.valid() || !detailMesh.read(filename))
+        return false;
+    subdivision.Clear();
+
+    // The texture is only needed on the GPU, so the preprocessed copy goes once it's uploaded
+    FaceTexture detailFaceTexture;
+    if (!detailMesh._texFilename.empty()) {
+        if (!detailFaceTexture.Load(detailMesh._texFilename, textureCacheDirectory) || !detailFaceTexture.Upload(detailTexture))
+            throw runtime_error((boost::format("Error loading detail mesh texture '%s'") % detailMesh._texFilename).str());
+    }
+    else if (!GetFaceTexture().Upload(detailTexture)) {
+        return false;
+    }
+
+    // Both meshes as loaded (at rest), in the space Deform() returns vertices in
+    vector<float> source(mesh.nVertices() * 3), target(detailMesh.nVertices() * 3);
+    for (int i = 0; i < mesh.nVertices(); i++) {
+        auto vertex = mesh.vertex(i);
+        for (int j = 0; j < 3; j++)
+            source[i * 3 + j] = static_cast<float>(vertex[j]);
+    }
+    for (int i = 0; i < detailMesh.nVertices(); i++) {
+        auto vertex = detailMesh.vertex(i);
+        for (int j = 0; j < 3; j++)
+            target[i * 3 + j] = static_cast<float>(vertex[j]);
+    }
+    transfer.Bind(source, target);
+    detailVertexCount = detailMesh.nVertices();
+
+    // The faces and texture coordinates are fixed, so lay them out for vertex arrays once
+    detailTexCoords.clear();
+    if (detailMesh.hasTexCoords()) {
+        detailTexCoords.resize(detailMesh.nVertices() * 2);
+        for (int i = 0; i < detailMesh.nVertices(); i++) {
+            auto uv = detailMesh.texCoord(i);
+            detailTexCoords[i * 2 + 0] = static_cast<float>(uv[0]);
+            detailTexCoords[i * 2 + 1] = static_cast<float>(uv[1]);
+        }
+    }
+
+    detailIndices.resize(detailMesh.nFaces() * 3);
+    for (int f = 0; f < detailMesh.nFaces(); f++) {
+        auto face = detailMesh.face(f);
+        for (int v = 0; v < 3; v++)
+            detailIndices[f * 3 + v] = static_cast<GLuint>(face[v]);
+    }
+
+    return transfer.IsBound();
+}
+
+bool CustomFaceModel::SubdivideMesh(int levels) {
+    transfer.Clear();
+    if (!mesh.valid() || !subdivision.Build(mesh, levels))
+        return false;
+
+    if (!GetFaceTexture().Upload(detailTexture))
+        return false;
+    detailVertexCount = subdivision.GetVertexCount();
+    detailTexCoords = subdivision.GetTexCoords();
+
+    const vector<int>& faces = subdivision.GetFaces();
+    detailIndices.assign(faces.begin(), faces.end());
+
     return true;
 }
 
@@ -89,33 +211,34 @@ void CustomFaceModel::Initialize(IFTFaceTracker* pFaceTracker) {
         throw ft_error("Error initializing face model", hr);
 }
 
-void CustomFaceModel::UpdateModel(IFTResult* pFTResult, FT_CAMERA_CONFIG* pCameraConfig) {
+void CustomFaceModel::UpdateParameters(IFTResult* pFTResult) {
     HRESULT hr;
-    hasModel = false;
 
     if (pModel == nullptr)
         throw std::runtime_error("Face model not initialized");
 
     // Get face shape units (SUs)
-    float headScale;
-    FLOAT *pSUCoefs;
-    UINT suCount;
-    BOOL haveConverged;
-    if (FAILED(hr = pFaceTracker->GetShapeUnits(&headScale, &pSUCoefs, &suCount, &haveConverged)))
-        throw ft_error("Error getting head SUs", hr);
-    shapeUnits = vector<float>(pSUCoefs, pSUCoefs + suCount);
-
-    // Use the AUs and SUs to deform the original mesh
-    int nSD = mesh.nStaticDeformations();
-    if (nSD > 0) {
-        for (int i = 0; i < suCount; i++) {
-            // Map kinect shape units to candide-3 shape units
-            int idx = su_map[i];
-            if (idx >= 0) {
-                mesh.setStaticParam(i, shapeUnits[i]);
-            }
+    // Once the SUs have converged they are frozen in the cache, and the
+    // static mesh no longer needs to be touched on the per-frame path.
+    if (!suCache.IsFrozen()) {
+        float headScale;
+        FLOAT *pSUCoefs;
+        UINT suCount;
+        BOOL haveConverged;
+        if (FAILED(hr = pFaceTracker->GetShapeUnits(&headScale, &pSUCoefs, &suCount, &haveConverged)))
+            throw ft_error("Error getting head SUs", hr);
+
+        if (suCache.Update(headScale, pSUCoefs, suCount, haveConverged != FALSE)) {
+            shapeUnits = suCache.GetShapeUnits();
+            shapeUnitsVersion++;
+        }
+
+        // Remember this user's face shape for next time. Only the first fit is
+        // saved, the cache is pinned afterwards (see ShapeUnitCache::Save).
+        if (suCache.IsFrozen() && !profileFilename.empty()) {
+            if (!suCache.Save(profileFilename))
+                cout << "Could not save shape unit profile '" << profileFilename << "'" << endl;
         }
-        mesh.updateStatic();
     }
 
     // Get face Action Units (AUs)
@@ -123,25 +246,124 @@ void CustomFaceModel::UpdateModel(IFTResult* pFTResult, FT_CAMERA_CONFIG* pCamer
     UINT auCount;
     if (FAILED(hr = pFTResult->GetAUCoefficients(&pAUs, &auCount)))
         throw ft_error("Error getting head AUs", hr);
-    actionUnits = vector<float>(pAUs, pAUs + auCount);
+    actionUnits.assign(pAUs, pAUs + auCount);
+}
+
+void CustomFaceModel::Deform(const std::vector<float>& actionUnits, const std::vector<float>& shapeUnits,
+    unsigned int shapeUnitsVersion, std::vector<float>* vertices)
+{
+    if (shapeUnitsVersion != appliedShapeUnitsVersion || !shapeUnitsApplied) {
+        ApplyShapeUnits(shapeUnits);
+        appliedShapeUnitsVersion = shapeUnitsVersion;
+        shapeUnitsApplied = true;
+    }
 
     int nDD = mesh.nDynamicDeformations();
     if (nDD > 0) {
-        for (int i = 0; i < auCount; i++) {
+        for (int i = 0; i < actionUnits.size() && i < au_map.size(); i++) {
             // Map kinect shape units to candide-3 action units
             int idx = au_map[i];
             if (idx >= 0) {
-                mesh.setDynamicParam(i, actionUnits[i]);
+                mesh.setDynamicParam(idx, actionUnits[i]);
             }
         }
     }
 
-    // Update the mesh
-    mesh.updateGlobal();
+    if (useCandide3) {
+        vertices->resize(Candide3Mesh::VertexCount * 3);
+        candide3.Deform(mesh, vertices->data());
+    }
+    else {
+        // Update the mesh
+        mesh.updateGlobal();
+
+        // Copy out the result, so it can be drawn while the next frame is being deformed
+        int nVertices = mesh.nVertices();
+        vertices->resize(nVertices * 3);
+        for (int i = 0; i < nVertices; i++) {
+            auto vertex = mesh.vertex(i);
+            (*vertices)[i * 3 + 0] = static_cast<float>(vertex[0]);
+            (*vertices)[i * 3 + 1] = static_cast<float>(vertex[1]);
+            (*vertices)[i * 3 + 2] = static_cast<float>(vertex[2]);
+        }
+    }
 
     hasModel = true;
 }
 
+void CustomFaceModel::TransferToDetail(const std::vector<float>& vertices, std::vector<float>* detailVertices) const {
+    if (subdivision.IsBuilt())
+        subdivision.Apply(vertices, detailVertices);
+    else
+        transfer.Apply(vertices, detailVertices);
+}
+
+void CustomFaceModel::GetCoefficients(const std::vector<float>& actionUnits, const std::vector<float>& shapeUnits,
+    std::vector<float>* coefficients) const
+{
+    // The mesh's own parameters, with the tracked ones set as ApplyShapeUnits/Deform do
+    int nSD = mesh.nStaticDeformations();
+    int nDD = mesh.nDynamicDeformations();
+    coefficients->resize(nSD + nDD);
+    for (int i = 0; i < nSD; i++)
+        (*coefficients)[i] = static_cast<float>(mesh.getStaticParam(i));
+    for (int i = 0; i < nDD; i++)
+        (*coefficients)[nSD + i] = static_cast<float>(mesh.getDynamicParam(i));
+
+    for (int i = 0; i < shapeUnits.size() && i < su_map.size(); i++) {
+        int idx = su_map[i];
+        if (idx >= 0 && idx < nSD)
+            (*coefficients)[idx] = shapeUnits[i];
+    }
+    for (int i = 0; i < actionUnits.size() && i < au_map.size(); i++) {
+        int idx = au_map[i];
+        if (idx >= 0 && idx < nDD)
+            (*coefficients)[nSD + idx] = actionUnits[i];
+    }
+}
+
+void CustomFaceModel::ApplyShapeUnits(const std::vector<float>& shapeUnits) {
+    // Use the SUs to deform the original mesh
+    int nSD = mesh.nStaticDeformations();
+    if (nSD > 0) {
+        for (int i = 0; i < shapeUnits.size() && i < su_map.size(); i++) {
+            // Map kinect shape units to candide-3 shape units
+            int idx = su_map[i];
+            if (idx >= 0) {
+                mesh.setStaticParam(idx, shapeUnits[i]);
+            }
+        }
+        if (useCandide3)
+            candide3.UpdateStatic(mesh);
+        else
+            mesh.updateStatic();
+    }
+}
+
+void CustomFaceModel::SetUserProfile(std::string filename) {
+    profileFilename = filename;
+
+    if (suCache.Load(filename)) {
+        cout << "Loaded shape unit profile '" << filename << "'" << endl;
+
+        // Give the tracker a head start with the known face shape
+        HRESULT hr;
+        const vector<float>& su = suCache.GetShapeUnits();
+        if (pFaceTracker != nullptr && !su.empty()) {
+            if (FAILED(hr = pFaceTracker->SetShapeUnits(suCache.GetHeadScale(), &su[0], su.size())))
+                throw ft_error("Error setting head SUs", hr);
+        }
+
+        // Applied to the mesh on the next Deform()
+        shapeUnits = su;
+        shapeUnitsVersion++;
+    }
+}
+
+void CustomFaceModel::ResetShapeUnits() {
+    suCache.Reset();
+}
+
 void CustomFaceModel::DrawGL() {
     if (hasModel) {
         bool hasTexcoords = mesh.hasTexCoords();
@@ -170,3 +392,68 @@ void CustomFaceModel::DrawGL() {
     }
 }
 
+void CustomFaceModel::DrawGL(const std::vector<float>& vertices) {
+    DrawGL(vertices, mesh);
+}
+
+void CustomFaceModel::DrawGL(const std::vector<float>& vertices, const eruFace::Model& topology) {
+    if (vertices.size() < topology.nVertices() * 3)
+        return;
+
+    // Only the vertex positions change per frame, the faces/texture coordinates are fixed
+    bool hasTexcoords = topology.hasTexCoords();
+
+    glPushMatrix();
+
+    glBegin(GL_TRIANGLES);
+    for (int f = 0; f < topology.nFaces(); f++) {
+        auto face = topology.face(f);
+
+        for (int v = 0; v < (int)face.nDim(); v++) {
+            int i = face[v];
+
+            if (hasTexcoords) {
+                auto uv = topology.texCoord(i);
+                glTexCoord2d(uv[0], uv[1]);
+            }
+
+            glVertex3fv(&vertices[i * 3]);
+        }
+    }
+    glEnd();
+
+    glPopMatrix();
+}
+
+void CustomFaceModel::DrawDetailGL(const std::vector<float>& detailVertices) {
+    if (detailVertices.size() < detailVertexCount * 3 || detailIndices.empty())
+        return;
+
+    // Too many vertices for immediate mode, so draw straight from the arrays
+    // (SFML leaves its own arrays enabled, so put them back afterwards)
+    glPushMatrix();
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, detailVertices.data());
+    if (!detailTexCoords.empty()) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, 0, detailTexCoords.data());
+    }
+    else {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    }
+
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(detailIndices.size()), GL_UNSIGNED_INT, detailIndices.data());
+
+    glPopClientAttrib();
+    glPopMatrix();
+}
+
+void CustomFaceModel::DrawBlendshapes(const std::vector<float>& coefficients) {
+    glPushMatrix();
+    blendshapes.Draw(coefficients);
+    glPopMatrix();
+}
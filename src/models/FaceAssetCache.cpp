@@ -0,0 +1,303 @@
+#include "models\FaceAssetCache.h"
+
+#include <iostream>
+#include <stdexcept>
+
+#include "utils\Profiler.h"
+
+using namespace std;
+
+FaceAssetCache::FaceAssetCache(const string& name, size_t cpuBudget, size_t gpuBudget) :
+    cpuBudget(cpuBudget),
+    gpuBudget(gpuBudget),
+    metricLabels("cache=\"" + name + "\""),
+    cpuBytes(0),
+    gpuBytes(0)
+{
+    auto& registry = Metrics::GetRegistry();
+    const string& labels = metricLabels;
+    hitCounter = &registry.AddCounter("face_cache_hits_total", "Faces acquired that were already resident", labels);
+    missCounter = &registry.AddCounter("face_cache_misses_total", "Faces acquired that had to be loaded, or waited for", labels);
+    evictionCounter = &registry.AddCounter("face_cache_evictions_total", "Evictions to stay within the face cache budgets", labels + ",kind=\"face\"");
+    textureEvictionCounter = &registry.AddCounter("face_cache_evictions_total", "Evictions to stay within the face cache budgets", labels + ",kind=\"texture\"");
+    prefetchCounter = &registry.AddCounter("face_cache_prefetches_total", "Faces loaded ahead of use by the loader thread", labels);
+    failureCounter = &registry.AddCounter("face_cache_failures_total", "Faces that could not be loaded", labels);
+    registry.AddCallbackGauge("face_cache_bytes", "Face cache memory use", labels + ",memory=\"cpu\"", [this]() { return static_cast<double>(GetStatistics().cpuBytes); });
+    registry.AddCallbackGauge("face_cache_bytes", "Face cache memory use", labels + ",memory=\"gpu\"", [this]() { return static_cast<double>(GetStatistics().gpuBytes); });
+    registry.AddCallbackGauge("face_cache_faces", "Faces resident in the face cache", labels, [this]() { return static_cast<double>(GetStatistics().faces); });
+    registry.AddCallbackGauge("face_cache_pinned_faces", "Faces that can't be evicted because they're in use", labels, [this]() { return static_cast<double>(GetStatistics().pinned); });
+}
+
+FaceAssetCache::~FaceAssetCache()
+{
+    {
+        lock_guard<std::mutex> lock(entriesMutex);
+        m_stop = true;
+    }
+    wake.notify_all();
+    Stop();
+
+    // Then unregister, the callbacks first since they read the counters. Nothing scrapes
+    // the cache once it's gone.
+    auto& registry = Metrics::GetRegistry();
+    const string& labels = metricLabels;
+    registry.Remove("face_cache_bytes", labels + ",memory=\"cpu\"");
+    registry.Remove("face_cache_bytes", labels + ",memory=\"gpu\"");
+    registry.Remove("face_cache_faces", labels);
+    registry.Remove("face_cache_pinned_faces", labels);
+    registry.Remove("face_cache_hits_total", labels);
+    registry.Remove("face_cache_misses_total", labels);
+    registry.Remove("face_cache_evictions_total", labels + ",kind=\"face\"");
+    registry.Remove("face_cache_evictions_total", labels + ",kind=\"texture\"");
+    registry.Remove("face_cache_prefetches_total", labels);
+    registry.Remove("face_cache_failures_total", labels);
+}
+
+shared_ptr<const FaceAsset> FaceAssetCache::Acquire(const string& filename) {
+    shared_ptr<FaceAsset> asset;
+    {
+        unique_lock<std::mutex> lock(entriesMutex);
+        auto found = index.find(filename);
+
+        if (found != index.end() && found->second->asset) {
+            hitCounter->Increment();
+            entries.splice(entries.begin(), entries, found->second);
+            asset = found->second->asset;
+        }
+        else if (found != index.end()) {
+            // Being prefetched, so wait for that rather than loading it twice
+            missCounter->Increment();
+            loaded.wait(lock, [&] {
+                auto f = index.find(filename);
+                return f == index.end() || f->second->asset;
+            });
+            found = index.find(filename);
+            if (found != index.end())
+                asset = found->second->asset;
+        }
+        else {
+            missCounter->Increment();
+            Entry entry = { filename, nullptr, 0, 0 };
+            entries.push_front(entry);
+            index[filename] = entries.begin();
+
+            lock.unlock();
+            asset = Load(filename);
+            lock.lock();
+            Finish(filename, asset);
+        }
+    }
+
+    if (!asset || !Upload(asset)) {
+        if (asset)
+            failureCounter->Increment();
+        return nullptr;
+    }
+
+    lock_guard<std::mutex> lock(entriesMutex);
+    Evict();
+    return asset;
+}
+
+void FaceAssetCache::Prefetch(const vector<string>& filenames) {
+    if (!m_started)
+        Start();
+
+    {
+        lock_guard<std::mutex> lock(entriesMutex);
+        prefetchQueue.clear();
+        for (const string& filename : filenames) {
+            auto found = index.find(filename);
+            if (found != index.end())
+                entries.splice(entries.begin(), entries, found->second);   // So it isn't evicted before it's needed
+            else
+                prefetchQueue.push_back(filename);
+        }
+    }
+    wake.notify_one();
+}
+
+void FaceAssetCache::Update() {
+    // The most recently used face that has been loaded but not uploaded, if there's room
+    shared_ptr<FaceAsset> pending;
+    {
+        lock_guard<std::mutex> lock(entriesMutex);
+        for (const Entry& entry : entries) {
+            if (entry.asset && !entry.asset->uploaded) {
+                if (gpuBytes + TextureBytes(entry.asset->faceTexture) <= gpuBudget)
+                    pending = entry.asset;
+                break;
+            }
+        }
+    }
+
+    if (pending) {
+        Upload(pending);
+        pending.reset();    // Or it would be pinned
+    }
+
+    lock_guard<std::mutex> lock(entriesMutex);
+    Evict();
+}
+
+bool FaceAssetCache::IsResident(const string& filename) const {
+    lock_guard<std::mutex> lock(entriesMutex);
+    auto found = index.find(filename);
+    return found != index.end() && found->second->asset;
+}
+
+FaceAssetCache::Statistics FaceAssetCache::GetStatistics() const {
+    Statistics s;
+    s.hits = hitCounter->Get();
+    s.misses = missCounter->Get();
+    s.evictions = evictionCounter->Get();
+    s.textureEvictions = textureEvictionCounter->Get();
+    s.prefetches = prefetchCounter->Get();
+    s.failures = failureCounter->Get();
+
+    lock_guard<std::mutex> lock(entriesMutex);
+    s.cpuBytes = cpuBytes;
+    s.gpuBytes = gpuBytes;
+    s.faces = static_cast<int>(entries.size());
+    s.pinned = 0;
+    for (const Entry& entry : entries) {
+        if (IsPinned(entry))
+            s.pinned++;
+    }
+    return s;
+}
+
+void FaceAssetCache::Run() {
+    Profiler::SetThreadName("FaceLoader");
+
+    unique_lock<std::mutex> lock(entriesMutex);
+    for (;;) {
+        wake.wait(lock, [this] { return m_stop || !prefetchQueue.empty(); });
+        if (m_stop)
+            break;
+
+        string filename = prefetchQueue.front();
+        prefetchQueue.pop_front();
+        if (index.find(filename) != index.end())
+            continue;   // Already resident, or being loaded by Acquire()
+
+        Entry entry = { filename, nullptr, 0, 0 };
+        entries.push_front(entry);
+        index[filename] = entries.begin();
+
+        lock.unlock();
+        shared_ptr<FaceAsset> asset = Load(filename);
+        lock.lock();
+
+        if (asset)
+            prefetchCounter->Increment();
+        Finish(filename, asset);
+    }
+}
+
+shared_ptr<FaceAsset> FaceAssetCache::Load(const string& filename) const {
+    PROFILE_SCOPE("FaceAssetCache::Load");
+
+    shared_ptr<FaceAsset> asset(new FaceAsset());
+    asset->filename = filename;
+    try {
+        if (!asset->mesh.read(filename) || !asset->mesh.hasTexCoords()) {
+            cerr << "Face cache: could not load textured mesh '" << filename << "'" << endl;
+            return nullptr;
+        }
+    }
+    catch (runtime_error& e) {
+        cerr << "Face cache: " << e.what() << endl;
+        return nullptr;
+    }
+
+    if (!asset->faceTexture.Load(asset->mesh._texFilename, textureCacheDirectory)) {
+        cerr << "Face cache: could not load texture '" << asset->mesh._texFilename << "' for '" << filename << "'" << endl;
+        return nullptr;
+    }
+
+    return asset;
+}
+
+void FaceAssetCache::Finish(const string& filename, const shared_ptr<FaceAsset>& asset) {
+    auto found = index.find(filename);
+    if (found != index.end()) {
+        if (asset) {
+            Entry& entry = *found->second;
+            entry.asset = asset;
+            entry.cpuBytes = MeshBytes(asset->mesh) + TextureBytes(asset->faceTexture);
+            cpuBytes += entry.cpuBytes;
+        }
+        else {
+            failureCounter->Increment();
+            entries.erase(found->second);
+            index.erase(found);
+        }
+    }
+    loaded.notify_all();
+}
+
+bool FaceAssetCache::Upload(const shared_ptr<FaceAsset>& asset) {
+    if (asset->uploaded)
+        return true;
+
+    // Only this thread uploads or evicts textures, so the asset can't change meanwhile
+    if (!asset->faceTexture.Upload(asset->texture))
+        return false;
+    asset->uploaded = true;
+
+    lock_guard<std::mutex> lock(entriesMutex);
+    auto found = index.find(asset->filename);
+    if (found != index.end() && found->second->asset == asset) {
+        found->second->gpuBytes = TextureBytes(asset->faceTexture);
+        gpuBytes += found->second->gpuBytes;
+    }
+    return true;
+}
+
+void FaceAssetCache::Evict() {
+    // GL textures first, least recently used first
+    for (auto it = entries.rbegin(); gpuBytes > gpuBudget && it != entries.rend(); ++it) {
+        if (!it->asset || !it->asset->uploaded || IsPinned(*it))
+            continue;
+
+        it->asset->texture = sf::Texture();
+        it->asset->uploaded = false;
+        gpuBytes -= it->gpuBytes;
+        it->gpuBytes = 0;
+        textureEvictionCounter->Increment();
+    }
+
+    // Then whole faces (the cache's reference is the last, so they're freed here)
+    auto it = entries.end();
+    while (cpuBytes > cpuBudget && it != entries.begin()) {
+        --it;
+        if (!it->asset || IsPinned(*it))
+            continue;
+
+        cpuBytes -= it->cpuBytes;
+        gpuBytes -= it->gpuBytes;
+        index.erase(it->filename);
+        it = entries.erase(it);
+        evictionCounter->Increment();
+    }
+}
+
+size_t FaceAssetCache::TextureBytes(const FaceTexture& texture) {
+    size_t bytes = 0;
+    for (int level = 0; level < texture.GetLevelCount(); level++)
+        bytes += static_cast<size_t>(texture.GetLevelWidth(level)) * texture.GetLevelHeight(level) * 2;
+    return bytes;
+}
+
+size_t FaceAssetCache::MeshBytes(const eruFace::Model& mesh) {
+    // An estimate: the vertex sets (base, static, dynamic, transformed and image coords),
+    // texture coordinates, faces and displacements
+    size_t bytes = static_cast<size_t>(mesh.nVertices()) * (5 * 3 + 2) * sizeof(double);
+    bytes += static_cast<size_t>(mesh.nFaces()) * 3 * sizeof(int);
+    for (int d = 0; d < mesh.nDynamicDeformations(); d++)
+        bytes += mesh.dynamicDeformation(d).nDisplacements() * (3 * sizeof(double) + sizeof(int));
+    for (int d = 0; d < mesh.nStaticDeformations(); d++)
+        bytes += mesh.staticDeformation(d).nDisplacements() * (3 * sizeof(double) + sizeof(int));
+    return bytes;
+}
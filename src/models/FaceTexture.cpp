@@ -0,0 +1,327 @@
+#include "models\FaceTexture.h"
+
+#include <SFML\Graphics\Image.hpp>
+#include <SFML\OpenGL.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+// OpenGL 1.2, which Windows' gl.h doesn't have
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL    0x813D
+#endif
+
+namespace
+{
+    const uint32_t magic = 0x58455446;     // "FTEX"
+    const uint32_t version = 2;
+
+    // Luma (Rec. 601), as face-blend.frag computed it from the overlay
+    const float kYR = 0.299f, kYG = 0.587f, kYB = 0.114f;
+
+    // FNV-1a
+    uint64_t Hash(const vector<char>& data) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : data) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    bool ReadFile(const string& filename, vector<char>* data) {
+        ifstream is(filename, ios::binary);
+        if (!is.is_open())
+            return false;
+
+        is.seekg(0, ios::end);
+        data->resize(static_cast<size_t>(is.tellg()));
+        is.seekg(0, ios::beg);
+        return data->empty() || is.read(data->data(), data->size());
+    }
+
+    inline int LevelSize(int size, int level) {
+        size >>= level;
+        return (size > 0) ? size : 1;
+    }
+}
+
+FaceTexture::FaceTexture() :
+    file(INVALID_HANDLE_VALUE),
+    mapping(nullptr),
+    view(nullptr),
+    header(nullptr),
+    cached(false)
+{
+}
+
+FaceTexture::~FaceTexture()
+{
+    Release();
+}
+
+void FaceTexture::Release() {
+    if (view != nullptr)
+        UnmapViewOfFile(view);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+    view = nullptr;
+    buffer.clear();
+    header = nullptr;
+    cached = false;
+}
+
+string FaceTexture::GetCacheFilename(const string& cacheDirectory, uint64_t hash) {
+    char name[32];
+    sprintf_s(name, "%016llx.ftex", static_cast<unsigned long long>(hash));
+    return cacheDirectory + name;
+}
+
+bool FaceTexture::Load(const string& filename, const string& cacheDirectory) {
+    Release();
+
+    vector<char> image;
+    if (!ReadFile(filename, &image))
+        return false;
+    uint64_t hash = Hash(image);
+
+    if (!cacheDirectory.empty() && Map(GetCacheFilename(cacheDirectory, hash), hash)) {
+        cached = true;
+        return true;
+    }
+
+    if (!Preprocess(image, hash))
+        return false;
+
+    // Not being able to cache it only costs the next load
+    if (!cacheDirectory.empty())
+        Write(cacheDirectory);
+    return true;
+}
+
+bool FaceTexture::Map(const string& cacheFile, uint64_t hash) {
+    file = CreateFileA(cacheFile.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader))) {
+        Release();
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    view = (mapping != nullptr) ? static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (view == nullptr) {
+        Release();
+        return false;
+    }
+
+    // Make sure it's this image's, and that the levels are all there
+    const FileHeader* h = reinterpret_cast<const FileHeader*>(view);
+    bool valid = h->magic == magic && h->version == version && h->sourceHash == hash &&
+        h->fileSize == size.QuadPart && h->width > 0 && h->height > 0 &&
+        h->levelCount > 0 && h->levelCount <= MaxLevels;
+    for (uint32_t level = 0; valid && level < h->levelCount; level++) {
+        uint64_t end = h->levelOffsets[level] + 2ULL * LevelSize(h->width, level) * LevelSize(h->height, level);
+        valid = h->levelOffsets[level] >= sizeof(FileHeader) && end <= h->fileSize;
+    }
+
+    if (!valid) {
+        Release();
+        return false;
+    }
+
+    header = h;
+    return true;
+}
+
+bool FaceTexture::Preprocess(const vector<char>& data, uint64_t hash) {
+    sf::Image image;
+    if (data.empty() || !image.loadFromMemory(data.data(), data.size()))
+        return false;
+
+    const int width = image.getSize().x;
+    const int height = image.getSize().y;
+    const sf::Uint8* pixels = image.getPixelsPtr();
+    const int texels = width * height;
+
+    // Luma histogram over the texels that show
+    vector<float> luma(texels);
+    FileHeader h;
+    memset(&h, 0, sizeof(h));
+    for (int i = 0; i < texels; i++) {
+        const sf::Uint8* p = pixels + i * 4;
+        float y = (p[0] * kYR + p[1] * kYG + p[2] * kYB) / 255.0f;
+        luma[i] = y;
+        if (p[3] > 0) {
+            int bin = static_cast<int>(y * 255.0f + 0.5f);
+            h.histogram[(bin < HistogramSize) ? bin : HistogramSize - 1]++;
+        }
+    }
+
+    // 1% and 99% levels, as Application::AnalyzeLevels finds them for the video. Only kept
+    // for reference: the overlay is drawn with its luma as is, as it always was.
+    double sum = 0.0;
+    for (int i = 0; i < HistogramSize; i++)
+        sum += h.histogram[i];
+    double csum = 0.0;
+    int low = 0, high = HistogramSize - 1;
+    for (int i = 0; i < HistogramSize; i++) {
+        csum += h.histogram[i];
+        if (csum < sum * 0.01)
+            low = i;
+        else if (csum < sum * 0.99)
+            high = i;
+    }
+    if (high <= low) {
+        low = 0;
+        high = HistogramSize - 1;
+    }
+    h.lumaLow = low / 255.0f;
+    h.lumaHigh = high / 255.0f;
+
+    // Lay out the levels
+    h.magic = magic;
+    h.version = version;
+    h.sourceHash = hash;
+    h.width = width;
+    h.height = height;
+    h.levelCount = 1;
+    while (h.levelCount < MaxLevels && (LevelSize(width, h.levelCount - 1) > 1 || LevelSize(height, h.levelCount - 1) > 1))
+        h.levelCount++;
+
+    uint32_t offset = sizeof(FileHeader);
+    for (uint32_t level = 0; level < h.levelCount; level++) {
+        h.levelOffsets[level] = offset;
+        offset += 2 * LevelSize(width, level) * LevelSize(height, level);
+    }
+    h.fileSize = offset;
+
+    buffer.assign(offset, 0);
+    memcpy(buffer.data(), &h, sizeof(h));
+
+    // Luma, premultiplied, and alpha
+    unsigned char* top = buffer.data() + h.levelOffsets[0];
+    for (int i = 0; i < texels; i++) {
+        float y = (luma[i] < 1.0f) ? luma[i] : 1.0f;
+        unsigned char a = pixels[i * 4 + 3];
+        top[i * 2 + 0] = static_cast<unsigned char>(y * a + 0.5f);
+        top[i * 2 + 1] = a;
+    }
+
+    // Each level averages 2x2 texels of the one above (clamped at odd edges)
+    for (uint32_t level = 1; level < h.levelCount; level++) {
+        const unsigned char* src = buffer.data() + h.levelOffsets[level - 1];
+        unsigned char* dst = buffer.data() + h.levelOffsets[level];
+        int srcWidth = LevelSize(width, level - 1), srcHeight = LevelSize(height, level - 1);
+        int dstWidth = LevelSize(width, level), dstHeight = LevelSize(height, level);
+
+        for (int y = 0; y < dstHeight; y++) {
+            int y0 = y * 2, y1 = (y * 2 + 1 < srcHeight) ? y * 2 + 1 : srcHeight - 1;
+            for (int x = 0; x < dstWidth; x++) {
+                int x0 = x * 2, x1 = (x * 2 + 1 < srcWidth) ? x * 2 + 1 : srcWidth - 1;
+                for (int c = 0; c < 2; c++) {
+                    int total = src[(y0 * srcWidth + x0) * 2 + c] + src[(y0 * srcWidth + x1) * 2 + c] +
+                        src[(y1 * srcWidth + x0) * 2 + c] + src[(y1 * srcWidth + x1) * 2 + c];
+                    dst[(y * dstWidth + x) * 2 + c] = static_cast<unsigned char>((total + 2) / 4);
+                }
+            }
+        }
+    }
+
+    header = reinterpret_cast<const FileHeader*>(buffer.data());
+    return true;
+}
+
+bool FaceTexture::Write(const string& cacheDirectory) const {
+    if (header == nullptr || buffer.empty())
+        return false;
+
+    CreateDirectoryA(cacheDirectory.c_str(), nullptr);
+
+    // Written aside then moved into place, so a half written file is never mapped
+    string cacheFile = GetCacheFilename(cacheDirectory, header->sourceHash);
+    string tempFile = cacheFile + ".tmp";
+    {
+        ofstream os(tempFile, ios::binary);
+        if (!os.is_open() || !os.write(reinterpret_cast<const char*>(buffer.data()), buffer.size()))
+            return false;
+    }
+
+    if (!MoveFileExA(tempFile.c_str(), cacheFile.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(tempFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+int FaceTexture::GetWidth() const {
+    return (header != nullptr) ? header->width : 0;
+}
+
+int FaceTexture::GetHeight() const {
+    return (header != nullptr) ? header->height : 0;
+}
+
+int FaceTexture::GetLevelCount() const {
+    return (header != nullptr) ? header->levelCount : 0;
+}
+
+int FaceTexture::GetLevelWidth(int level) const {
+    return LevelSize(GetWidth(), level);
+}
+
+int FaceTexture::GetLevelHeight(int level) const {
+    return LevelSize(GetHeight(), level);
+}
+
+const unsigned char* FaceTexture::GetLevel(int level) const {
+    if (header == nullptr || level < 0 || level >= GetLevelCount())
+        return nullptr;
+    return reinterpret_cast<const unsigned char*>(header) + header->levelOffsets[level];
+}
+
+const uint32_t* FaceTexture::GetHistogram() const {
+    return (header != nullptr) ? header->histogram : nullptr;
+}
+
+sf::Vector2f FaceTexture::GetLumaRange() const {
+    return (header != nullptr) ? sf::Vector2f(header->lumaLow, header->lumaHigh) : sf::Vector2f(0.0f, 1.0f);
+}
+
+bool FaceTexture::Upload(sf::Texture& texture) const {
+    if (header == nullptr || !texture.create(header->width, header->height))
+        return false;
+
+    // Only report errors from this upload, not whatever was left pending before it
+    while (glGetError() != GL_NO_ERROR) {}
+
+    sf::Texture::bind(&texture);
+
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);     // Rows are packed, 2 bytes per texel
+
+    int levels = GetLevelCount();
+    for (int level = 0; level < levels; level++) {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_LUMINANCE8_ALPHA8, GetLevelWidth(level), GetLevelHeight(level), 0,
+            GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, GetLevel(level));
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    sf::Texture::bind(NULL);
+
+    return glGetError() == GL_NO_ERROR;
+}
@@ -0,0 +1,244 @@
+#include "models\LoopSubdivision.h"
+#include "utils\TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+namespace
+{
+    const int parallelGrain = 4096;     // Refined vertices per task
+
+    // A vertex (or edge) point as a combination of the previous level's vertices
+    typedef std::vector<std::pair<int, double>> Rule;
+
+    struct Edge {
+        int     a, b;
+        int     faceCount;
+        int     opposite[2];    // The faces' third vertices, if faceCount is 2
+    };
+
+    // Loop's weight for each neighbor of an interior vertex of valence n
+    double Beta(int n) {
+        double c = 3.0 / 8.0 + 0.25 * cos(2.0 * 3.14159265358979323846 / n);
+        return (5.0 / 8.0 - c * c) / n;
+    }
+}
+
+LoopSubdivision::LoopSubdivision() :
+    levels(0),
+    sourceCount(0)
+{
+}
+
+void LoopSubdivision::Clear() {
+    levels = 0;
+    sourceCount = 0;
+    faces.clear();
+    texCoords.clear();
+    offsets.clear();
+    indices.clear();
+    weights.clear();
+}
+
+bool LoopSubdivision::Build(const eruFace::Model& mesh, int levels) {
+    Clear();
+    if (levels < 1 || levels > MaxLevels || mesh.nVertices() == 0 || mesh.nFaces() == 0)
+        return false;
+
+    int nSource = mesh.nVertices();
+
+    // Each vertex's stencil over the mesh's vertices, starting from the identity
+    std::vector<Rule> stencils(nSource);
+    for (int i = 0; i < nSource; i++)
+        stencils[i].push_back(std::make_pair(i, 1.0));
+
+    std::vector<int> current(mesh.nFaces() * 3);
+    for (int f = 0; f < mesh.nFaces(); f++) {
+        auto face = mesh.face(f);
+        for (int v = 0; v < 3; v++) {
+            if (face[v] < 0 || face[v] >= nSource)
+                return false;
+            current[f * 3 + v] = face[v];
+        }
+    }
+
+    std::vector<double> accum(nSource, 0.0);
+    std::vector<int> touched;
+
+    for (int level = 0; level < levels; level++) {
+        int n = static_cast<int>(stencils.size());
+        int nFaces = static_cast<int>(current.size() / 3);
+
+        // Edges, and the faces either side of them
+        std::vector<Edge> edges;
+        std::map<std::pair<int, int>, int> edgeIndex;
+        std::vector<int> faceEdges(nFaces * 3);     // Edge opposite each face's corner, (v + 1, v + 2)
+        for (int f = 0; f < nFaces; f++) {
+            for (int v = 0; v < 3; v++) {
+                int a = current[f * 3 + (v + 1) % 3];
+                int b = current[f * 3 + (v + 2) % 3];
+                auto key = (a < b) ? std::make_pair(a, b) : std::make_pair(b, a);
+
+                auto it = edgeIndex.find(key);
+                if (it == edgeIndex.end()) {
+                    Edge e;
+                    e.a = key.first;
+                    e.b = key.second;
+                    e.faceCount = 0;
+                    it = edgeIndex.insert(std::make_pair(key, static_cast<int>(edges.size()))).first;
+                    edges.push_back(e);
+                }
+
+                Edge& e = edges[it->second];
+                if (e.faceCount < 2)
+                    e.opposite[e.faceCount] = current[f * 3 + v];
+                e.faceCount++;
+                faceEdges[f * 3 + v] = it->second;
+            }
+        }
+
+        // Each vertex's neighbors, and those along boundary edges
+        std::vector<std::vector<int>> neighbors(n), boundary(n);
+        for (const Edge& e : edges) {
+            neighbors[e.a].push_back(e.b);
+            neighbors[e.b].push_back(e.a);
+            if (e.faceCount != 2) {
+                boundary[e.a].push_back(e.b);
+                boundary[e.b].push_back(e.a);
+            }
+        }
+
+        // The rules for this level: vertex points, then edge points
+        std::vector<Rule> rules(n + edges.size());
+        for (int i = 0; i < n; i++) {
+            Rule& rule = rules[i];
+            if (boundary[i].empty() && !neighbors[i].empty()) {
+                int valence = static_cast<int>(neighbors[i].size());
+                double beta = Beta(valence);
+                rule.push_back(std::make_pair(i, 1.0 - valence * beta));
+                for (int j : neighbors[i])
+                    rule.push_back(std::make_pair(j, beta));
+            }
+            else if (boundary[i].size() == 2) {
+                rule.push_back(std::make_pair(i, 0.75));
+                rule.push_back(std::make_pair(boundary[i][0], 0.125));
+                rule.push_back(std::make_pair(boundary[i][1], 0.125));
+            }
+            else {
+                rule.push_back(std::make_pair(i, 1.0));     // Corner, or not part of any face
+            }
+        }
+        for (size_t k = 0; k < edges.size(); k++) {
+            const Edge& e = edges[k];
+            Rule& rule = rules[n + k];
+            if (e.faceCount == 2) {
+                rule.push_back(std::make_pair(e.a, 0.375));
+                rule.push_back(std::make_pair(e.b, 0.375));
+                rule.push_back(std::make_pair(e.opposite[0], 0.125));
+                rule.push_back(std::make_pair(e.opposite[1], 0.125));
+            }
+            else {
+                rule.push_back(std::make_pair(e.a, 0.5));
+                rule.push_back(std::make_pair(e.b, 0.5));
+            }
+        }
+
+        // Compose them with the stencils so far, so the new stencils are still over the mesh's vertices
+        std::vector<Rule> composed(rules.size());
+        for (size_t v = 0; v < rules.size(); v++) {
+            touched.clear();
+            for (const auto& term : rules[v]) {
+                for (const auto& s : stencils[term.first]) {
+                    if (accum[s.first] == 0.0)
+                        touched.push_back(s.first);
+                    accum[s.first] += term.second * s.second;
+                }
+            }
+
+            std::sort(touched.begin(), touched.end());
+            for (int i : touched) {
+                composed[v].push_back(std::make_pair(i, accum[i]));
+                accum[i] = 0.0;
+            }
+        }
+        stencils.swap(composed);
+
+        // Each face splits into its corners and the triangle between its edge points
+        std::vector<int> refined(nFaces * 12);
+        for (int f = 0; f < nFaces; f++) {
+            int a = current[f * 3 + 0], b = current[f * 3 + 1], c = current[f * 3 + 2];
+            int bc = n + faceEdges[f * 3 + 0];
+            int ca = n + faceEdges[f * 3 + 1];
+            int ab = n + faceEdges[f * 3 + 2];
+
+            int* t = &refined[f * 12];
+            t[0] = a;   t[1] = ab;  t[2] = ca;
+            t[3] = ab;  t[4] = b;   t[5] = bc;
+            t[6] = ca;  t[7] = bc;  t[8] = c;
+            t[9] = ab;  t[10] = bc; t[11] = ca;
+        }
+        current.swap(refined);
+    }
+
+    // Flatten the stencils
+    offsets.resize(stencils.size() + 1);
+    offsets[0] = 0;
+    for (size_t v = 0; v < stencils.size(); v++) {
+        for (const auto& s : stencils[v]) {
+            indices.push_back(s.first);
+            weights.push_back(static_cast<float>(s.second));
+        }
+        offsets[v + 1] = static_cast<int>(indices.size());
+    }
+
+    if (mesh.hasTexCoords()) {
+        texCoords.resize(stencils.size() * 2);
+        for (size_t v = 0; v < stencils.size(); v++) {
+            double u = 0.0, w = 0.0;
+            for (const auto& s : stencils[v]) {
+                auto uv = mesh.texCoord(s.first);
+                u += s.second * uv[0];
+                w += s.second * uv[1];
+            }
+            texCoords[v * 2 + 0] = static_cast<float>(u);
+            texCoords[v * 2 + 1] = static_cast<float>(w);
+        }
+    }
+
+    faces.swap(current);
+    sourceCount = nSource;
+    this->levels = levels;
+    return true;
+}
+
+bool LoopSubdivision::Apply(const std::vector<float>& source, std::vector<float>* target) const {
+    if (static_cast<int>(source.size()) < sourceCount * 3)
+        return false;
+
+    int count = GetVertexCount();
+    target->resize(static_cast<size_t>(count) * 3);
+    const float* s = source.data();
+    float* out = target->data();
+
+    TaskScheduler::Default().ParallelFor(0, count, parallelGrain, [&](int begin, int end) {
+        for (int v = begin; v < end; v++) {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+
+            for (int k = offsets[v]; k < offsets[v + 1]; k++) {
+                const float* c = s + indices[k] * 3;
+                float w = weights[k];
+                x += w * c[0];
+                y += w * c[1];
+                z += w * c[2];
+            }
+
+            out[v * 3 + 0] = x;
+            out[v * 3 + 1] = y;
+            out[v * 3 + 2] = z;
+        }
+    });
+
+    return true;
+}
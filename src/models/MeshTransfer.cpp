@@ -0,0 +1,162 @@
+#include "models\MeshTransfer.h"
+#include "utils\TaskScheduler.h"
+
+#include <opencv2\core.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+    const int parallelGrain = 4096;     // Target vertices per task
+
+    // Ridge on the spatial part of the weights' normal equations (in units of the neighborhood's
+    // size, where those entries are at most about 1). Keeps the weights small where the neighbors
+    // are nearly coplanar (as on a surface mesh) and the vertex is off their plane; the offset
+    // makes up the rest.
+    const double ridge = 0.01;
+}
+
+MeshTransfer::MeshTransfer() :
+    sourceCount(0),
+    targetCount(0),
+    neighbors(0)
+{
+}
+
+void MeshTransfer::Clear() {
+    sourceCount = 0;
+    targetCount = 0;
+    neighbors = 0;
+    indices.clear();
+    weights.clear();
+    offsets.clear();
+}
+
+void MeshTransfer::Bind(const std::vector<float>& source, const std::vector<float>& target) {
+    Clear();
+
+    int nSource = static_cast<int>(source.size() / 3);
+    int nTarget = static_cast<int>(target.size() / 3);
+    if (nSource == 0 || nTarget == 0)
+        return;
+
+    int k = (nSource < Neighbors) ? nSource : Neighbors;
+
+    // Distances below this (relative to the source's size) count as coincident
+    float lo[3] = { source[0], source[1], source[2] }, hi[3] = { source[0], source[1], source[2] };
+    for (int i = 0; i < nSource; i++) {
+        for (int j = 0; j < 3; j++) {
+            lo[j] = (source[i * 3 + j] < lo[j]) ? source[i * 3 + j] : lo[j];
+            hi[j] = (source[i * 3 + j] > hi[j]) ? source[i * 3 + j] : hi[j];
+        }
+    }
+    double size2 = 0.0;
+    for (int j = 0; j < 3; j++)
+        size2 += static_cast<double>(hi[j] - lo[j]) * (hi[j] - lo[j]);
+    double epsilon2 = size2 * 1e-12 + 1e-30;
+
+    indices.resize(static_cast<size_t>(nTarget) * k);
+    weights.resize(static_cast<size_t>(nTarget) * k);
+    offsets.resize(static_cast<size_t>(nTarget) * 3);
+
+    TaskScheduler::Default().ParallelFor(0, nTarget, parallelGrain, [&](int begin, int end) {
+        std::vector<std::pair<double, int> > nearest(nSource);
+
+        for (int t = begin; t < end; t++) {
+            const float* p = &target[t * 3];
+
+            for (int i = 0; i < nSource; i++) {
+                const float* c = &source[i * 3];
+                double dx = c[0] - p[0], dy = c[1] - p[1], dz = c[2] - p[2];
+                nearest[i] = std::make_pair(dx * dx + dy * dy + dz * dz, i);
+            }
+            std::partial_sort(nearest.begin(), nearest.begin() + k, nearest.end());
+
+            // Distances relative to the neighborhood's size, so the weights don't depend on the mesh's scale
+            double r2 = epsilon2;
+            for (int n = 0; n < k; n++)
+                r2 += nearest[n].first / k;
+            double r = std::sqrt(r2);
+
+            // Minimize sum(w^2 / phi) subject to sum(w * (c - p)) = 0 and sum(w) = 1, where phi
+            // favours the nearest: w = phi * a^T * lambda, with (sum phi * a * a^T) * lambda = (0, 0, 0, 1)
+            cv::Matx44d m = cv::Matx44d::zeros();
+            cv::Vec4d a[Neighbors];
+            double phi[Neighbors];
+            for (int n = 0; n < k; n++) {
+                const float* c = &source[nearest[n].second * 3];
+                a[n] = cv::Vec4d((c[0] - p[0]) / r, (c[1] - p[1]) / r, (c[2] - p[2]) / r, 1.0);
+                phi[n] = r2 / (nearest[n].first + epsilon2);
+                m += phi[n] * (a[n] * a[n].t());
+            }
+            for (int j = 0; j < 3; j++)
+                m(j, j) += ridge;
+
+            cv::Vec4d lambda;
+            cv::solve(m, cv::Vec4d(0.0, 0.0, 0.0, 1.0), lambda, cv::DECOMP_SVD);
+
+            // Normalized, since the ridge lets the sum drift from 1
+            double w[Neighbors], sum = 0.0;
+            for (int n = 0; n < k; n++) {
+                w[n] = phi[n] * a[n].dot(lambda);
+                sum += w[n];
+            }
+            if (std::fabs(sum) < 1e-12) {
+                // Degenerate; follow the nearest vertex
+                for (int n = 0; n < k; n++)
+                    w[n] = (n == 0) ? 1.0 : 0.0;
+                sum = 1.0;
+            }
+
+            double rest[3] = { 0.0, 0.0, 0.0 };
+            for (int n = 0; n < k; n++) {
+                const float* c = &source[nearest[n].second * 3];
+                float weight = static_cast<float>(w[n] / sum);
+                indices[t * k + n] = nearest[n].second;
+                weights[t * k + n] = weight;
+                for (int j = 0; j < 3; j++)
+                    rest[j] += weight * c[j];
+            }
+            for (int j = 0; j < 3; j++)
+                offsets[t * 3 + j] = static_cast<float>(p[j] - rest[j]);
+        }
+    });
+
+    sourceCount = nSource;
+    targetCount = nTarget;
+    neighbors = k;
+}
+
+bool MeshTransfer::Apply(const std::vector<float>& source, std::vector<float>* target) const {
+    if (static_cast<int>(source.size()) < sourceCount * 3)
+        return false;
+
+    target->resize(static_cast<size_t>(targetCount) * 3);
+    const float* s = source.data();
+    float* out = target->data();
+
+    TaskScheduler::Default().ParallelFor(0, targetCount, parallelGrain, [&](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            const int* index = &indices[t * neighbors];
+            const float* weight = &weights[t * neighbors];
+            float x = offsets[t * 3 + 0];
+            float y = offsets[t * 3 + 1];
+            float z = offsets[t * 3 + 2];
+
+            for (int n = 0; n < neighbors; n++) {
+                const float* c = s + index[n] * 3;
+                x += weight[n] * c[0];
+                y += weight[n] * c[1];
+                z += weight[n] * c[2];
+            }
+
+            out[t * 3 + 0] = x;
+            out[t * 3 + 1] = y;
+            out[t * 3 + 2] = z;
+        }
+    });
+
+    return true;
+}
@@ -0,0 +1,105 @@
+#include "models\ShapeUnitCache.h"
+
+#include "eru\StringStreamUtils.h"
+
+#include <Windows.h>
+
+#include <cmath>
+#include <fstream>
+
+using namespace std;
+
+ShapeUnitCache::ShapeUnitCache(float threshold) :
+threshold(threshold),
+frozen(false),
+pinned(false),
+headScale(1.0f)
+{
+}
+
+ShapeUnitCache::~ShapeUnitCache()
+{
+}
+
+bool ShapeUnitCache::Update(float headScale, const float* pSUCoefs, unsigned int suCount, bool haveConverged) {
+    if (frozen)
+        return false;
+
+    bool changed = (suCount != shapeUnits.size());
+    for (unsigned int i = 0; i < suCount && !changed; i++) {
+        if (fabs(pSUCoefs[i] - shapeUnits[i]) > threshold)
+            changed = true;
+    }
+
+    if (changed) {
+        this->headScale = headScale;
+        shapeUnits.assign(pSUCoefs, pSUCoefs + suCount);
+    }
+
+    // Freeze once the tracker is happy with its estimate of the user's face shape
+    if (haveConverged)
+        frozen = true;
+
+    return changed;
+}
+
+void ShapeUnitCache::Reset() {
+    if (!pinned)
+        frozen = false;
+}
+
+bool ShapeUnitCache::Load(const std::string& filename) {
+    ifstream is(filename);
+    if (!is.is_open())
+        return false;
+
+    // Same layout as the parameter lists in a .wfm file
+    int count;
+    float scale;
+    eru::skipComments(is);
+    is >> scale;
+    eru::skipComments(is);
+    is >> count;
+    if (!is || count < 0)
+        return false;
+
+    vector<float> units(count, 0.0f);
+    for (int i = 0; i < count; i++) {
+        int idx;
+        float value;
+        is >> idx >> value;
+        if (!is || idx < 0 || idx >= count)
+            return false;
+        units[idx] = value;
+    }
+
+    headScale = scale;
+    shapeUnits = units;
+    frozen = true;
+    pinned = true;
+    return true;
+}
+
+bool ShapeUnitCache::Save(const std::string& filename) {
+    // The profiles directory isn't shipped, create it on first use
+    size_t separator = filename.find_last_of("\\/");
+    if (separator != string::npos)
+        CreateDirectoryA(filename.substr(0, separator).c_str(), nullptr);
+
+    ofstream os(filename);
+    if (!os.is_open())
+        return false;
+
+    os << "# HEAD SCALE:\n" << headScale << "\n";
+    os << "\n# SHAPE UNITS:\n" << shapeUnits.size() << "\n";
+    for (unsigned int i = 0; i < shapeUnits.size(); i++)
+        os << i << "\t" << shapeUnits[i] << "\n";
+
+    if (!os.good())
+        return false;
+
+    // From now on this is the user's profile, so a later reset doesn't let
+    // whoever converges next overwrite it
+    pinned = true;
+    return true;
+}
@@ -0,0 +1,61 @@
+#include "utils\AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long long> allocationCount(0);
+static std::atomic<unsigned long long> allocatedBytes(0);
+
+unsigned long long AllocationCounter::GetAllocationCount() {
+    return allocationCount;
+}
+
+unsigned long long AllocationCounter::GetAllocatedBytes() {
+    return allocatedBytes;
+}
+
+// Replacement global allocation functions
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+    try {
+        return operator new(size);
+    }
+    catch (std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw() {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) throw() {
+    free(p);
+}
+
+void operator delete[](void* p) throw() {
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw() {
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) throw() {
+    free(p);
+}
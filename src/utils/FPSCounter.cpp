@@ -22,25 +22,25 @@ float FPSCounter::GetCurrentFps() {
 }
 
 float FPSCounter::GetAverageInterval() {
-    if (count == 0)
-        return 0.0f;
+    return static_cast<float>(intervals.GetMean());
+}
 
-    float sum = 0.0f;
-    for (int i = 0; i < count; i++)
-        sum += hist[i];
+float FPSCounter::GetCurrentInterval() {
+    return intervals.GetCurrent();
+}
 
-    return sum / static_cast<float>(count);
+float FPSCounter::GetMaximumInterval() {
+    return intervals.GetMaximum();
 }
 
-float FPSCounter::GetCurrentInterval() {
-    return hist[idx];
+float FPSCounter::GetIntervalStdDev() {
+    return static_cast<float>(intervals.GetStdDev());
 }
 
-void FPSCounter::AddSample(float interval) {
-    hist[idx] = interval;
-    if (++idx == c_samples)
-        idx = 0;
+float FPSCounter::GetIntervalPercentile(float p) {
+    return static_cast<float>(intervals.GetPercentile(p));
+}
 
-    if (count < c_samples)
-        count++;
-}
\ No newline at end of file
+void FPSCounter::AddSample(float interval) {
+    intervals.AddSample(interval);
+}
@@ -0,0 +1,138 @@
+#include "utils\FrameArena.h"
+
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+using namespace std;
+
+// Routes cv::Mat data (and the UMatData header) through the frame arena,
+// so per-frame temporaries don't touch the heap. Based on cv::StdMatAllocator.
+class FrameArena::MatAllocator : public cv::MatAllocator
+{
+public:
+    MatAllocator(FrameArena* arena) : arena(arena) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type,
+        void* data0, size_t* step, int flags, cv::UMatUsageFlags usageFlags) const
+    {
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step) {
+                if (data0 && step[i] != CV_AUTOSTEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                }
+                else {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        uchar* data = (data0 != nullptr) ? reinterpret_cast<uchar*>(data0) : reinterpret_cast<uchar*>(arena->Allocate(total));
+
+        cv::UMatData* u = new (arena->Allocate(sizeof(cv::UMatData))) cv::UMatData(this);
+        u->data = u->origdata = data;
+        u->size = total;
+        if (data0 != nullptr)
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+
+        arena->liveMats++;
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, int accessFlags, cv::UMatUsageFlags usageFlags) const
+    {
+        return (u != nullptr);
+    }
+
+    void deallocate(cv::UMatData* u) const
+    {
+        if (u == nullptr)
+            return;
+
+        CV_Assert(u->urefcount >= 0);
+        CV_Assert(u->refcount >= 0);
+        if (u->refcount == 0) {
+            // The memory itself is reclaimed when the arena is reset
+            u->~UMatData();
+            arena->liveMats--;
+        }
+    }
+
+private:
+    FrameArena* arena;
+};
+
+FrameArena::FrameArena(size_t capacity) :
+capacity(capacity),
+used(0),
+peak(0),
+overflowBytes(0),
+overflowCount(0),
+liveMats(0)
+{
+    buffer = reinterpret_cast<unsigned char*>(cv::fastMalloc(capacity));
+    matAllocator = new MatAllocator(this);
+}
+
+FrameArena::~FrameArena()
+{
+    FreeOverflow();
+    delete matAllocator;
+    cv::fastFree(buffer);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+
+    if (offset + size > capacity) {
+        // Doesn't fit, fall back to the heap for the rest of this frame
+        void* block = cv::fastMalloc(size);
+        overflowBlocks.push_back(block);
+        overflowBytes += size;
+        overflowCount++;
+        return block;
+    }
+
+    used = offset + size;
+    if (used > peak)
+        peak = used;
+
+    return buffer + offset;
+}
+
+void FrameArena::Reset() {
+    // Any matrix still referencing arena memory would now be dangling
+    if (liveMats != 0)
+        throw logic_error("Frame arena reset while matrices still use it");
+
+    FreeOverflow();
+
+    // Grow to fit the worst frame seen so far, so steady state never overflows
+    if (overflowBytes > 0) {
+        cv::fastFree(buffer);
+        capacity = (peak + overflowBytes) * 2;
+        buffer = reinterpret_cast<unsigned char*>(cv::fastMalloc(capacity));
+        overflowBytes = 0;
+    }
+
+    used = 0;
+}
+
+void FrameArena::FreeOverflow() {
+    for (auto block : overflowBlocks)
+        cv::fastFree(block);
+    overflowBlocks.clear();
+}
+
+cv::Mat FrameArena::NewMat() {
+    cv::Mat m;
+    m.allocator = matAllocator;
+    return m;
+}
+
+cv::MatAllocator* FrameArena::GetMatAllocator() {
+    return matAllocator;
+}
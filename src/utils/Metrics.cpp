@@ -0,0 +1,232 @@
+#include "utils\Metrics.h"
+
+#include <cmath>
+#include <limits>
+#include <set>
+#include <sstream>
+
+using namespace std;
+using namespace Metrics;
+
+Histogram::Histogram(const std::vector<double>& bounds) :
+bounds(bounds),
+counts(new atomic<unsigned long long>[bounds.size() + 1]),
+count(0),
+sum(0.0)
+{
+    for (unsigned int i = 0; i <= bounds.size(); i++)
+        counts[i] = 0;
+}
+
+void Histogram::Observe(double v) {
+    unsigned int i = 0;
+    while (i < bounds.size() && v > bounds[i])
+        i++;
+
+    counts[i].fetch_add(1, memory_order_relaxed);
+    count.fetch_add(1, memory_order_relaxed);
+
+    // No fetch_add for doubles
+    double old = sum.load(memory_order_relaxed);
+    while (!sum.compare_exchange_weak(old, old + v, memory_order_relaxed))
+        ;
+}
+
+Registry::Registry()
+{
+}
+
+Registry::~Registry()
+{
+    for (auto& e : entries) {
+        switch (e.type) {
+        case counter:   delete reinterpret_cast<Counter*>(e.metric); break;
+        case gauge:     delete reinterpret_cast<Gauge*>(e.metric); break;
+        case histogram: delete reinterpret_cast<Histogram*>(e.metric); break;
+        default: break;
+        }
+    }
+}
+
+void Registry::Add(Type type, const std::string& name, const std::string& help, const std::string& labels, void* metric) {
+    Entry e;
+    e.type = type;
+    e.name = name;
+    e.help = help;
+    e.labels = labels;
+    e.metric = metric;
+
+    lock_guard<std::mutex> lock(mutex);
+    entries.push_back(e);
+}
+
+Counter& Registry::AddCounter(const std::string& name, const std::string& help, const std::string& labels) {
+    Counter* c = new Counter();
+    Add(counter, name, help, labels, c);
+    return *c;
+}
+
+Gauge& Registry::AddGauge(const std::string& name, const std::string& help, const std::string& labels) {
+    Gauge* g = new Gauge();
+    Add(gauge, name, help, labels, g);
+    return *g;
+}
+
+Histogram& Registry::AddHistogram(const std::string& name, const std::string& help, const std::vector<double>& bounds, const std::string& labels) {
+    Histogram* h = new Histogram(bounds);
+    Add(histogram, name, help, labels, h);
+    return *h;
+}
+
+void Registry::AddCallbackGauge(const std::string& name, const std::string& help, std::function<double()> fn) {
+    AddCallbackGauge(name, help, "", fn);
+}
+
+void Registry::AddCallbackGauge(const std::string& name, const std::string& help, const std::string& labels, std::function<double()> fn) {
+    Entry e;
+    e.type = callback;
+    e.name = name;
+    e.help = help;
+    e.labels = labels;
+    e.metric = nullptr;
+    e.fn = fn;
+
+    lock_guard<std::mutex> lock(mutex);
+    entries.push_back(e);
+}
+
+void Registry::AddCallbackCounter(const std::string& name, const std::string& help, std::function<unsigned long long()> fn) {
+    Entry e;
+    e.type = callbackCounter;
+    e.name = name;
+    e.help = help;
+    e.metric = nullptr;
+    e.counterFn = fn;
+
+    lock_guard<std::mutex> lock(mutex);
+    entries.push_back(e);
+}
+
+void Registry::Remove(const std::string& name, const std::string& labels) {
+    lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->name != name || it->labels != labels) {
+            ++it;
+            continue;
+        }
+
+        switch (it->type) {
+        case counter:   delete reinterpret_cast<Counter*>(it->metric); break;
+        case gauge:     delete reinterpret_cast<Gauge*>(it->metric); break;
+        case histogram: delete reinterpret_cast<Histogram*>(it->metric); break;
+        default: break;
+        }
+        it = entries.erase(it);
+    }
+}
+
+static string JoinLabels(const string& a, const string& b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    return a + "," + b;
+}
+
+static string Braces(const string& labels) {
+    return labels.empty() ? "" : "{" + labels + "}";
+}
+
+// A sample value. Whole numbers (eg. byte counts) are written out in full rather than
+// rounded to the stream's default 6 digits, and anything else with all its digits.
+static void WriteValue(ostream& os, double v) {
+    if (v != v)
+        os << "NaN";
+    else if (v == numeric_limits<double>::infinity() || v == -numeric_limits<double>::infinity())
+        os << ((v > 0) ? "+Inf" : "-Inf");
+    else if (v == floor(v) && fabs(v) < 9007199254740992.0)    // 2^53, where doubles stop being exact integers
+        os << static_cast<long long>(v);
+    else {
+        streamsize precision = os.precision(numeric_limits<double>::max_digits10);
+        os << v;
+        os.precision(precision);
+    }
+}
+
+void Registry::RenderEntry(std::ostream& os, const Entry& e) {
+    switch (e.type) {
+    case counter:
+        os << e.name << Braces(e.labels) << " " << reinterpret_cast<Counter*>(e.metric)->Get() << "\n";
+        break;
+
+    case gauge:
+        os << e.name << Braces(e.labels) << " ";
+        WriteValue(os, reinterpret_cast<Gauge*>(e.metric)->Get());
+        os << "\n";
+        break;
+
+    case callback:
+        os << e.name << Braces(e.labels) << " ";
+        WriteValue(os, e.fn());
+        os << "\n";
+        break;
+
+    case callbackCounter:
+        os << e.name << Braces(e.labels) << " " << e.counterFn() << "\n";
+        break;
+
+    case histogram: {
+        Histogram* h = reinterpret_cast<Histogram*>(e.metric);
+        const vector<double>& bounds = h->GetBounds();
+
+        // Prometheus buckets are cumulative
+        unsigned long long cumulative = 0;
+        for (unsigned int i = 0; i < bounds.size(); i++) {
+            cumulative += h->GetBucketCount(i);
+            ostringstream le;
+            le << "le=\"";
+            WriteValue(le, bounds[i]);
+            le << "\"";
+            os << e.name << "_bucket" << Braces(JoinLabels(e.labels, le.str())) << " " << cumulative << "\n";
+        }
+        cumulative += h->GetBucketCount(bounds.size());
+        os << e.name << "_bucket" << Braces(JoinLabels(e.labels, "le=\"+Inf\"")) << " " << cumulative << "\n";
+        os << e.name << "_sum" << Braces(e.labels) << " ";
+        WriteValue(os, h->GetSum());
+        os << "\n";
+        os << e.name << "_count" << Braces(e.labels) << " " << h->GetCount() << "\n";
+        break;
+    }
+    }
+}
+
+void Registry::Render(std::ostream& os) {
+    lock_guard<std::mutex> lock(mutex);
+
+    // All series with the same name must be grouped together under one HELP/TYPE,
+    // even if they weren't registered consecutively.
+    set<string> rendered;
+
+    for (auto& e : entries) {
+        if (!rendered.insert(e.name).second)
+            continue;
+
+        const char* type = (e.type == counter || e.type == callbackCounter) ? "counter" : ((e.type == histogram) ? "histogram" : "gauge");
+        os << "# HELP " << e.name << " " << e.help << "\n";
+        os << "# TYPE " << e.name << " " << type << "\n";
+
+        for (auto& other : entries) {
+            if (other.name == e.name)
+                RenderEntry(os, other);
+        }
+    }
+}
+
+Registry& Metrics::GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+const std::vector<double>& Metrics::LatencyBuckets() {
+    static const double bounds[] = { 1, 2, 5, 10, 20, 33, 50, 75, 100, 150, 200, 500 };
+    static const vector<double> buckets(bounds, bounds + sizeof(bounds) / sizeof(bounds[0]));
+    return buckets;
+}
@@ -0,0 +1,146 @@
+#include <WinSock2.h>   // Must come before Windows.h
+#include <WS2tcpip.h>
+
+#include "utils\MetricsServer.h"
+#include "utils\Metrics.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+using namespace std;
+
+MetricsServer::MetricsServer(unsigned short port) :
+port(port),
+listenSocket(INVALID_SOCKET),
+wsaStarted(false)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    Stop();
+
+    if (listenSocket != INVALID_SOCKET)
+        closesocket(static_cast<SOCKET>(listenSocket));
+
+    if (wsaStarted)
+        WSACleanup();
+}
+
+bool MetricsServer::Initialize() {
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        cerr << "Metrics disabled: could not initialize winsock" << endl;
+        return false;
+    }
+    wsaStarted = true;
+
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET) {
+        cerr << "Metrics disabled: could not create socket (" << WSAGetLastError() << ")" << endl;
+        return false;
+    }
+
+    // Fail rather than share the port if something else is already listening on it
+    BOOL exclusive = TRUE;
+    setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char*>(&exclusive), sizeof(exclusive));
+
+    // Loopback only, metrics shouldn't be visible to the network
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+        cerr << "Metrics disabled: could not bind to port " << port << " (" << WSAGetLastError() << "), is it in use?" << endl;
+        closesocket(s);
+        return false;
+    }
+
+    if (listen(s, 4) == SOCKET_ERROR) {
+        cerr << "Metrics disabled: could not listen on port " << port << " (" << WSAGetLastError() << ")" << endl;
+        closesocket(s);
+        return false;
+    }
+
+    listenSocket = static_cast<uintptr_t>(s);
+    cout << "Serving metrics on http://127.0.0.1:" << port << "/metrics" << endl;
+    return true;
+}
+
+bool MetricsServer::IsListening() const {
+    return listenSocket != INVALID_SOCKET;
+}
+
+void MetricsServer::Run() {
+    SOCKET s = static_cast<SOCKET>(listenSocket);
+
+    while (!m_stop) {
+        // Wake up periodically to check whether we've been stopped
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(s, &readSet);
+        timeval timeout = { 0, 250000 };
+
+        int rc = select(0, &readSet, nullptr, nullptr, &timeout);
+        if (rc == SOCKET_ERROR)
+            break;
+        if (rc == 0)
+            continue;
+
+        SOCKET client = accept(s, nullptr, nullptr);
+        if (client == INVALID_SOCKET)
+            continue;
+
+        HandleClient(static_cast<uintptr_t>(client));
+        closesocket(client);
+    }
+}
+
+void MetricsServer::HandleClient(uintptr_t clientHandle) {
+    SOCKET client = static_cast<SOCKET>(clientHandle);
+
+    // Don't let a stalled client hold up the server
+    DWORD timeoutMs = 1000;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeoutMs), sizeof(timeoutMs));
+
+    // Read the request line. Every path returns the metrics, so the rest of the request is ignored.
+    char request[1024];
+    int received = recv(client, request, sizeof(request) - 1, 0);
+    if (received <= 0)
+        return;
+    request[received] = '\0';
+
+    bool head = (strncmp(request, "HEAD ", 5) == 0);
+    bool get = (strncmp(request, "GET ", 4) == 0);
+
+    ostringstream body;
+    if (get || head)
+        Metrics::GetRegistry().Render(body);
+    string content = body.str();
+
+    ostringstream response;
+    if (get || head)
+        response << "HTTP/1.0 200 OK\r\n"
+            << "Content-Type: text/plain; version=0.0.4\r\n";
+    else
+        response << "HTTP/1.0 405 Method Not Allowed\r\n";
+    response << "Content-Length: " << content.size() << "\r\n"
+        << "Connection: close\r\n"
+        << "\r\n";
+    if (get)
+        response << content;
+
+    string data = response.str();
+    const char* p = data.c_str();
+    int remaining = static_cast<int>(data.size());
+    while (remaining > 0) {
+        int sent = send(client, p, remaining, 0);
+        if (sent <= 0)
+            break;
+        p += sent;
+        remaining -= sent;
+    }
+}
@@ -0,0 +1,17 @@
+#include "utils\Pipeline.h"
+
+#include <Windows.h>
+
+#include <thread>
+
+void PipelineDetail::PinCurrentThread(int core) {
+    if (core < 0 || core >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+        return;
+
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core);
+}
+
+int PipelineDetail::CoreCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return (n > 0) ? static_cast<int>(n) : 1;
+}
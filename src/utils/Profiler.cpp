@@ -0,0 +1,171 @@
+#include "utils\Profiler.h"
+
+#include <Windows.h>
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct Event {
+        const char* name;
+        long long   start;
+        long long   end;
+    };
+
+    // Single-producer event ring, owned by one thread
+    struct ThreadBuffer {
+        ThreadBuffer(unsigned int id) : id(id), events(capacity), written(0) {}
+
+        static const size_t capacity = 1 << 14;
+
+        unsigned int        id;
+        string              name;
+        vector<Event>       events;
+        atomic<unsigned long long> written;
+    };
+
+    mutex                   buffersMutex;
+    vector<ThreadBuffer*>   buffers;    // Never freed, so events survive their thread
+
+    atomic<bool>            enabled(true);
+
+    __declspec(thread) ThreadBuffer* threadBuffer = nullptr;
+
+    long long QueryFrequency() {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f.QuadPart;
+    }
+
+    const long long frequency = QueryFrequency();
+    const long long epoch = Profiler::Now();
+
+    ThreadBuffer* GetThreadBuffer() {
+        if (threadBuffer == nullptr) {
+            lock_guard<mutex> lock(buffersMutex);
+            threadBuffer = new ThreadBuffer(static_cast<unsigned int>(buffers.size()));
+            buffers.push_back(threadBuffer);
+        }
+        return threadBuffer;
+    }
+
+    void WriteJsonString(ostream& os, const string& s) {
+        os << '"';
+        for (auto c : s) {
+            if (c == '"' || c == '\\')
+                os << '\\';
+            os << c;
+        }
+        os << '"';
+    }
+}
+
+Profiler::Scope::Scope(const char* name) {
+    if (!enabled.load(memory_order_relaxed)) {
+        this->name = nullptr;
+        return;
+    }
+
+    this->name = name;
+    start = Now();
+}
+
+Profiler::Scope::~Scope() {
+    if (name == nullptr)
+        return;
+
+    long long end = Now();
+
+    ThreadBuffer* buf = GetThreadBuffer();
+    unsigned long long n = buf->written.load(memory_order_relaxed);
+    Event& e = buf->events[n % ThreadBuffer::capacity];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+    buf->written.store(n + 1, memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name) {
+    ThreadBuffer* buf = GetThreadBuffer();
+    lock_guard<mutex> lock(buffersMutex);
+    buf->name = name;
+}
+
+void Profiler::SetEnabled(bool enable) {
+    enabled = enable;
+}
+
+bool Profiler::IsEnabled() {
+    return enabled;
+}
+
+long long Profiler::Now() {
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+}
+
+double Profiler::TicksToSeconds(long long ticks) {
+    return static_cast<double>(ticks) / static_cast<double>(frequency);
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename) {
+    ofstream os(filename);
+    if (!os.is_open())
+        return false;
+
+    lock_guard<mutex> lock(buffersMutex);
+
+    // Microseconds, to the nanosecond: the default 6 significant digits lose
+    // microseconds after 100s
+    os << fixed << setprecision(3);
+    os << "{\"traceEvents\":[\n";
+    bool first = true;
+
+    for (auto buf : buffers) {
+        // Thread name metadata
+        if (!buf->name.empty()) {
+            if (!first) os << ",\n";
+            first = false;
+            os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buf->id << ",\"args\":{\"name\":";
+            WriteJsonString(os, buf->name);
+            os << "}}";
+        }
+
+        // Only the most recent events are still held in the ring. Its thread may be overwriting
+        // the oldest while they're copied, so check afterwards which could have been, and skip them.
+        unsigned long long n = buf->written.load(memory_order_acquire);
+        unsigned long long begin = (n > ThreadBuffer::capacity) ? n - ThreadBuffer::capacity : 0;
+
+        const unsigned long long copied = begin;
+        vector<Event> events(static_cast<size_t>(n - copied));
+        for (unsigned long long i = copied; i < n; i++)
+            events[static_cast<size_t>(i - copied)] = buf->events[i % ThreadBuffer::capacity];
+
+        atomic_thread_fence(memory_order_acquire);
+        unsigned long long after = buf->written.load(memory_order_relaxed);
+        if (after + 1 > begin + ThreadBuffer::capacity)
+            begin = after + 1 - ThreadBuffer::capacity;   // Slot 'after' may be being written now
+
+        for (unsigned long long i = begin; i < n; i++) {
+            const Event& e = events[static_cast<size_t>(i - copied)];
+
+            if (!first) os << ",\n";
+            first = false;
+            os << "{\"name\":";
+            WriteJsonString(os, e.name);
+            os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buf->id
+               << ",\"ts\":" << TicksToSeconds(e.start - epoch) * 1e6
+               << ",\"dur\":" << TicksToSeconds(e.end - e.start) * 1e6 << "}";
+        }
+    }
+
+    os << "\n]}\n";
+    return os.good();
+}
@@ -0,0 +1,209 @@
+#include "utils\TaskScheduler.h"
+#include "utils\Profiler.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+    // Which scheduler (if any) the current thread is a worker of, and its queue
+    __declspec(thread) const TaskScheduler* currentScheduler = nullptr;
+    __declspec(thread) int currentWorker = -1;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void TaskScheduler::WorkQueue::Push(const Task& task) {
+    lock_guard<mutex> lock(queueMutex);
+    if (count == tasks.size()) {
+        // Full: unwrap into a bigger buffer
+        vector<Task> grown(tasks.empty() ? 64 : tasks.size() * 2);
+        for (size_t i = 0; i < count; i++)
+            grown[i] = tasks[(head + i) % tasks.size()];
+        tasks.swap(grown);
+        head = 0;
+    }
+    tasks[(head + count) % tasks.size()] = task;
+    count++;
+}
+
+bool TaskScheduler::WorkQueue::PopBack(Task& task) {
+    lock_guard<mutex> lock(queueMutex);
+    if (count == 0)
+        return false;
+    count--;
+    task = tasks[(head + count) % tasks.size()];
+    return true;
+}
+
+bool TaskScheduler::WorkQueue::PopFront(Task& task) {
+    lock_guard<mutex> lock(queueMutex);
+    if (count == 0)
+        return false;
+    task = tasks[head];
+    head = (head + 1) % tasks.size();
+    count--;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+TaskScheduler::TaskScheduler(int threads) :
+    stopping(false),
+    queued(0),
+    nextQueue(0)
+{
+    StartWorkers(threads);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    StopWorkers();
+}
+
+void TaskScheduler::SetThreadCount(int threads) {
+    if (threads == GetThreadCount())
+        return;
+
+    StopWorkers();
+    StartWorkers(threads);
+}
+
+int TaskScheduler::DefaultThreadCount() {
+    return SpareThreadCount(1);
+}
+
+int TaskScheduler::SpareThreadCount(int busyThreads) {
+    int cores = static_cast<int>(thread::hardware_concurrency());
+    return max(cores - busyThreads, 0);
+}
+
+TaskScheduler& TaskScheduler::Default() {
+    static TaskScheduler scheduler(DefaultThreadCount());
+    return scheduler;
+}
+
+void TaskScheduler::StartWorkers(int threads) {
+    stopping = false;
+    for (int i = 0; i < threads; i++)
+        queues.push_back(unique_ptr<WorkQueue>(new WorkQueue()));
+    for (int i = 0; i < threads; i++)
+        workers.push_back(thread(&TaskScheduler::WorkerLoop, this, i));
+}
+
+void TaskScheduler::StopWorkers() {
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& t : workers)
+        t.join();
+
+    workers.clear();
+    queues.clear();
+}
+
+void TaskScheduler::ParallelFor(int begin, int end, int grain, const RangeFunction& fn) {
+    grain = max(grain, 1);
+    int chunks = ChunkCount(begin, end, grain);
+    if (chunks == 0)
+        return;
+
+    // Not worth handing out
+    if (chunks == 1 || queues.empty()) {
+        for (int b = begin; b < end; b += grain)
+            fn(b, min(b + grain, end));
+        return;
+    }
+
+    Job job;
+    job.fn = &fn;
+    job.remaining = chunks;
+
+    // A worker keeps its chunks to itself (the others will steal them if they're idle),
+    // anyone else deals them out across all the workers
+    int self = (currentScheduler == this) ? currentWorker : -1;
+    int n = static_cast<int>(queues.size());
+    int first = (self >= 0) ? self : static_cast<int>(nextQueue.fetch_add(1) % n);
+
+    // Queued back to front, so a worker popping its own back works through the range in order
+    for (int i = chunks - 1; i >= 0; i--) {
+        Task task = { &job, begin + i * grain, min(begin + (i + 1) * grain, end) };
+        int q = (self >= 0) ? self : (first + i) % n;
+        queues[q]->Push(task);
+        queued.fetch_add(1, memory_order_release);
+    }
+
+    {
+        lock_guard<mutex> lock(wakeMutex);
+    }
+    wake.notify_all();
+
+    // Help out until our job is done. This may run chunks of someone else's job too.
+    Task task;
+    while (job.remaining.load(memory_order_acquire) > 0) {
+        if (FindTask(self, task))
+            Execute(task);
+        else
+            this_thread::yield();
+    }
+
+    if (job.error)
+        rethrow_exception(job.error);
+}
+
+void TaskScheduler::WorkerLoop(int index) {
+    Profiler::SetThreadName("Worker");
+    currentScheduler = this;
+    currentWorker = index;
+
+    Task task;
+    while (!stopping) {
+        if (FindTask(index, task)) {
+            Execute(task);
+            continue;
+        }
+
+        unique_lock<mutex> lock(wakeMutex);
+        wake.wait(lock, [this] { return stopping || queued.load(memory_order_acquire) > 0; });
+    }
+}
+
+bool TaskScheduler::FindTask(int self, Task& task) {
+    if (queued.load(memory_order_acquire) == 0)
+        return false;
+
+    if (self >= 0 && queues[self]->PopBack(task)) {
+        queued.fetch_sub(1, memory_order_relaxed);
+        return true;
+    }
+
+    int n = static_cast<int>(queues.size());
+    int start = (self >= 0) ? self + 1 : 0;
+    for (int i = 0; i < n; i++) {
+        int victim = (start + i) % n;
+        if (victim != self && queues[victim]->PopFront(task)) {
+            queued.fetch_sub(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::Execute(const Task& task) {
+    Job* job = task.job;
+    try {
+        (*job->fn)(task.begin, task.end);
+    }
+    catch (...) {
+        lock_guard<mutex> lock(job->errorMutex);
+        if (!job->error)
+            job->error = current_exception();
+    }
+
+    // Last access to the job: once this reaches 0 its owner may return
+    job->remaining.fetch_sub(1, memory_order_acq_rel);
+}
@@ -0,0 +1,15 @@
+#include "utils\Timestamp.h"
+
+#include <Windows.h>
+
+#include <cstdio>
+
+std::string FormatTimestamp() {
+    SYSTEMTIME t;
+    GetLocalTime(&t);
+
+    char buffer[32];
+    sprintf_s(buffer, "%04d%02d%02d-%02d%02d%02d-%03d",
+        t.wYear, t.wMonth, t.wDay, t.wHour, t.wMinute, t.wSecond, t.wMilliseconds);
+    return buffer;
+}